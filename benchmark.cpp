@@ -0,0 +1,601 @@
+#ifdef RAYTRACER_BENCHMARK
+
+#include "ofMain.h"
+#include "rayTracer.h"
+#include "renderProfiler.h"
+#include "sceneFile.h"
+#include "sceneStore.h"
+#include "benchmarkSuite.h"
+
+#include <random>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+
+//  Benchmark target: compile the project with RAYTRACER_BENCHMARK defined
+//  to get this main instead of the interactive one in main.cpp.
+//
+//  usage: benchmark [--threads n] [--width w] [--height h]
+//         benchmark --suite ...
+//
+//  The first form runs the micro-benchmarks below; --suite runs the
+//  canonical scene suite in benchmarkSuite.h instead.
+//
+
+typedef std::chrono::steady_clock Clock;
+
+//  every heap allocation in the process while the benchmark runs, for the
+//  allocations-per-frame numbers
+//
+static std::atomic<long long> allocationCount(0);
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"	// malloc/free pairs below are matched
+#endif
+
+void* operator new(size_t size) {
+	allocationCount++;
+	if (void* p = malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete[](p); }
+
+static double millisSince(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+//--------------------------------------------------------------
+//casts one closest-hit ray per pixel and returns millions of rays/sec
+//hits counts the rays that found something, objectSum adds up the hit
+//object indices so different kernels can be checked against each other
+//
+static double traceRays(RayTracer& tracer, RenderCam& cam, int width, int height, int& hits, bool packets = false, long long* objectSum = nullptr) {
+	std::atomic<int> hitCount(0);
+	std::atomic<long long> indexSum(0);
+	auto start = Clock::now();
+	tracer.renderer.render(width, height, [&](const Tile& tile) {
+		int local = 0;
+		long long localSum = 0;
+		for (int j = tile.y0; j < tile.y1; j++) {
+			for (int i = tile.x0; i < tile.x1; i += RayPacket::maxSize) {
+				int count = packets ? std::min(RayPacket::maxSize, tile.x1 - i) : 1;
+				Ray rays[RayPacket::maxSize];
+				HitRecord hit[RayPacket::maxSize];
+				for (int k = 0; k < count; k++) {
+					rays[k] = cam.getRay((i + k + .5f) / width, 1 - (j + .5f) / height);
+				}
+				if (packets) tracer.bvh.intersectPacket(rays, count, hit);
+				else tracer.intersect(rays[0], hit[0]);
+				for (int k = 0; k < count; k++) {
+					if (hit[k].objectIndex >= 0) {
+						local++;
+						localSum += hit[k].objectIndex;
+					}
+				}
+				if (!packets) i -= RayPacket::maxSize - 1;
+			}
+		}
+		hitCount += local;
+		indexSum += localSum;
+	});
+	double ms = millisSince(start);
+	hits = hitCount;
+	if (objectSum) *objectSum = indexSum;
+	return width * height / (ms * 1000);
+}
+
+//--------------------------------------------------------------
+//one any-hit shadow query per primary hit, towards a light above the
+//camera; returns millions of shadow rays/sec
+//
+static double traceShadowRays(RayTracer& tracer, RenderCam& cam, int width, int height, int& blocked) {
+	const glm::vec3 lightPos = glm::vec3(0, 10, 10);
+	vector<glm::vec3> points;
+	for (int j = 0; j < height; j++) {
+		for (int i = 0; i < width; i++) {
+			HitRecord hit;
+			if (tracer.intersect(cam.getRay((i + .5f) / width, 1 - (j + .5f) / height), hit)) {
+				points.push_back(hit.point + hit.normal * tracer.shadowBias);
+			}
+		}
+	}
+
+	std::atomic<int> blockedCount(0);
+	auto start = Clock::now();
+	tracer.renderer.render(points.size(), 1, [&](const Tile& tile) {
+		int local = 0;
+		for (int k = tile.x0; k < tile.x1; k++) {
+			if (tracer.occluded(Ray(points[k], lightPos - points[k]), 0, glm::distance(points[k], lightPos))) local++;
+		}
+		blockedCount += local;
+	});
+	double ms = millisSince(start);
+	blocked = blockedCount;
+	return points.size() / (ms * 1000);
+}
+
+//--------------------------------------------------------------
+//BVH scaling: build time and closest-hit throughput from 10 to 100k
+//spheres, against a linear scan where that still finishes in time
+//
+static void benchBvhScaling(int threads, int width, int height) {
+	const int counts[] = { 10, 100, 1000, 10000, 100000 };
+	const int linearLimit = 10000;
+
+	cout << "BVH scaling, " << width << "x" << height << " primary rays" << endl;
+	cout << "spheres\tbuild ms\tnodes\tSAH cost\tBVH Mrays/s\tlinear Mrays/s\thits\tshadow Mrays/s\tblocked" << endl;
+
+	for (int count : counts) {
+		SceneStore store;
+		RenderCam cam;
+		buildSphereField(store, count);
+
+		RayTracer tracer(store.scene, store.light, cam);
+		tracer.renderer.setNumThreads(threads);
+		tracer.renderer.setTileSize(16);
+
+		auto start = Clock::now();
+		tracer.updateBvh();
+		double buildMs = millisSince(start);
+
+		int hits, linearHits = 0;
+		double bvhRate = traceRays(tracer, cam, width, height, hits);
+		string linearRate = "-";
+		if (count <= linearLimit) {
+			tracer.useBvh = false;
+			linearRate = ofToString(traceRays(tracer, cam, width, height, linearHits));
+			if (linearHits != hits) cerr << "hit count mismatch: BVH " << hits << " linear " << linearHits << endl;
+		}
+
+		tracer.useBvh = true;
+		int blocked;
+		double shadowRate = traceShadowRays(tracer, cam, width, height, blocked);
+
+		cout << count << "\t" << buildMs << "\t" << tracer.bvh.getNodeCount() << "\t" << tracer.bvh.sahCost()
+			<< "\t" << bvhRate << "\t" << linearRate << "\t" << hits << "\t" << shadowRate << "\t" << blocked << endl;
+	}
+}
+
+//--------------------------------------------------------------
+//ray-sphere kernels: every SIMD level this CPU supports, one ray against
+//a leaf of spheres and 8-ray packets against one sphere at a time
+//
+static void benchSphereKernels(int threads, int width, int height) {
+	const int count = 10000;
+	SceneStore store;
+	RenderCam cam;
+	buildSphereField(store, count);
+
+	RayTracer tracer(store.scene, store.light, cam);
+	tracer.renderer.setNumThreads(threads);
+	tracer.renderer.setTileSize(16);
+	tracer.updateBvh();
+
+	cout << endl << "sphere kernels, " << count << " spheres, detected " << sphereKernels().name << endl;
+	cout << "kernel\tsingle Mrays/s\tpacket Mrays/s\thits\tobject sum" << endl;
+
+	long long reference = -1;
+	for (int level = SIMD_SCALAR; level <= detectSimdLevel(); level++) {
+		tracer.bvh.setKernels(sphereKernels((SimdLevel)level));
+		int hits, packetHits;
+		long long sum, packetSum;
+		double single = traceRays(tracer, cam, width, height, hits, false, &sum);
+		double packet = traceRays(tracer, cam, width, height, packetHits, true, &packetSum);
+		if (reference < 0) reference = sum;
+		if (sum != reference || packetSum != reference || packetHits != hits) {
+			cerr << tracer.bvh.getKernels().name << " kernel disagrees with the scalar path" << endl;
+		}
+		cout << tracer.bvh.getKernels().name << "\t" << single << "\t" << packet << "\t" << hits << "\t" << sum << endl;
+	}
+}
+
+#if defined(_MSC_VER)
+#define NOINLINE __declspec(noinline)
+#else
+#define NOINLINE __attribute__((noinline))
+#endif
+
+static volatile float benchSink;
+
+//--------------------------------------------------------------
+//old shading signature, Ray and Light by value, kept here only to show
+//what it cost per call
+//
+static NOINLINE float shadeByValue(Ray r, Light light) {
+	return light.intensity + r.d.x;
+}
+
+static NOINLINE float shadeByRecord(const Ray& r, const LightRecord& light) {
+	return light.intensity + r.d.x;
+}
+
+//--------------------------------------------------------------
+//allocations per rendered frame of the default scene with a point, spot
+//and area light, next to the per-call cost of the by-value Light copies
+//the shading functions used to make
+//
+static void benchAllocations(int threads, int width, int height) {
+	SceneStore store;
+	vector<Light*>& light = store.light;
+	RenderCam cam;
+	buildDefaultScene(store);
+	for (int i = 0; i < 6; i++) {
+		store.addSphere(glm::vec3(-3 + i * 1.2f, -1.5f + (i % 2), -1 + i * .3f), .5, ofColor::blue);
+	}
+	store.addLight(glm::vec3(-5, 5, 5), glm::vec3(0, -2, 0), .2, 15, 5)->setSpotLight();
+	store.addLight(glm::vec3(0, 8, 2), glm::vec3(0, -2, 0), .2, 15, 5)->setAreaLight();
+
+	RayTracer tracer(store.scene, light, cam);
+	tracer.numThreads = threads;
+	RadianceBuffer radiance;
+	radiance.allocate(width, height);
+	tracer.render(radiance);								//first frame sizes pools and buffers
+
+	const int frames = 5;
+	long long before = allocationCount;
+	auto start = Clock::now();
+	for (int f = 0; f < frames; f++) tracer.render(radiance);
+	double ms = millisSince(start) / frames;
+	long long perFrame = (allocationCount - before) / frames;
+
+	//one shading call per pixel per light, the old API copied both each time
+	long long calls = (long long)width * height * light.size();
+	Ray ray(glm::vec3(0), glm::vec3(0, 0, -1));
+	float sink = 0;
+
+	before = allocationCount;
+	start = Clock::now();
+	for (long long k = 0; k < calls; k++) sink += shadeByValue(ray, *light[k % light.size()]);
+	double byValueMs = millisSince(start);
+	long long byValueAllocations = allocationCount - before;
+
+	vector<LightRecord> records;
+	for (int i = 0; i < light.size(); i++) records.push_back(light[i]->getRecord());
+	before = allocationCount;
+	start = Clock::now();
+	for (long long k = 0; k < calls; k++) sink += shadeByRecord(ray, records[k % records.size()]);
+	double byRecordMs = millisSince(start);
+	long long byRecordAllocations = allocationCount - before;
+
+	cout << endl << "allocations, default scene, " << light.size() << " lights, " << width << "x" << height << endl;
+	cout << "render\t" << ms << " ms/frame\t" << perFrame << " allocations/frame" << endl;
+	cout << "calls\tLight by value ms\tallocations\tLightRecord by ref ms\tallocations" << endl;
+	cout << calls << "\t" << byValueMs << "\t" << byValueAllocations << "\t" << byRecordMs << "\t" << byRecordAllocations
+		<< endl;
+	benchSink = sink;
+}
+
+//--------------------------------------------------------------
+//texture fetches: the old per-hit ofImage::getColor with fmod wrapping,
+//once for diffuse and once for specular, against one combined lookup in
+//the tiled mip-mapped cache with each filter
+//
+static void benchTextures() {
+	const int size = 1024;
+	const int samples = 4000000;
+	ofPixels pixels;
+	pixels.allocate(size, size, OF_IMAGE_COLOR);
+	for (int k = 0; k < size * size * 3; k++) pixels[k] = (k * 2654435761u) >> 24;
+	ofImage image, imageSpec;
+	image.setUseTexture(false);
+	imageSpec.setUseTexture(false);
+	image.setFromPixels(pixels);
+	imageSpec.setFromPixels(pixels);
+
+	auto start = Clock::now();
+	SurfaceTexture texture;
+	texture.build(pixels, pixels);
+	double buildMs = millisSince(start);
+
+	//a strip of the floor receding from the camera, so footprints grow
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> unit(0, 1);
+	vector<glm::vec3> uvs(samples);
+	for (int k = 0; k < samples; k++) uvs[k] = glm::vec3(unit(rng) * 4, unit(rng) * 4, unit(rng) * 16);
+
+	float sink = 0;
+	start = Clock::now();
+	for (int k = 0; k < samples; k++) {
+		int i = uvs[k].x * size - .5;
+		int j = uvs[k].y * size - .5;
+		ofColor diffuse = image.getColor(fmod(i, image.getWidth()), fmod(j, image.getHeight()));
+		ofColor specular = imageSpec.getColor(fmod(i, imageSpec.getWidth()), fmod(j, imageSpec.getHeight()));
+		sink += diffuse.r + specular.g;
+	}
+	double oldMs = millisSince(start);
+
+	cout << endl << "texture fetches, " << size << "x" << size << ", " << texture.getNumLevels() << " mip levels built in " << buildMs << " ms" << endl;
+	cout << "method\tMfetches/s" << endl;
+	cout << "ofImage getColor x2\t" << samples / (oldMs * 1000) << endl;
+
+	const char* names[] = { "nearest", "bilinear", "trilinear" };
+	for (int filter = SurfaceTexture::NEAREST; filter <= SurfaceTexture::TRILINEAR; filter++) {
+		texture.filter = (SurfaceTexture::Filter)filter;
+		start = Clock::now();
+		for (int k = 0; k < samples; k++) {
+			glm::vec3 diffuse, specular;
+			texture.sample(uvs[k].x, uvs[k].y, uvs[k].z, diffuse, specular);
+			sink += diffuse.x + specular.y;
+		}
+		cout << names[filter] << " combined\t" << samples / (millisSince(start) * 1000) << endl;
+	}
+	benchSink = sink;
+}
+
+//--------------------------------------------------------------
+//render time with one area light over the sphere scene, by samples per
+//side, with and without the corner early-out
+//
+static void benchAreaLights(int threads, int width, int height) {
+	SceneStore store;
+	RenderCam cam;
+	buildDefaultScene(store);
+	for (int i = 0; i < 6; i++) {
+		store.addSphere(glm::vec3(-3 + i * 1.2f, -1.5f + (i % 2), -1 + i * .3f), .5, ofColor::blue);
+	}
+	store.remove(store.light[0]);
+	store.addLight(glm::vec3(0, 8, 2), glm::vec3(0, -2, 0), .2, 15, 5)->setAreaLight();
+
+	RayTracer tracer(store.scene, store.light, cam);
+	tracer.numThreads = threads;
+	RadianceBuffer radiance;
+	radiance.allocate(width, height);
+
+	cout << endl << "area light, " << width << "x" << height << endl;
+	cout << "grid\tfull ms/frame\tadaptive ms/frame" << endl;
+	for (int grid : { 1, 2, 4, 8 }) {
+		tracer.areaLightGrid = grid;
+		double ms[2];
+		for (int adaptive = 0; adaptive < 2; adaptive++) {
+			tracer.adaptiveAreaLight = adaptive;
+			tracer.render(radiance);
+			auto start = Clock::now();
+			tracer.render(radiance);
+			ms[adaptive] = millisSince(start);
+		}
+		cout << grid << "x" << grid << "\t" << ms[0] << "\t" << ms[1] << endl;
+	}
+}
+
+//--------------------------------------------------------------
+//primary ray generation alone: one getRay call per pixel against a whole
+//tile from one getRays call, for an axis aligned and an oblique camera
+//
+static void benchCamera(int width, int height) {
+	const int tileSize = 32;
+	const int frames = 20;
+	vector<Ray> rays(tileSize * tileSize);
+	float sink = 0;
+
+	cout << endl << "camera ray generation, " << width << "x" << height << endl;
+	cout << "camera\tgetRay Mrays/s\tgetRays Mrays/s" << endl;
+	for (int oblique = 0; oblique < 2; oblique++) {
+		RenderCam cam;
+		if (oblique) {
+			cam.position = glm::vec3(8, 4, 9);
+			cam.lookAt(glm::vec3(0, -1, 0), glm::vec3(.2f, 1, 0));
+			cam.setFov(55);
+		}
+		cam.setAspect((float)width / height);
+
+		auto start = Clock::now();
+		for (int f = 0; f < frames; f++) {
+			for (int j = 0; j < height; j++) {
+				for (int i = 0; i < width; i++) sink += cam.getRay((i + .5) / width, 1 - (j + .5) / height).d.x;
+			}
+		}
+		double single = (double)width * height * frames / (millisSince(start) * 1000);
+
+		start = Clock::now();
+		for (int f = 0; f < frames; f++) {
+			for (int y = 0; y < height; y += tileSize) {
+				for (int x = 0; x < width; x += tileSize) {
+					int x1 = std::min(x + tileSize, width), y1 = std::min(y + tileSize, height);
+					cam.getRays(x, y, x1, y1, width, height, rays.data());
+					sink += rays[0].d.x;
+				}
+			}
+		}
+		double tile = (double)width * height * frames / (millisSince(start) * 1000);
+		cout << (oblique ? "oblique" : "axis aligned") << "\t" << single << "\t" << tile << endl;
+	}
+	benchSink = sink;
+}
+
+//--------------------------------------------------------------
+//what turning the profiler on costs a full render of the default scene
+//with a sphere field, and the report it gives
+//
+static void benchProfiler(int threads, int width, int height) {
+	SceneStore store;
+	RenderCam cam;
+	buildDefaultScene(store);
+	buildSphereField(store, 1000);
+
+	RayTracer tracer(store.scene, store.light, cam);
+	tracer.numThreads = threads;
+	RadianceBuffer radiance;
+	radiance.allocate(width, height);
+
+	RenderProfiler& profiler = renderProfiler();
+	cout << endl << "profiler overhead, 1000 spheres, " << width << "x" << height << endl;
+	cout << "profiling\tms/frame" << endl;
+	for (int on = 0; on < 2; on++) {
+		profiler.setEnabled(on);
+		tracer.render(radiance);
+		profiler.reset();
+		auto start = Clock::now();
+		tracer.render(radiance);
+		cout << (on ? "on" : "off") << "\t" << millisSince(start) << endl;
+	}
+	profiler.printSummary(cout);
+	profiler.setEnabled(false);
+}
+
+//--------------------------------------------------------------
+//a sphere dragged a little at a time and a light intensity change,
+//each updated incrementally, against rendering the frame from scratch
+//
+static void benchIncremental(int threads, int width, int height) {
+	SceneStore store;
+	vector<SceneObject*>& scene = store.scene;
+	vector<Light*>& light = store.light;
+	RenderCam cam;
+	buildDefaultScene(store);
+	for (int i = 0; i < 6; i++) {
+		store.addSphere(glm::vec3(-3 + i * 1.2f, -1.5f + (i % 2), -1 + i * .3f), .5, ofColor::blue);
+	}
+	store.addLight(glm::vec3(-5, 5, 5), glm::vec3(0, -2, 0), .2, 15, 5)->setSpotLight();
+
+	RayTracer tracer(scene, light, cam);
+	tracer.numThreads = threads;
+	RadianceBuffer radiance;
+	radiance.allocate(width, height);
+	tracer.render(radiance);
+	auto start = Clock::now();
+	tracer.render(radiance);
+	double fullMs = millisSince(start);
+
+	cout << endl << "incremental re-render, " << width << "x" << height << ", full frame " << fullMs << " ms" << endl;
+	cout << "edit\tms\tretraced\treshaded" << endl;
+	const int steps = 5;
+	double ms = 0;
+	RayTracer::IncrementalStats stats;
+	for (int k = 0; k < steps; k++) {
+		scene.back()->position += glm::vec3(.05, 0, 0);
+		tracer.markObjectsMoved();
+		start = Clock::now();
+		tracer.prepareFrame();
+		if (tracer.canRenderIncremental(radiance)) tracer.renderIncremental(radiance);
+		ms += millisSince(start);
+		stats = tracer.getIncrementalStats();
+	}
+	cout << "drag sphere\t" << ms / steps << "\t" << stats.retraced << "\t" << stats.reshaded << endl;
+
+	light.back()->intensity = .3;
+	start = Clock::now();
+	tracer.prepareFrame();
+	if (tracer.canRenderIncremental(radiance)) tracer.renderIncremental(radiance);
+	ms = millisSince(start);
+	cout << "light intensity\t" << ms << "\t" << tracer.getIncrementalStats().retraced << "\t" << tracer.getIncrementalStats().reshaded << endl;
+}
+
+//--------------------------------------------------------------
+//sphere tracing across the neck where a sphere is blended onto an
+//earlier, unblended one, against a fine walk along each ray through
+//distance(); rays that graze the surface are not counted either way
+//
+static void benchSDFNeck() {
+	SDFObject neck(glm::vec3(0));
+	SDFPrimitive primitive;
+	primitive.size = glm::vec3(.5);
+	neck.add(primitive);
+	primitive.position = glm::vec3(1.1, 0, 0);
+	primitive.blend = .4;
+	neck.add(primitive);
+
+	const int columns = 81, rows = 41;
+	const float step = 1e-3;
+	int hits = 0, disagreements = 0;
+	double ms = 0;
+	for (int j = 0; j < rows; j++) {
+		for (int i = 0; i < columns; i++) {
+			Ray ray(glm::vec3(.3f + .5f * i / (columns - 1), -.3f + .6f * j / (rows - 1), 2), glm::vec3(0, 0, -1));
+			HitRecord hit;
+			auto start = Clock::now();
+			bool traced = neck.intersect(ray, 0, hit);
+			ms += millisSince(start);
+			if (traced) hits++;
+
+			float lowest = FLT_MAX;
+			for (float t = 0; t < 4; t += step) lowest = std::min(lowest, neck.distance(ray.p + ray.d * t));
+			if ((lowest < -1e-3f && !traced) || (lowest > 1e-3f && traced)) disagreements++;
+		}
+	}
+	if (disagreements > 0) cerr << disagreements << " rays across the SDF neck disagree with distance()" << endl;
+
+	cout << endl << "SDF blended neck, " << columns * rows << " rays" << endl;
+	cout << "hits\tdisagreements\tus/ray" << endl;
+	cout << hits << "\t" << disagreements << "\t" << ms * 1000 / (columns * rows) << endl;
+}
+
+//--------------------------------------------------------------
+//scene files: save, load and instantiate a million sphere field in the
+//text and binary forms, with the heap allocations each load makes
+//
+static void benchSceneFile() {
+	const int count = 1000000;
+	SceneStore store;
+	RenderCam cam;
+	buildSphereField(store, count);
+	store.addLight(glm::vec3(10, 5, 5), glm::vec3(1, -2, 0), .2, 15, 5);
+
+	SceneFile captured;
+	captured.capture(store.scene, store.light, cam);
+	store.clear();
+
+	cout << endl << "scene files, " << count << " spheres" << endl;
+	cout << "form\tsave ms\tload ms\tallocations\tinstantiate ms\tallocations" << endl;
+	for (string path : { "benchmark.scene", "benchmark.bscene" }) {
+		auto start = Clock::now();
+		captured.save(path);
+		double saveMs = millisSince(start);
+
+		SceneFile file;
+		long long before = allocationCount;
+		start = Clock::now();
+		file.load(path);
+		double loadMs = millisSince(start);
+		long long loadAllocations = allocationCount - before;
+
+		before = allocationCount;
+		start = Clock::now();
+		file.instantiate(store, cam);
+		double instantiateMs = millisSince(start);
+		long long instantiateAllocations = allocationCount - before;
+
+		cout << (SceneFile::isBinaryPath(path) ? "binary" : "text") << "\t" << saveMs << "\t" << loadMs << "\t" << loadAllocations
+			<< "\t" << instantiateMs << "\t" << instantiateAllocations << endl;
+
+		store.clear();
+		std::remove(path.c_str());
+	}
+}
+
+//========================================================================
+int main(int argc, char* argv[]) {
+	if (argc > 1 && string(argv[1]) == "--suite") return runBenchmarkSuite(argc - 2, argv + 2);
+
+	int threads = 1;
+	int width = 320;
+	int height = 200;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		string arg = argv[i];
+		if (arg == "--threads") threads = ofToInt(argv[i + 1]);
+		else if (arg == "--width") width = ofToInt(argv[i + 1]);
+		else if (arg == "--height") height = ofToInt(argv[i + 1]);
+		else {
+			cerr << "usage: benchmark [--threads n] [--width w] [--height h]" << endl;
+			cerr << "       benchmark --suite [--help for its options]" << endl;
+			return 2;
+		}
+	}
+
+	benchBvhScaling(threads, width, height);
+	benchSphereKernels(threads, width, height);
+	benchAllocations(threads, width, height);
+	benchTextures();
+	benchAreaLights(threads, width, height);
+	benchIncremental(threads, width, height);
+	benchSDFNeck();
+	benchCamera(width, height);
+	benchProfiler(threads, width, height);
+	benchSceneFile();
+	return 0;
+}
+
+#endif
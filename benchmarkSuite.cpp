@@ -0,0 +1,529 @@
+#ifdef RAYTRACER_BENCHMARK
+
+#include "benchmarkSuite.h"
+#include "rayTracer.h"
+#include "imageWriter.h"
+#include "renderProfiler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+//--------------------------------------------------------------
+void buildSphereField(SceneStore& store, int count) {
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> xy(-6, 6);
+	std::uniform_real_distribution<float> z(-20, 0);
+	float radius = .5f * std::cbrt(100.0f / count) + .01f;		// keeps the field roughly equally dense
+	store.reserveSpheres(count);
+	for (int i = 0; i < count; i++) {
+		store.addSphere(glm::vec3(xy(rng), xy(rng) * 2 / 3, z(rng)), radius, ofColor::blue);
+	}
+}
+
+//--------------------------------------------------------------
+long long peakRssKb() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+	return counters.PeakWorkingSetSize / 1024;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;		// bytes on macOS
+#else
+	return usage.ru_maxrss;
+#endif
+#endif
+}
+
+//--------------------------------------------------------------
+//the canonical scenes
+//
+static void sphereField(SceneStore& store, int count) {
+	buildSphereField(store, count);
+	store.addLight(glm::vec3(0, 10, 10), glm::vec3(0, 0, -10), .2, 15, 5);
+}
+
+static void addRowOfSpheres(SceneStore& store) {
+	for (int i = 0; i < 6; i++) {
+		store.addSphere(glm::vec3(-3 + i * 1.2f, -1.5f + (i % 2), -1 + i * .3f), .5, ofColor::blue);
+	}
+}
+
+static void buildManyLights(SceneStore& store) {
+	buildDefaultScene(store);
+	addRowOfSpheres(store);
+	store.remove(store.light[0]);
+	for (int i = 0; i < 8; i++) {
+		float x = -7 + i * 2;
+		store.addLight(glm::vec3(x, 6, 6), glm::vec3(x * .5f, -2, 0), .05, 15, 5);
+		store.addLight(glm::vec3(x, 8, -2), glm::vec3(x * .5f, -2, -1), .05, 20, 5)->setSpotLight();
+	}
+	for (int i = 0; i < 4; i++) {
+		store.addLight(glm::vec3(-6 + i * 4, 9, 3), glm::vec3(-3 + i * 2, -2, 0), .05, 15, 2)->setAreaLight();
+	}
+}
+
+static void buildTextured(SceneStore& store) {
+	buildDefaultScene(store);
+	addRowOfSpheres(store);
+}
+
+static void buildUntextured(SceneStore& store) {
+	store.clear();
+	store.addPlane(glm::vec3(-1, -2, 0), glm::vec3(0, 1, 0), ofColor::darkBlue, 12, 10);
+	store.addPlane(glm::vec3(-1, 1, -5), glm::vec3(0, 0, 1), ofColor::darkGray, 20, 10);
+	store.addLight(glm::vec3(10, 5, 5), glm::vec3(1, -2, 0), .2, 15, 5);
+	addRowOfSpheres(store);
+}
+
+//two facing mirror walls, so rays bounce until the depth limit or the
+//budget stops them, and alternating glass and mirror spheres
+static void buildMirrors(SceneStore& store) {
+	buildUntextured(store);
+	int spheres = 0;
+	for (SceneObject* object : store.scene) {
+		if (object->type != OBJECT_SPHERE) continue;
+		if (spheres++ % 2) object->reflectivity = .8;
+		else object->transparency = .9;
+	}
+	store.addPlane(glm::vec3(-6, 0, -2), glm::vec3(1, 0, 0), ofColor::white, 10, 8)->reflectivity = .9;
+	store.addPlane(glm::vec3(6, 0, -2), glm::vec3(-1, 0, 0), ofColor::white, 10, 8)->reflectivity = .9;
+}
+
+//a 16 x 16 grid of dim, narrow spot lights over the untextured scene,
+//each aimed at its own patch of floor
+static void buildSpotGrid(SceneStore& store) {
+	buildUntextured(store);
+	store.remove(store.light[0]);
+	for (int i = 0; i < 256; i++) {
+		float x = -7.5f + i % 16;
+		float z = -4.5f + (i / 16) * .6f;
+		store.addLight(glm::vec3(x, 6, z + 2), glm::vec3(x * .9f, -2, z), .015, 6, 5)->setSpotLight();
+	}
+}
+
+//the untextured planes with one SDF object of 64 spheres blended into a
+//helix around a torus and a box, so most steps need only a few of them
+static void buildSDFHelix(SceneStore& store) {
+	buildUntextured(store);
+	SDFObject* sdf = store.addSDF(glm::vec3(0, 0, -1), ofColor::orange);
+
+	SDFPrimitive torus;
+	torus.shape = SDF_TORUS;
+	torus.size = glm::vec3(1.5, .25, 0);
+	torus.rotation = glm::vec3(90, 0, 0);
+	sdf->add(torus);
+
+	SDFPrimitive box;
+	box.shape = SDF_BOX;
+	box.size = glm::vec3(.4);
+	box.rotation = glm::vec3(30, 45, 0);
+	box.blend = .3;
+	sdf->add(box);
+
+	for (int i = 0; i < 64; i++) {
+		float angle = i * TWO_PI / 32;
+		SDFPrimitive sphere;
+		sphere.size = glm::vec3(.25);
+		sphere.position = glm::vec3(2.4f * cos(angle), -1.6f + i * .05f, 2.4f * sin(angle));
+		sphere.blend = .15;
+		sdf->add(sphere);
+	}
+}
+
+//the untextured planes with a (2, 3) torus knot tube of 1000 rings of 100
+//vertices, 200k smooth shaded triangles, built here rather than loaded
+static void buildMeshKnot(SceneStore& store) {
+	buildUntextured(store);
+	const int rings = 1000, sides = 100;
+	const float tube = .3f;
+	auto curve = [](float t) { return glm::vec3((2 + cos(3 * t)) * cos(2 * t), (2 + cos(3 * t)) * sin(2 * t), sin(3 * t)) * .8f; };
+
+	std::shared_ptr<TriangleMesh> knot = std::make_shared<TriangleMesh>();
+	knot->vertices.reserve(rings * sides);
+	knot->normals.reserve(rings * sides);
+	knot->indices.reserve(rings * sides * 6);
+	for (int i = 0; i < rings; i++) {
+		float t = i * TWO_PI / rings;
+		glm::vec3 center = curve(t);
+		glm::vec3 tangent = glm::normalize(curve(t + .001f) - curve(t - .001f));
+		glm::vec3 side = glm::normalize(glm::cross(tangent, glm::vec3(0, 0, 1)));
+		glm::vec3 up = glm::cross(side, tangent);
+		for (int k = 0; k < sides; k++) {
+			float a = k * TWO_PI / sides;
+			glm::vec3 normal = side * cos(a) + up * sin(a);
+			knot->vertices.push_back(center + normal * tube);
+			knot->normals.push_back(normal);
+
+			uint32_t next = (i + 1) % rings * sides;
+			uint32_t quad[4] = { uint32_t(i * sides + k), uint32_t(i * sides + (k + 1) % sides), next + (k + 1) % sides, next + k };
+			for (int corner : { 0, 1, 2, 0, 2, 3 }) knot->indices.push_back(quad[corner]);
+		}
+	}
+	knot->build();
+	store.addMesh(glm::vec3(0, .6f, -1), knot, ofColor::orange);
+}
+
+//a 72 triangle tree standing on the origin, a trunk under two cones of
+//foliage, flat shaded
+static std::shared_ptr<TriangleMesh> buildTree() {
+	std::shared_ptr<TriangleMesh> tree = std::make_shared<TriangleMesh>();
+	const int sides = 12;
+	auto ring = [&](float y, float radius) {
+		uint32_t first = tree->vertices.size();
+		for (int k = 0; k < sides; k++) {
+			float a = k * TWO_PI / sides;
+			tree->vertices.push_back(glm::vec3(radius * cos(a), y, radius * sin(a)));
+		}
+		return first;
+	};
+	auto point = [&](float y) {
+		tree->vertices.push_back(glm::vec3(0, y, 0));
+		return uint32_t(tree->vertices.size() - 1);
+	};
+
+	uint32_t bottom = ring(0, .08f), top = ring(.5f, .08f);
+	for (uint32_t k = 0; k < sides; k++) {
+		uint32_t next = (k + 1) % sides;
+		for (uint32_t v : { bottom + k, top + k, top + next, bottom + k, top + next, bottom + next }) tree->indices.push_back(v);
+	}
+	for (glm::vec3 cone : { glm::vec3(.35f, .5f, .8f), glm::vec3(.85f, .38f, .7f) }) {		// base height, radius, height
+		uint32_t rim = ring(cone.x, cone.y), apex = point(cone.x + cone.z), center = point(cone.x);
+		for (uint32_t k = 0; k < sides; k++) {
+			uint32_t next = (k + 1) % sides;
+			for (uint32_t v : { rim + k, apex, rim + next, rim + k, rim + next, center }) tree->indices.push_back(v);
+		}
+	}
+	tree->build();
+	return tree;
+}
+
+//a million instances of one tree on a 1000 x 1000 grid running away from
+//the camera, each jittered, turned, scaled and given one of three greens
+static void buildForest(SceneStore& store) {
+	store.clear();
+	store.addPlane(glm::vec3(0, -3, -300), glm::vec3(0, 1, 0), ofColor::darkOliveGreen, 700, 700);
+	store.addLight(glm::vec3(5, 20, 10), glm::vec3(0, -3, -15), 1.5, 15, 5);
+
+	InstanceSet* forest = store.addInstanceSet(glm::vec3(0, -3, 0));
+	int tree = forest->addGeometry(buildTree());
+	for (ofColor green : { ofColor::forestGreen, ofColor::darkGreen, ofColor::olive }) {
+		InstanceMaterial material;
+		material.diffuse = green;
+		forest->addMaterial(material);
+	}
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> jitter(-.2f, .2f);
+	std::uniform_real_distribution<float> turn(0, 360);
+	std::uniform_real_distribution<float> size(.7f, 1.3f);
+	const int rows = 1000;
+	forest->instances.reserve(rows * rows);
+	for (int i = 0; i < rows * rows; i++) {
+		Instance instance;
+		instance.position = glm::vec3(-300 + (i % rows) * .6f + jitter(rng), 0, 5 - (i / rows) * .6f + jitter(rng));
+		instance.rotation = glm::vec3(0, turn(rng), 0);
+		instance.scale = size(rng);
+		instance.geometry = tree;
+		instance.material = rng() % 3;
+		forest->add(instance);
+	}
+	forest->build();
+}
+
+//--------------------------------------------------------------
+const vector<BenchmarkScene>& benchmarkScenes() {
+	static const vector<BenchmarkScene> scenes = {
+		{ "default", "two textured planes, one point light", [](SceneStore& store) { buildDefaultScene(store); } },
+		{ "spheres-1k", "1000 random spheres, one point light", [](SceneStore& store) { sphereField(store, 1000); } },
+		{ "spheres-10k", "10000 random spheres, one point light", [](SceneStore& store) { sphereField(store, 10000); } },
+		{ "spheres-100k", "100000 random spheres, one point light", [](SceneStore& store) { sphereField(store, 100000); } },
+		{ "lights", "textured planes, 6 spheres, 8 point, 8 spot and 4 area lights", buildManyLights },
+		{ "textured", "textured planes, 6 spheres, one point light", buildTextured },
+		{ "untextured", "the textured scene with plain colored planes", buildUntextured },
+		{ "mirrors", "the untextured scene between two mirror walls, glass and mirror spheres", buildMirrors },
+		{ "spots-256", "the untextured scene lit by 256 narrow spot lights", buildSpotGrid },
+		{ "spots-256-sampled", "spots-256 shading 4 lights per point picked from the light tree", buildSpotGrid, 4 },
+		{ "sdf-helix", "the untextured scene with 66 blended SDF primitives, sphere traced", buildSDFHelix },
+		{ "mesh-knot", "the untextured scene with a 200k triangle torus knot mesh", buildMeshKnot },
+		{ "forest-1m", "a million instances of one 72 triangle tree over a ground plane", buildForest },
+	};
+	return scenes;
+}
+
+//--------------------------------------------------------------
+//binary PPM as ImageWriter::savePpm writes it
+//
+static bool readPpm(const string& path, ofPixels& pixels) {
+	std::ifstream file(path, std::ios::binary);
+	string magic;
+	int width, height, maxValue;
+	if (!(file >> magic >> width >> height >> maxValue) || magic != "P6" || maxValue != 255 || width <= 0 || height <= 0) return false;
+	file.get();
+	pixels.allocate(width, height, OF_IMAGE_COLOR);
+	file.read((char*)pixels.getData(), (std::streamsize)width * height * 3);
+	return (bool)file;
+}
+
+//  how a rendered frame compares with its golden image
+//
+struct GoldenResult {
+	string status = "skipped";	// skipped, created, match, mismatch
+	int maxDiff = 0;			// largest channel difference
+	long long diffPixels = 0;	// pixels with a channel off by more than the tolerance
+};
+
+//--------------------------------------------------------------
+//compares pixels with dir/scene_WxH.ppm, writing the golden image if there
+//is none yet or update is set; on a mismatch the differences, 16 times
+//amplified, go to dir/scene_WxH.diff.ppm
+//
+static GoldenResult checkGolden(const string& dir, const string& scene, const ofPixels& pixels, int tolerance, bool update) {
+	GoldenResult result;
+	if (dir.empty()) return result;
+
+	string base = dir + "/" + scene + "_" + ofToString(pixels.getWidth()) + "x" + ofToString(pixels.getHeight());
+	ofPixels golden;
+	if (update || !readPpm(base + ".ppm", golden)) {
+		if (!ImageWriter::savePpm(base + ".ppm", pixels)) {
+			cerr << base << ".ppm: cannot write golden image" << endl;
+			result.status = "mismatch";
+			return result;
+		}
+		result.status = "created";
+		return result;
+	}
+	if (golden.getWidth() != pixels.getWidth() || golden.getHeight() != pixels.getHeight()) {
+		cerr << base << ".ppm: golden image is " << golden.getWidth() << "x" << golden.getHeight() << endl;
+		result.status = "mismatch";
+		return result;
+	}
+
+	int channels = pixels.getNumChannels();
+	long long count = (long long)pixels.getWidth() * pixels.getHeight();
+	ofPixels diff;
+	diff.allocate(pixels.getWidth(), pixels.getHeight(), OF_IMAGE_COLOR);
+	for (long long k = 0; k < count; k++) {
+		int pixelDiff = 0;
+		for (int c = 0; c < 3; c++) {
+			int d = std::abs((int)pixels.getData()[k * channels + c] - (int)golden.getData()[k * 3 + c]);
+			diff.getData()[k * 3 + c] = std::min(d * 16, 255);
+			pixelDiff = std::max(pixelDiff, d);
+		}
+		result.maxDiff = std::max(result.maxDiff, pixelDiff);
+		if (pixelDiff > tolerance) result.diffPixels++;
+	}
+	result.status = result.diffPixels ? "mismatch" : "match";
+	if (result.diffPixels) ImageWriter::savePpm(base + ".diff.ppm", diff);
+	return result;
+}
+
+//  one scene at one resolution and thread count
+//
+struct SuiteResult {
+	string scene;
+	int width, height, threads;
+	double msPerFrame;			// median over the timed frames
+	double minMs;
+	long long rays;				// primary, anti-aliasing and shadow rays per frame
+	double raysPerSecond;
+	long long peakRssKb;		// of the process, so far
+	GoldenResult golden;
+};
+
+//--------------------------------------------------------------
+static bool parseList(const string& text, vector<int>& values) {
+	values.clear();
+	for (const string& item : ofSplitString(text, ",", true, true)) {
+		int value = ofToInt(item);
+		if (value <= 0) return false;
+		values.push_back(value);
+	}
+	return !values.empty();
+}
+
+static bool parseResolutions(const string& text, vector<glm::ivec2>& sizes) {
+	sizes.clear();
+	for (const string& item : ofSplitString(text, ",", true, true)) {
+		vector<string> wh = ofSplitString(item, "x");
+		if (wh.size() != 2 || ofToInt(wh[0]) <= 0 || ofToInt(wh[1]) <= 0) return false;
+		sizes.push_back(glm::ivec2(ofToInt(wh[0]), ofToInt(wh[1])));
+	}
+	return !sizes.empty();
+}
+
+static void suiteUsage() {
+	cerr << "usage: benchmark --suite [--scenes a,b] [--resolutions 320x200,640x400] [--threads 1,8]" << endl;
+	cerr << "                         [--frames n] [--json file] [--golden dir] [--update-golden] [--tolerance t]" << endl;
+	cerr << "  --scenes         scenes to run (default all):";
+	for (const BenchmarkScene& scene : benchmarkScenes()) cerr << " " << scene.name;
+	cerr << endl;
+	cerr << "  --resolutions    image sizes to sweep (default 320x200,640x400,1280x800)" << endl;
+	cerr << "  --threads        thread counts to sweep (default 1 and one per hardware thread)" << endl;
+	cerr << "  --frames         timed frames per case, after one warm-up frame (default 3)" << endl;
+	cerr << "  --json           results file (default benchmark.json)" << endl;
+	cerr << "  --golden         directory of golden images; each is created the first time its case runs" << endl;
+	cerr << "  --update-golden  rewrites the golden images instead of checking them" << endl;
+	cerr << "  --tolerance      largest channel difference that still matches (default 0)" << endl;
+}
+
+//--------------------------------------------------------------
+static bool saveSuiteJson(const string& path, const vector<SuiteResult>& results, int frames) {
+	std::ofstream out(path);
+	if (!out) {
+		cerr << path << ": cannot write" << endl;
+		return false;
+	}
+	out << "{\n";
+	out << "  \"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n";
+	out << "  \"frames\": " << frames << ",\n";
+	out << "  \"results\": [";
+	for (int k = 0; k < results.size(); k++) {
+		const SuiteResult& r = results[k];
+		out << (k ? ",\n" : "\n") << "    { \"scene\": \"" << r.scene << "\", \"width\": " << r.width << ", \"height\": " << r.height
+			<< ", \"threads\": " << r.threads << ", \"msPerFrame\": " << r.msPerFrame << ", \"minMs\": " << r.minMs
+			<< ", \"rays\": " << r.rays << ", \"raysPerSecond\": " << (long long)r.raysPerSecond << ", \"peakRssKb\": " << r.peakRssKb
+			<< ", \"golden\": \"" << r.golden.status << "\", \"maxDiff\": " << r.golden.maxDiff << ", \"diffPixels\": " << r.golden.diffPixels << " }";
+	}
+	out << "\n  ]\n}\n";
+	return (bool)out;
+}
+
+//--------------------------------------------------------------
+int runBenchmarkSuite(int argc, char* argv[]) {
+	vector<const BenchmarkScene*> scenes;
+	vector<glm::ivec2> resolutions = { glm::ivec2(320, 200), glm::ivec2(640, 400), glm::ivec2(1280, 800) };
+	vector<int> threadCounts = { 1 };
+	int hardware = std::thread::hardware_concurrency();
+	if (hardware > 1) threadCounts.push_back(hardware);
+	int frames = 3;
+	int tolerance = 0;
+	string jsonPath = "benchmark.json";
+	string goldenDir;
+	bool updateGolden = false;
+
+	for (int i = 0; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--help" || arg == "-h") {
+			suiteUsage();
+			return 0;
+		}
+		if (arg == "--update-golden") {
+			updateGolden = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			suiteUsage();
+			return 2;
+		}
+		string value = argv[++i];
+		bool ok = true;
+		if (arg == "--scenes") {
+			for (const string& name : ofSplitString(value, ",", true, true)) {
+				auto found = std::find_if(benchmarkScenes().begin(), benchmarkScenes().end(), [&](const BenchmarkScene& s) { return name == s.name; });
+				ok &= found != benchmarkScenes().end();
+				if (ok) scenes.push_back(&*found);
+			}
+		}
+		else if (arg == "--resolutions") ok = parseResolutions(value, resolutions);
+		else if (arg == "--threads") ok = parseList(value, threadCounts);
+		else if (arg == "--frames") ok = (frames = ofToInt(value)) > 0;
+		else if (arg == "--json") jsonPath = value;
+		else if (arg == "--golden") goldenDir = value;
+		else if (arg == "--tolerance") ok = (tolerance = ofToInt(value)) >= 0;
+		else ok = false;
+		if (!ok) {
+			cerr << "bad value for " << arg << ": " << value << endl;
+			suiteUsage();
+			return 2;
+		}
+	}
+	if (scenes.empty()) {
+		for (const BenchmarkScene& scene : benchmarkScenes()) scenes.push_back(&scene);
+	}
+
+	RenderProfiler& profiler = renderProfiler();
+	vector<SuiteResult> results;
+	bool mismatch = false;
+	cout << "scene\twidth\theight\tthreads\tms/frame\tmin ms\trays/frame\tMrays/s\tpeak RSS KB\tgolden" << endl;
+	for (const BenchmarkScene* scene : scenes) {
+		SceneStore store;
+		scene->build(store);
+		for (glm::ivec2 size : resolutions) {
+			for (int threads : threadCounts) {
+				RenderCam cam;
+				cam.setAspect((float)size.x / size.y);
+
+				RayTracer tracer(store.scene, store.light, cam);
+				tracer.numThreads = threads;
+				tracer.lightSamples = scene->lightSamples;
+				tracer.incremental = false;
+				RadianceBuffer radiance;
+				radiance.allocate(size.x, size.y);
+				tracer.render(radiance);								// warm-up, builds the BVH
+
+				//one profiled frame for the ray count, which every frame shares
+				profiler.setEnabled(true);
+				profiler.reset();
+				tracer.render(radiance);
+				RenderProfiler::Totals totals = profiler.totals();
+				profiler.setEnabled(false);
+
+				vector<double> ms;
+				for (int f = 0; f < frames; f++) {
+					auto start = Clock::now();
+					tracer.render(radiance);
+					ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+				}
+				std::sort(ms.begin(), ms.end());
+
+				SuiteResult r;
+				r.scene = scene->name;
+				r.width = size.x;
+				r.height = size.y;
+				r.threads = threads;
+				r.msPerFrame = ms[ms.size() / 2];
+				r.minMs = ms[0];
+				r.rays = totals.counts[PROFILE_PRIMARY_RAYS] + totals.counts[PROFILE_SHADOW_RAYS] + totals.counts[PROFILE_SECONDARY_RAYS];
+				r.raysPerSecond = r.rays / (r.msPerFrame / 1000);
+				r.peakRssKb = peakRssKb();
+
+				ofPixels pixels;
+				radiance.toPixels(pixels);
+				r.golden = checkGolden(goldenDir, scene->name, pixels, tolerance, updateGolden);
+				mismatch |= r.golden.status == "mismatch";
+				results.push_back(r);
+
+				cout << r.scene << "\t" << r.width << "\t" << r.height << "\t" << r.threads << "\t" << r.msPerFrame << "\t" << r.minMs
+					<< "\t" << r.rays << "\t" << r.raysPerSecond / 1e6 << "\t" << r.peakRssKb << "\t" << r.golden.status;
+				if (r.golden.status == "mismatch") cout << " (" << r.golden.diffPixels << " pixels, max diff " << r.golden.maxDiff << ")";
+				cout << endl;
+			}
+		}
+	}
+
+	if (!saveSuiteJson(jsonPath, results, frames)) return 1;
+	if (mismatch) {
+		cerr << "rendered images differ from the golden images in " << goldenDir << endl;
+		return 1;
+	}
+	return 0;
+}
+
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "sceneStore.h"
+
+//  Reproducible benchmark suite: renders a fixed set of canonical scenes
+//  at every requested resolution and thread count and reports ms/frame,
+//  rays/sec and peak RSS as a table and as JSON, so two builds can be
+//  compared run against run.  Every frame is also checked against a
+//  golden image, so a speed change that alters pixels fails the run.
+//
+//  usage: benchmark --suite [--scenes a,b] [--resolutions 320x200,640x400] [--threads 1,8]
+//                           [--frames n] [--json file] [--golden dir] [--update-golden] [--tolerance t]
+//
+
+//  one canonical scene; build fills an empty store
+//
+struct BenchmarkScene {
+	const char* name;
+	const char* description;
+	void (*build)(SceneStore& store);
+	int lightSamples = 0;			// RayTracer::lightSamples to render it with
+};
+
+//  default, spheres-1k, spheres-10k, spheres-100k, lights, textured,
+//  untextured, mirrors, spots-256, spots-256-sampled, sdf-helix,
+//  mesh-knot and forest-1m, in that order
+//
+const vector<BenchmarkScene>& benchmarkScenes();
+
+//  count random spheres in front of the camera, seeded so every run
+//  traces the same field
+//
+void buildSphereField(SceneStore& store, int count);
+
+//  the process's peak resident set so far, in kilobytes
+//
+long long peakRssKb();
+
+//  runs the suite with the arguments after --suite; returns the process
+//  exit code, nonzero if an argument is bad or an image differs from its
+//  golden image
+//
+int runBenchmarkSuite(int argc, char* argv[]);
@@ -0,0 +1,461 @@
+#include "bvh.h"
+#include "renderProfiler.h"
+
+#include <algorithm>
+
+//  number of centroid bins evaluated per split
+//
+static const int numBins = 12;
+
+//--------------------------------------------------------------
+//slab test, returns the entry distance along the ray in tNear
+//
+static bool intersectBox(const AABB& box, const glm::vec3& origin, const glm::vec3& invDir, float tMin, float tMax, float& tNear) {
+	glm::vec3 t0 = (box.min - origin) * invDir;
+	glm::vec3 t1 = (box.max - origin) * invDir;
+	float tEnter = std::max(std::max(std::min(t0.x, t1.x), std::min(t0.y, t1.y)), std::min(t0.z, t1.z));
+	float tExit = std::min(std::min(std::max(t0.x, t1.x), std::max(t0.y, t1.y)), std::max(t0.z, t1.z));
+	tNear = std::max(tEnter, tMin);
+	return tNear <= std::min(tExit, tMax);
+}
+
+//  Tests made by one query, counted in registers and handed to the
+//  profiler once when the query returns
+//
+struct QueryCounts {
+	int boxes = 0;
+	int spheres = 0;
+	int planes = 0;
+
+	~QueryCounts() {
+		RenderProfiler& profiler = renderProfiler();
+		if (!profiler.isEnabled()) return;
+		ProfileThread& thread = profiler.local();
+		thread.counts[PROFILE_BOX_TESTS] += boxes;
+		thread.counts[PROFILE_SPHERE_TESTS] += spheres;
+		thread.counts[PROFILE_PLANE_TESTS] += planes;
+	}
+	//SDF objects, meshes and instance sets count their own steps,
+	//triangles and boxes
+	void primitive(const SceneObject* object, int rays = 1) {
+		if (object->type == OBJECT_SPHERE) spheres += rays;
+		else if (object->type == OBJECT_PLANE) planes += rays;
+	}
+};
+
+//--------------------------------------------------------------
+//rebuilds the tree from scratch over the current object vector
+//
+void BVH::build(const vector<SceneObject*>& objects) {
+	this->objects = &objects;
+	nodes.clear();
+	primitives.clear();
+	unbounded.clear();
+
+	vector<AABB> primBounds(objects.size());
+	vector<glm::vec3> centroids(objects.size());
+	for (int i = 0; i < objects.size(); i++) {
+		primBounds[i] = objects[i]->getBounds();
+		if (primBounds[i].isBounded()) {
+			centroids[i] = primBounds[i].center();
+			primitives.push_back(i);
+		}
+		else {
+			unbounded.push_back(i);
+		}
+	}
+
+	if (primitives.size() > 0) {
+		nodes.reserve(2 * primitives.size());
+		buildNode(0, primitives.size(), 0, primBounds, centroids);
+	}
+
+	// move spheres to the front of each leaf and mirror them into the
+	// SoA arrays, slot for slot with the primitive list
+	//
+	for (int i = 0; i < nodes.size(); i++) {
+		BVHNode& node = nodes[i];
+		if (!node.isLeaf()) continue;
+		auto first = primitives.begin() + node.start;
+		auto spheresEnd = std::stable_partition(first, first + node.count,
+			[&](int prim) { return objects[prim]->type == OBJECT_SPHERE; });
+		node.sphereCount = spheresEnd - first;
+	}
+	spheres.clear();
+	for (int i = 0; i < primitives.size(); i++) {
+		SceneObject* obj = objects[primitives[i]];
+		spheres.add(obj->position, obj->radius, primitives[i]);
+	}
+	spheres.pad();
+}
+
+//--------------------------------------------------------------
+//builds the subtree over primitives[start, end) and returns its index
+//
+int BVH::buildNode(int start, int end, int depth, const vector<AABB>& primBounds, const vector<glm::vec3>& centroids) {
+	int index = nodes.size();
+	nodes.push_back(BVHNode());
+
+	AABB bounds, centroidBounds;
+	for (int i = start; i < end; i++) {
+		bounds.grow(primBounds[primitives[i]]);
+		centroidBounds.grow(centroids[primitives[i]]);
+	}
+	nodes[index].bounds = bounds;
+
+	int count = end - start;
+	glm::vec3 extent = centroidBounds.extent();
+	int axis = 0;
+	if (extent.y > extent[axis]) axis = 1;
+	if (extent.z > extent[axis]) axis = 2;
+
+	if (count <= 1 || extent[axis] <= 0) {
+		nodes[index].start = start;
+		nodes[index].count = count;
+		return index;
+	}
+
+	// bin centroids along the widest axis and sweep for the cheapest split
+	//
+	int binCount[numBins] = { 0 };
+	AABB binBounds[numBins];
+	float scale = numBins / extent[axis];
+	auto binOf = [&](int prim) {
+		int b = (centroids[prim][axis] - centroidBounds.min[axis]) * scale;
+		return std::min(b, numBins - 1);
+	};
+	for (int i = start; i < end; i++) {
+		int b = binOf(primitives[i]);
+		binCount[b]++;
+		binBounds[b].grow(primBounds[primitives[i]]);
+	}
+
+	float rightArea[numBins];
+	int rightCount[numBins];
+	AABB sweep;
+	int n = 0;
+	for (int b = numBins - 1; b > 0; b--) {
+		sweep.grow(binBounds[b]);
+		n += binCount[b];
+		rightArea[b] = sweep.area();
+		rightCount[b] = n;
+	}
+
+	float bestCost = FLT_MAX;
+	int bestSplit = -1;
+	sweep = AABB();
+	n = 0;
+	for (int b = 0; b < numBins - 1; b++) {
+		sweep.grow(binBounds[b]);
+		n += binCount[b];
+		if (n == 0 || rightCount[b + 1] == 0) continue;
+		float cost = sweep.area() * n + rightArea[b + 1] * rightCount[b + 1];
+		if (cost < bestCost) {
+			bestCost = cost;
+			bestSplit = b;
+		}
+	}
+
+	// leaf when splitting does not pay for the extra traversal step
+	//
+	float leafCost = bounds.area() * count;
+	float splitCost = bounds.area() + bestCost;
+	if (count <= maxLeafSize && (bestSplit < 0 || leafCost <= splitCost)) {
+		nodes[index].start = start;
+		nodes[index].count = count;
+		return index;
+	}
+
+	int mid;
+	if (bestSplit < 0 || depth >= maxDepth) {
+		// no useful SAH split, or the tree is getting too deep for the
+		// traversal stack: fall back to a median split
+		//
+		mid = (start + end) / 2;
+		std::nth_element(primitives.begin() + start, primitives.begin() + mid, primitives.begin() + end,
+			[&](int a, int b) { return centroids[a][axis] < centroids[b][axis]; });
+	}
+	else {
+		mid = std::partition(primitives.begin() + start, primitives.begin() + end,
+			[&](int prim) { return binOf(prim) <= bestSplit; }) - primitives.begin();
+	}
+
+	buildNode(start, mid, depth + 1, primBounds, centroids);
+	int right = buildNode(mid, end, depth + 1, primBounds, centroids);
+	nodes[index].start = right;
+	nodes[index].count = 0;
+	return index;
+}
+
+//--------------------------------------------------------------
+//recomputes node bounds after objects moved or changed size, keeping
+//the tree topology.  Children always follow their parent in the node
+//array, so one reverse sweep updates every node bottom-up.
+//
+void BVH::refit() {
+	if (!objects) return;
+	for (int i = nodes.size() - 1; i >= 0; i--) {
+		BVHNode& node = nodes[i];
+		AABB bounds;
+		if (node.isLeaf()) {
+			for (int k = node.start; k < node.start + node.count; k++) {
+				SceneObject* obj = (*objects)[primitives[k]];
+				bounds.grow(obj->getBounds());
+				if (k < node.start + node.sphereCount) spheres.set(k, obj->position, obj->radius);
+			}
+		}
+		else {
+			bounds.grow(nodes[i + 1].bounds);
+			bounds.grow(nodes[node.start].bounds);
+		}
+		node.bounds = bounds;
+	}
+}
+
+//--------------------------------------------------------------
+//expected cost of a random ray relative to testing the root box,
+//used to decide when a refitted tree has degraded enough to rebuild
+//
+float BVH::sahCost() const {
+	if (nodes.size() == 0) return 0;
+	float cost = 0;
+	for (int i = 0; i < nodes.size(); i++) {
+		const BVHNode& node = nodes[i];
+		cost += node.bounds.area() * (node.isLeaf() ? node.count : 1);
+	}
+	return cost / std::max(nodes[0].bounds.area(), FLT_MIN);
+}
+
+//--------------------------------------------------------------
+//tests one object and keeps the hit if it is the closest so far
+//
+bool BVH::intersectPrimitive(int index, const Ray& ray, float tMin, HitRecord& hit) const {
+	if (!(*objects)[index]->intersect(ray, tMin, hit)) return false;
+	hit.objectIndex = index;
+	return true;
+}
+
+//--------------------------------------------------------------
+//fills in point and normal once a sphere kernel reported the closest
+//hit, the same way Sphere::intersect does
+//
+void BVH::sphereHit(int slot, const Ray& ray, HitRecord& hit) const {
+	glm::vec3 center = glm::vec3(spheres.cx[slot], spheres.cy[slot], spheres.cz[slot]);
+	Sphere* sphere = static_cast<Sphere*>((*objects)[spheres.id[slot]]);
+	hit.objectIndex = spheres.id[slot];
+	hit.point = ray.p + ray.d * hit.t;
+	hit.normal = glm::normalize((hit.point - center) / sphere->radius);
+	hit.uv = sphere->Sphere::getUV(hit.point, hit.normal);
+}
+
+//--------------------------------------------------------------
+//closest hit along the ray, nearer than hit.t on entry
+//distances are measured along the normalized ray direction
+//
+bool BVH::intersect(const Ray& ray, HitRecord& hit) const {
+	if (!objects) return false;
+	Ray r = Ray(ray.p, glm::normalize(ray.d));
+	glm::vec3 invDir = 1.0f / r.d;
+	bool found = false;
+	int sphereSlot = -1;
+	QueryCounts counts;
+
+	for (int i = 0; i < unbounded.size(); i++) {
+		counts.primitive((*objects)[unbounded[i]]);
+		found |= intersectPrimitive(unbounded[i], r, 0, hit);
+	}
+
+	if (nodes.size() == 0) return found;
+
+	int stack[stackSize];
+	int top = 0;
+	float tNear;
+	counts.boxes++;
+	if (intersectBox(nodes[0].bounds, r.p, invDir, 0, hit.t, tNear)) stack[top++] = 0;
+
+	while (top > 0) {
+		const BVHNode& node = nodes[stack[--top]];
+		if (node.isLeaf()) {
+			if (node.sphereCount > 0) {
+				counts.spheres += node.sphereCount;
+				int slot = kernels->intersectRay(spheres, node.start, node.sphereCount, r.p, r.d, 0, hit.t);
+				if (slot >= 0) sphereSlot = slot;
+			}
+			for (int k = node.start + node.sphereCount; k < node.start + node.count; k++) {
+				counts.primitive((*objects)[primitives[k]]);
+				if (intersectPrimitive(primitives[k], r, 0, hit)) {
+					found = true;
+					sphereSlot = -1;
+				}
+			}
+			continue;
+		}
+
+		// visit the nearer child first so the far one can be culled
+		//
+		int left = &node - &nodes[0] + 1;
+		int right = node.start;
+		float tLeft, tRight;
+		counts.boxes += 2;
+		bool hitLeft = intersectBox(nodes[left].bounds, r.p, invDir, 0, hit.t, tLeft);
+		bool hitRight = intersectBox(nodes[right].bounds, r.p, invDir, 0, hit.t, tRight);
+		if (hitLeft && hitRight) {
+			if (tLeft < tRight) {
+				stack[top++] = right;
+				stack[top++] = left;
+			}
+			else {
+				stack[top++] = left;
+				stack[top++] = right;
+			}
+		}
+		else if (hitLeft) stack[top++] = left;
+		else if (hitRight) stack[top++] = right;
+	}
+
+	if (sphereSlot >= 0) {
+		sphereHit(sphereSlot, r, hit);
+		found = true;
+	}
+	return found;
+}
+
+//--------------------------------------------------------------
+//true as soon as anything lies between tMin and tMax along the ray
+//
+bool BVH::occluded(const Ray& ray, float tMin, float tMax) const {
+	if (!objects) return false;
+	Ray r = Ray(ray.p, glm::normalize(ray.d));
+	glm::vec3 invDir = 1.0f / r.d;
+	QueryCounts counts;
+
+	for (int i = 0; i < unbounded.size(); i++) {
+		counts.primitive((*objects)[unbounded[i]]);
+		if ((*objects)[unbounded[i]]->occludes(r, tMin, tMax)) return true;
+	}
+
+	if (nodes.size() == 0) return false;
+
+	int stack[stackSize];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const BVHNode& node = nodes[stack[--top]];
+		float tNear;
+		counts.boxes++;
+		if (!intersectBox(node.bounds, r.p, invDir, tMin, tMax, tNear)) continue;
+		if (node.isLeaf()) {
+			counts.spheres += node.sphereCount;
+			if (node.sphereCount > 0 && kernels->occludedRay(spheres, node.start, node.sphereCount, r.p, r.d, tMin, tMax)) return true;
+			for (int k = node.start + node.sphereCount; k < node.start + node.count; k++) {
+				counts.primitive((*objects)[primitives[k]]);
+				if ((*objects)[primitives[k]]->occludes(r, tMin, tMax)) return true;
+			}
+		}
+		else {
+			stack[top++] = node.start;
+			stack[top++] = &node - &nodes[0] + 1;
+		}
+	}
+	return false;
+}
+
+//--------------------------------------------------------------
+//packet traversal: a node is visited while any ray still reaches it,
+//leaf spheres are tested one at a time against all rays in SIMD
+//
+void BVH::intersectPacket(const Ray* rays, int count, HitRecord* hits) const {
+	RayPacket packet;
+	Ray r[RayPacket::maxSize];
+	glm::vec3 invDir[RayPacket::maxSize];
+	packet.size = count;
+	for (int k = 0; k < RayPacket::maxSize; k++) {
+		int src = std::min(k, count - 1);			// idle lanes repeat the last ray
+		r[k] = Ray(rays[src].p, glm::normalize(rays[src].d));
+		invDir[k] = 1.0f / r[k].d;
+		packet.ox[k] = r[k].p.x;
+		packet.oy[k] = r[k].p.y;
+		packet.oz[k] = r[k].p.z;
+		packet.dx[k] = r[k].d.x;
+		packet.dy[k] = r[k].d.y;
+		packet.dz[k] = r[k].d.z;
+		packet.tHit[k] = hits[src].t;
+		packet.hitSlot[k] = -1;
+	}
+	if (!objects) return;
+	QueryCounts counts;
+
+	// objects outside the tree are tested ray by ray, keeping the packet
+	// distances in step with the hit records
+	//
+	auto testPrimitive = [&](int prim) {
+		counts.primitive((*objects)[prim], count);
+		for (int k = 0; k < count; k++) {
+			hits[k].t = packet.tHit[k];
+			if (intersectPrimitive(prim, r[k], 0, hits[k])) {
+				packet.tHit[k] = hits[k].t;
+				packet.hitSlot[k] = -1;
+			}
+		}
+	};
+	for (int i = 0; i < unbounded.size(); i++) {
+		testPrimitive(unbounded[i]);
+	}
+
+	auto nearestEntry = [&](const AABB& box, float& tNear) {
+		counts.boxes += count;
+		bool any = false;
+		tNear = FLT_MAX;
+		for (int k = 0; k < count; k++) {
+			float t;
+			if (intersectBox(box, r[k].p, invDir[k], 0, packet.tHit[k], t)) {
+				any = true;
+				tNear = std::min(tNear, t);
+			}
+		}
+		return any;
+	};
+
+	int stack[stackSize];
+	int top = 0;
+	float tNear;
+	if (nodes.size() > 0 && nearestEntry(nodes[0].bounds, tNear)) stack[top++] = 0;
+
+	while (top > 0) {
+		int index = stack[--top];
+		const BVHNode& node = nodes[index];
+		if (node.isLeaf()) {
+			counts.spheres += node.sphereCount * count;
+			for (int k = node.start; k < node.start + node.sphereCount; k++) {
+				kernels->intersectPacket(spheres, k, packet);
+			}
+			for (int k = node.start + node.sphereCount; k < node.start + node.count; k++) {
+				testPrimitive(primitives[k]);
+			}
+			continue;
+		}
+
+		int left = index + 1;
+		int right = node.start;
+		float tLeft, tRight;
+		bool hitLeft = nearestEntry(nodes[left].bounds, tLeft);
+		bool hitRight = nearestEntry(nodes[right].bounds, tRight);
+		if (hitLeft && hitRight) {
+			if (tLeft < tRight) {
+				stack[top++] = right;
+				stack[top++] = left;
+			}
+			else {
+				stack[top++] = left;
+				stack[top++] = right;
+			}
+		}
+		else if (hitLeft) stack[top++] = left;
+		else if (hitRight) stack[top++] = right;
+	}
+
+	for (int k = 0; k < count; k++) {
+		hits[k].t = packet.tHit[k];
+		if (packet.hitSlot[k] >= 0) sphereHit(packet.hitSlot[k], r[k], hits[k]);
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "scene.h"
+#include "sphereKernels.h"
+
+//  Flattened BVH node.  Children of an interior node are stored at
+//  index + 1 (left) and at "start" (right); a leaf covers "count" entries
+//  of the primitive list beginning at "start", spheres first.
+//
+struct BVHNode {
+	AABB bounds;
+	int start = 0;
+	int count = 0;      // 0 for interior nodes
+	int sphereCount = 0;
+
+	bool isLeaf() const { return count > 0; }
+};
+
+//  Bounding volume hierarchy over a vector of scene objects, built with a
+//  binned surface area heuristic.  Objects with unbounded extent (planes
+//  that are only clipped along one axis) are kept in a separate list and
+//  tested against every ray.
+//
+//  Spheres in a leaf are mirrored into a SphereSoA laid out in the same
+//  order as the primitive list, so a whole leaf is tested with one call
+//  into the SIMD kernels picked for this CPU.
+//
+//  The BVH stores indices, not pointers, so hits report the index into
+//  the object vector it was built from.  Queries are const and safe to
+//  run from any number of threads once the tree is built.
+//
+class BVH {
+public:
+	void build(const vector<SceneObject*>& objects);
+	void refit();
+
+	bool intersect(const Ray& ray, HitRecord& hit) const;
+	bool occluded(const Ray& ray, float tMin, float tMax) const;
+
+	//  closest hits for up to RayPacket::maxSize coherent rays at once,
+	//  identical to calling intersect() on each ray
+	//
+	void intersectPacket(const Ray* rays, int count, HitRecord* hits) const;
+
+	void setKernels(const SphereKernels& k) { kernels = &k; }
+	const SphereKernels& getKernels() const { return *kernels; }
+
+	float sahCost() const;
+	int getNodeCount() const { return nodes.size(); }
+	int getUnboundedCount() const { return unbounded.size(); }
+
+	static const int maxLeafSize = 8;
+	static const int maxDepth = 48;
+	static const int stackSize = 128;
+
+private:
+	int buildNode(int start, int end, int depth, const vector<AABB>& primBounds, const vector<glm::vec3>& centroids);
+	bool intersectPrimitive(int index, const Ray& ray, float tMin, HitRecord& hit) const;
+	void sphereHit(int slot, const Ray& ray, HitRecord& hit) const;
+
+	const vector<SceneObject*>* objects = nullptr;
+	vector<BVHNode> nodes;
+	vector<int> primitives;		// object indices grouped by leaf
+	vector<int> unbounded;		// object indices tested linearly
+	SphereSoA spheres;			// parallel to primitives
+
+	const SphereKernels* kernels = &sphereKernels();
+};
@@ -0,0 +1,22 @@
+#include "frameCache.h"
+
+//--------------------------------------------------------------
+//sizes the buffers for a width x height frame lit by numLights lights,
+//with a plane per light if they all fit in planeBudget and none if not
+//keeps the storage if nothing changed; the cache is invalid afterwards
+//
+void FrameCache::allocate(int width, int height, int numLights) {
+	valid = false;
+	size_t pixels = (size_t)width * height;
+	int planes = pixels * numLights * sizeof(glm::vec3) <= planeBudget ? numLights : 0;
+	if (matches(width, height, numLights) && numPlanes == planes) return;
+
+	this->width = width;
+	this->height = height;
+	this->numLights = numLights;
+	numPlanes = planes;
+	texels.resize(pixels);
+	contributions.resize(pixels * planes);
+	contributions.shrink_to_fit();
+	dirty.assign(pixels, 0);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "scene.h"
+
+//  What one pixel of the last full-resolution frame saw along its centre
+//  ray: the closest hit, the material found there and the shaded result.
+//  Background pixels have objectIndex -1 and black radiance.
+//
+struct GBufferTexel {
+	glm::vec3 point;
+	glm::vec3 normal;
+	MaterialRecord material;
+	glm::vec3 radiance;
+	float t;
+	int objectIndex;
+};
+
+//  The parts of a scene object an edit can change, compared between frames
+//
+struct ObjectState {
+	AABB bounds;
+	ofColor diffuse;
+	ofColor specular;
+	float reflectivity;
+	float transparency;
+	float ior;
+	uint32_t edits;					// InstanceSet::getEdits(), 0 for other objects
+};
+
+//  Everything the incremental re-render keeps from the last finished
+//  frame:
+//
+//  - a G-buffer with one texel per pixel
+//  - one plane per light holding that light's contribution to each pixel,
+//    shadow included, so a single light can be reshaded on its own; a
+//    pixel's radiance is the sum of its planes, in light order.  The
+//    planes are kept only while all of them fit in planeBudget bytes;
+//    past it there are none and any light a pixel needs is retraced
+//  - the scene state the frame was rendered from, to find what changed
+//  - a per pixel dirty mask: retrace, or a bit for each light to reshade
+//
+//  The cache only describes the frame while isValid(); a full render
+//  invalidates it when it starts and validates it when it finishes.
+//
+class FrameCache {
+public:
+	void allocate(int width, int height, int numLights);
+	void invalidate() { valid = false; }
+	void validate() { valid = true; }
+
+	bool isValid() const { return valid; }
+	bool matches(int width, int height, int numLights) const {
+		return this->width == width && this->height == height && this->numLights == numLights;
+	}
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	int getNumLights() const { return numLights; }
+	int getNumPlanes() const { return numPlanes; }
+
+	GBufferTexel& at(int pixel) { return texels[pixel]; }
+	const GBufferTexel& at(int pixel) const { return texels[pixel]; }
+	glm::vec3& contribution(int light, int pixel) { return contributions[(size_t)light * width * height + pixel]; }
+
+	//  dirty bits of a pixel; lights past the last bit, or without a
+	//  plane, always retrace
+	//
+	static const unsigned int retrace = 1u << 31;
+	unsigned int lightBit(int light) const { return light < 31 && light < numPlanes ? 1u << light : retrace; }
+	unsigned int& dirtyAt(int pixel) { return dirty[pixel]; }
+	void clearDirty() { std::fill(dirty.begin(), dirty.end(), 0); }
+
+	//  scene state of the cached frame
+	//
+	vector<ObjectState> objects;
+	vector<LightRecord> lights;
+	glm::vec3 cameraPosition;
+	glm::vec3 viewPosition;
+	glm::vec3 viewUp;
+	glm::vec2 viewMin, viewMax;
+
+	size_t planeBudget = size_t(256) << 20;		// bytes the light planes may take, 256 MB
+
+private:
+	int width = 0;
+	int height = 0;
+	int numLights = 0;
+	int numPlanes = 0;
+	bool valid = false;
+
+	vector<GBufferTexel> texels;
+	vector<glm::vec3> contributions;
+	vector<unsigned int> dirty;
+};
@@ -0,0 +1,164 @@
+#include "imageWriter.h"
+#include "renderProfiler.h"
+
+#include "FreeImage.h"
+
+#include <fstream>
+
+ImageWriter::~ImageWriter() {
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		idle.wait(guard, [this]() { return !hasPending && !busy; });
+		quit = true;
+	}
+	wake.notify_all();
+	if (encoder.joinable()) encoder.join();
+}
+
+//--------------------------------------------------------------
+//queues a frame for the encoder thread, starting it on first use
+//
+void ImageWriter::write(const ofPixels& pixels, const RadianceBuffer& radiance) {
+	if (format == OUTPUT_NONE) return;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		pending.path = ofFilePath::getAbsolutePath(getPath(), false);
+		pending.format = format;
+		pending.pngCompression = pngCompression;
+		if (format == OUTPUT_PFM) pending.radiance = radiance;
+		else pending.pixels = pixels;
+		hasPending = true;
+
+		if (!encoder.joinable()) encoder = std::thread(&ImageWriter::encoderLoop, this);
+	}
+	wake.notify_one();
+}
+
+void ImageWriter::wait() {
+	std::unique_lock<std::mutex> guard(lock);
+	idle.wait(guard, [this]() { return !hasPending && !busy; });
+}
+
+//--------------------------------------------------------------
+//encoder thread: takes the pending frame, writes it outside the lock
+//
+void ImageWriter::encoderLoop() {
+	Job job;
+	std::unique_lock<std::mutex> guard(lock);
+	while (true) {
+		wake.wait(guard, [this]() { return hasPending || quit; });
+		if (quit) return;
+
+		std::swap(job, pending);
+		hasPending = false;
+		busy = true;
+		guard.unlock();
+
+		bool ok = save(job.path, job.format, job.pixels, job.radiance, job.pngCompression);
+		if (!ok) cerr << "could not write " << job.path << endl;
+
+		guard.lock();
+		succeeded = ok;
+		busy = false;
+		if (!hasPending) idle.notify_all();
+	}
+}
+
+//--------------------------------------------------------------
+//writes one frame in the given format; PFM takes the radiance, the
+//others the 8 bit pixels
+//
+bool ImageWriter::save(const string& path, OutputFormat format, const ofPixels& pixels, const RadianceBuffer& radiance, int pngCompression) {
+	ProfileScope encode(PROFILE_ENCODE);
+	switch (format) {
+	case OUTPUT_PNG:
+		return savePng(path, pixels, pngCompression);
+	case OUTPUT_PPM:
+		return savePpm(path, pixels);
+	case OUTPUT_PFM:
+		return radiance.savePfm(path);
+	default:
+		return true;
+	}
+}
+
+//--------------------------------------------------------------
+//PNG through FreeImage so the zlib level can be chosen (ofSaveImage
+//always uses the default); FreeImage wants BGR rows
+//
+bool ImageWriter::savePng(const string& path, const ofPixels& pixels, int compression) {
+	int width = pixels.getWidth();
+	int height = pixels.getHeight();
+	int channels = pixels.getNumChannels();
+	if (channels < 3) return false;
+
+	int pitch = width * 3;
+	vector<unsigned char> bgr(pitch * height);
+	const unsigned char* src = pixels.getData();
+	for (int k = 0; k < width * height; k++) {
+		bgr[k * 3 + 0] = src[k * channels + 2];
+		bgr[k * 3 + 1] = src[k * channels + 1];
+		bgr[k * 3 + 2] = src[k * channels + 0];
+	}
+
+	FIBITMAP* bitmap = FreeImage_ConvertFromRawBits(bgr.data(), width, height, pitch, 24,
+		FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, TRUE);
+	if (!bitmap) return false;
+
+	int flags = compression <= 0 ? PNG_Z_NO_COMPRESSION : std::min(compression, 9);
+	bool ok = FreeImage_Save(FIF_PNG, bitmap, path.c_str(), flags);
+	FreeImage_Unload(bitmap);
+	return ok;
+}
+
+//--------------------------------------------------------------
+//binary PPM, header and raw RGB rows
+//
+bool ImageWriter::savePpm(const string& path, const ofPixels& pixels) {
+	std::ofstream file(path, std::ios::binary);
+	if (!file) return false;
+
+	int width = pixels.getWidth();
+	int height = pixels.getHeight();
+	int channels = pixels.getNumChannels();
+	file << "P6\n" << width << " " << height << "\n255\n";
+	if (channels == 3) {
+		file.write((const char*)pixels.getData(), width * height * 3);
+	}
+	else {
+		for (int k = 0; k < width * height; k++) {
+			file.write((const char*)pixels.getData() + k * channels, 3);
+		}
+	}
+	return (bool)file;
+}
+
+const char* ImageWriter::extension(OutputFormat format) {
+	switch (format) {
+	case OUTPUT_PNG: return ".png";
+	case OUTPUT_PPM: return ".ppm";
+	case OUTPUT_PFM: return ".pfm";
+	default: return "";
+	}
+}
+
+const char* ImageWriter::name(OutputFormat format) {
+	switch (format) {
+	case OUTPUT_PNG: return "png";
+	case OUTPUT_PPM: return "ppm";
+	case OUTPUT_PFM: return "pfm";
+	default: return "none";
+	}
+}
+
+bool ImageWriter::parseFormat(const string& text, OutputFormat& format) {
+	string lower = ofToLower(text);
+	for (OutputFormat f : { OUTPUT_NONE, OUTPUT_PNG, OUTPUT_PPM, OUTPUT_PFM }) {
+		if (lower == name(f)) {
+			format = f;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "ofMain.h"
+#include "radianceBuffer.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+enum OutputFormat {
+	OUTPUT_NONE,
+	OUTPUT_PNG,             // 8 bit, zlib level pngCompression
+	OUTPUT_PPM,             // 8 bit binary, no compression at all
+	OUTPUT_PFM              // linear float radiance
+};
+
+//  Writes finished frames to disk on its own encoder thread, so neither
+//  the UI nor the next render waits for PNG compression.  write() copies
+//  only the buffer the chosen format needs and returns at once.  If frames
+//  arrive faster than they can be encoded, a queued frame that has not
+//  started yet is replaced by the newer one.
+//
+class ImageWriter {
+public:
+	~ImageWriter();
+
+	void write(const ofPixels& pixels, const RadianceBuffer& radiance);
+	void wait();                        // until everything queued is on disk
+	bool lastSucceeded() const { return succeeded; }
+
+	string getPath() const { return baseName + extension(format); }
+
+	OutputFormat format = OUTPUT_PNG;
+	int pngCompression = 6;             // 0 = stored, 1 = fastest ... 9 = smallest
+	string baseName = "output";
+
+	//  synchronous encoders, also used directly by the headless target
+	//
+	static bool save(const string& path, OutputFormat format, const ofPixels& pixels, const RadianceBuffer& radiance, int pngCompression = 6);
+	static bool savePng(const string& path, const ofPixels& pixels, int compression);
+	static bool savePpm(const string& path, const ofPixels& pixels);
+
+	static const char* extension(OutputFormat format);
+	static const char* name(OutputFormat format);
+	static bool parseFormat(const string& name, OutputFormat& format);
+
+private:
+	struct Job {
+		string path;
+		OutputFormat format;
+		int pngCompression;
+		ofPixels pixels;
+		RadianceBuffer radiance;
+	};
+
+	void encoderLoop();
+
+	std::thread encoder;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable idle;
+	Job pending;
+	bool hasPending = false;
+	bool busy = false;
+	bool quit = false;
+	bool succeeded = true;
+};
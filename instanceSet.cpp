@@ -0,0 +1,277 @@
+#include "instanceSet.h"
+#include "renderProfiler.h"
+
+#include <algorithm>
+
+//--------------------------------------------------------------
+//a ray in an instance's frame; the inverse of rotation times scale is
+//its transpose over the scale squared
+//
+static Ray toInstance(const Instance& instance, const glm::vec3& origin, const glm::vec3& direction) {
+	glm::mat3 toLocal = glm::transpose(instance.toWorld) / (instance.scale * instance.scale);
+	return Ray(toLocal * (origin - instance.position), toLocal * direction);
+}
+
+//--------------------------------------------------------------
+int InstanceSet::addGeometry(std::shared_ptr<const TriangleMesh> mesh, const string& path) {
+	geometries.push_back(mesh);
+	geometryPaths.push_back(path);
+	return geometries.size() - 1;
+}
+
+//--------------------------------------------------------------
+int InstanceSet::addMaterial(const InstanceMaterial& material) {
+	materials.push_back(material);
+	return materials.size() - 1;
+}
+
+//--------------------------------------------------------------
+//instance.geometry must number a geometry already added
+//
+void InstanceSet::add(Instance instance) {
+	instance.update();
+	instances.push_back(instance);
+	editedBounds.grow(instanceBounds(instances.size() - 1));
+	edits++;
+}
+
+//--------------------------------------------------------------
+//the geometry's box rotated and scaled, the same way as an SDF
+//primitive's
+//
+AABB InstanceSet::instanceBounds(int i) const {
+	const Instance& instance = instances[i];
+	const TriangleMesh& mesh = *geometries[instance.geometry];
+	if (mesh.getNumTriangles() == 0) return AABB(instance.position, instance.position);
+
+	const AABB& box = mesh.getBounds();
+	const glm::mat3& m = instance.toWorld;
+	glm::vec3 center = instance.position + m * box.center();
+	glm::vec3 half = box.extent() * .5f;
+	half = glm::abs(m[0]) * half.x + glm::abs(m[1]) * half.y + glm::abs(m[2]) * half.z;
+	return AABB(center - half, center + half);
+}
+
+//--------------------------------------------------------------
+//the top level over every instance; the geometries keep their trees
+//
+void InstanceSet::build() {
+	int count = instances.size();
+	vector<MeshTreeRef> refs(count);
+	for (int i = 0; i < count; i++) {
+		refs[i].bounds = instanceBounds(i);
+		refs[i].index = i;
+	}
+	buildMeshTree(refs, nodes, maxLeafSize, maxDepth);
+	nodes.shrink_to_fit();
+
+	order.resize(count);
+	for (int i = 0; i < count; i++) order[i] = refs[i].index;
+	leafOf.resize(count);
+	for (int n = 0; n < nodes.size(); n++) {
+		const MeshNode& node = nodes[n];
+		for (uint32_t k = node.start; k < node.start + node.count; k++) leafOf[order[k]] = n;
+	}
+	bounds = count > 0 ? nodes[0].bounds : AABB();
+}
+
+//--------------------------------------------------------------
+void InstanceSet::refitLeaf(int n) {
+	MeshNode& node = nodes[n];
+	AABB box;
+	for (uint32_t k = node.start; k < node.start + node.count; k++) box.grow(instanceBounds(order[k]));
+	node.bounds = box;
+}
+
+//--------------------------------------------------------------
+//refits the leaf holding the instance and the nodes on the way down to
+//it, which are found without parent links: the left subtree of a node
+//holds every node numbered below its right child
+//
+void InstanceSet::moveInstance(int i, glm::vec3 position) {
+	editedBounds.grow(instanceBounds(i));
+	instances[i].position = position;
+	editedBounds.grow(instanceBounds(i));
+	edits++;
+	if (i >= leafOf.size()) return;			// not in the tree until the next build()
+
+	uint32_t leaf = leafOf[i];
+	int path[stackSize];
+	int depth = 0;
+	uint32_t n = 0;
+	while (n != leaf) {
+		path[depth++] = n;
+		n = leaf < nodes[n].start ? n + 1 : nodes[n].start;
+	}
+	refitLeaf(leaf);
+	while (depth > 0) {
+		MeshNode& node = nodes[path[--depth]];
+		AABB box = (&node + 1)->bounds;
+		box.grow(nodes[node.start].bounds);
+		node.bounds = box;
+	}
+	bounds = nodes[0].bounds;
+}
+
+//--------------------------------------------------------------
+//nearer child first, as in TriangleMesh::intersect; each instance's
+//geometry narrows hit.t itself, and the normal of the closest is taken
+//back out of its frame at the end
+//
+bool InstanceSet::intersect(const Ray& ray, float tMin, HitRecord& hit) {
+	if (nodes.empty()) return false;
+	glm::vec3 origin = ray.p - position;
+	glm::vec3 invDir = 1.0f / ray.d;
+
+	int best = -1;
+	glm::vec3 normal;
+	long long boxes = 1;
+	int stack[stackSize];
+	int top = 0;
+	float tNear;
+	if (intersectMeshBox(nodes[0].bounds, origin, invDir, tMin, hit.t, tNear)) stack[top++] = 0;
+
+	while (top > 0) {
+		const MeshNode& node = nodes[stack[--top]];
+		if (node.isLeaf()) {
+			for (uint32_t k = node.start; k < node.start + node.count; k++) {
+				const Instance& instance = instances[order[k]];
+				if (geometries[instance.geometry]->intersect(toInstance(instance, origin, ray.d), tMin, hit)) {
+					best = order[k];
+					normal = hit.normal;
+				}
+			}
+			continue;
+		}
+
+		int left = &node - &nodes[0] + 1;
+		int right = node.start;
+		float tLeft = 0, tRight = 0;
+		boxes += 2;
+		bool hitLeft = intersectMeshBox(nodes[left].bounds, origin, invDir, tMin, hit.t, tLeft);
+		bool hitRight = intersectMeshBox(nodes[right].bounds, origin, invDir, tMin, hit.t, tRight);
+		if (hitLeft && hitRight) {
+			if (tLeft < tRight) {
+				stack[top++] = right;
+				stack[top++] = left;
+			}
+			else {
+				stack[top++] = left;
+				stack[top++] = right;
+			}
+		}
+		else if (hitLeft) stack[top++] = left;
+		else if (hitRight) stack[top++] = right;
+	}
+	renderProfiler().count(PROFILE_BOX_TESTS, boxes);
+	if (best < 0) return false;
+
+	hit.point = ray.p + ray.d * hit.t;
+	hit.normal = glm::normalize(instances[best].toWorld * normal);
+	hit.uv = glm::vec2(0);
+	hit.instance = best;
+	return true;
+}
+
+//--------------------------------------------------------------
+//true as soon as any instance's geometry lies between tMin and tMax
+//
+bool InstanceSet::occludes(const Ray& ray, float tMin, float tMax) {
+	if (nodes.empty()) return false;
+	glm::vec3 origin = ray.p - position;
+	glm::vec3 invDir = 1.0f / ray.d;
+
+	long long boxes = 0;
+	bool blocked = false;
+	int stack[stackSize];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0 && !blocked) {
+		const MeshNode& node = nodes[stack[--top]];
+		float tNear;
+		boxes++;
+		if (!intersectMeshBox(node.bounds, origin, invDir, tMin, tMax, tNear)) continue;
+		if (node.isLeaf()) {
+			for (uint32_t k = node.start; k < node.start + node.count && !blocked; k++) {
+				const Instance& instance = instances[order[k]];
+				blocked = geometries[instance.geometry]->occluded(toInstance(instance, origin, ray.d), tMin, tMax);
+			}
+		}
+		else {
+			stack[top++] = node.start;
+			stack[top++] = &node - &nodes[0] + 1;
+		}
+	}
+	renderProfiler().count(PROFILE_BOX_TESTS, boxes);
+	return blocked;
+}
+
+//--------------------------------------------------------------
+int InstanceSet::pick(const Ray& ray) {
+	HitRecord hit;
+	if (!intersect(Ray(ray.p, glm::normalize(ray.d)), 0, hit)) return -1;
+	return hit.instance;
+}
+
+//--------------------------------------------------------------
+//point and normal form, for picking in the GUI; ray.d need not be
+//normalized
+//
+bool InstanceSet::intersect(const Ray& ray, glm::vec3& point, glm::vec3& normal) {
+	HitRecord hit;
+	if (!intersect(Ray(ray.p, glm::normalize(ray.d)), 0, hit)) return false;
+	point = hit.point;
+	normal = hit.normal;
+	return true;
+}
+
+//--------------------------------------------------------------
+AABB InstanceSet::getBounds() {
+	if (nodes.empty()) return AABB(position, position);
+	return AABB(bounds.min + position, bounds.max + position);
+}
+
+//--------------------------------------------------------------
+//the material the hit instance names, mirror and glass settings
+//included
+//
+MaterialRecord InstanceSet::getMaterial(const HitRecord& hit, float footprint) {
+	if (hit.instance < 0 || instances[hit.instance].material >= materials.size()) {
+		return MaterialRecord{ toRadiance(diffuseColor), toRadiance(specularColor), reflectivity, transparency, ior };
+	}
+	const InstanceMaterial& material = materials[instances[hit.instance].material];
+	return MaterialRecord{ toRadiance(material.diffuse), toRadiance(material.specular), material.reflectivity, material.transparency, material.ior };
+}
+
+//--------------------------------------------------------------
+//every instance's box while there are few enough to be worth drawing,
+//the box around them all otherwise
+//
+void InstanceSet::draw() {
+	if (isSelected) {
+		ofNoFill();
+	}
+	else {
+		ofFill();
+	}
+	auto drawBox = [&](const AABB& box) {
+		glm::vec3 size = box.extent();
+		ofDrawBox(box.center() + position, size.x, size.y, size.z);
+	};
+	if (instances.size() > maxDrawnInstances) {
+		ofNoFill();
+		if (!nodes.empty()) drawBox(bounds);
+		return;
+	}
+	for (int i = 0; i < instances.size(); i++) drawBox(instanceBounds(i));
+}
+
+//--------------------------------------------------------------
+//the instances and the top level, not the geometries, which other sets
+//and mesh objects may share
+//
+size_t InstanceSet::getMemoryBytes() const {
+	return instances.capacity() * sizeof(Instance) + nodes.capacity() * sizeof(MeshNode) +
+		order.capacity() * sizeof(uint32_t) + leafOf.capacity() * sizeof(uint32_t) +
+		materials.capacity() * sizeof(InstanceMaterial);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "triangleMesh.h"
+
+//  Surface of the instances that name it in an InstanceSet
+//
+struct InstanceMaterial {
+	ofColor diffuse = ofColor::lightGray;
+	ofColor specular = ofColor::lightGray;
+	float reflectivity = 0;			// as in SceneObject
+	float transparency = 0;
+	float ior = 1.5;
+};
+
+//  One placement of a shared geometry: rotated about x, then y, then z by
+//  rotation (degrees), scaled by scale and moved to position, relative to
+//  the set.  geometry and material number entries of the set's tables.
+//  72 bytes.
+//
+struct Instance {
+	glm::vec3 position = glm::vec3(0);
+	glm::vec3 rotation = glm::vec3(0);
+	float scale = 1;
+	uint32_t geometry = 0;
+	uint32_t material = 0;
+
+	glm::mat3 toWorld;				// rotation times scale, from update()
+
+	void update() { toWorld = eulerRotation(rotation) * scale; }
+};
+
+//  Any number of copies of a few shared meshes, each with its own
+//  transform and material, traced as one scene object through two levels
+//  of BVH:
+//
+//  - the bottom level is each geometry's own TriangleMesh tree, built
+//    once and shared by every instance of it, so a million instances of
+//    one tree cost one tree plus the instance records
+//  - the top level is a tree of MeshNodes over the instances' boxes.  A
+//    ray reaching a leaf is taken into the instance's frame and handed to
+//    its geometry; the direction is not renormalized, so distances along
+//    it stay the scene's
+//
+//  Call build() once the instances are added.  moveInstance() refits only
+//  the top level nodes above the instance that moved, so dragging one in
+//  a set of millions costs a few dozen box unions; many moves can leave
+//  the tree looser than a fresh build() would be.
+//
+//  Material numbers past the end of the table fall back to the set's own
+//  colors and mirror and glass settings.  Queries are const and safe from
+//  any number of threads; edits are not.
+//
+class InstanceSet : public SceneObject {
+public:
+	InstanceSet(glm::vec3 p) { type = OBJECT_INSTANCES; position = p; }
+	InstanceSet() { type = OBJECT_INSTANCES; }
+
+	//  adds to the tables, returning the number to give instances; path
+	//  names the file the geometry came from, for saving the scene
+	//
+	int addGeometry(std::shared_ptr<const TriangleMesh> mesh, const string& path = "");
+	int addMaterial(const InstanceMaterial& material);
+
+	//  adds an instance; it is traced from the next build()
+	//
+	void add(Instance instance);
+	void build();
+
+	//  moves instance i to position, relative to the set, and refits the
+	//  top level above it
+	//
+	void moveInstance(int i, glm::vec3 position);
+
+	//  the instance a ray hits first, -1 if none; ray.d need not be
+	//  normalized
+	//
+	int pick(const Ray& ray);
+
+	bool intersect(const Ray& ray, glm::vec3& point, glm::vec3& normal);
+	bool intersect(const Ray& ray, float tMin, HitRecord& hit);
+	bool occludes(const Ray& ray, float tMin, float tMax);
+	AABB getBounds();
+	MaterialRecord getMaterial(const HitRecord& hit, float footprint);
+	void draw();
+
+	//  box of instance i relative to the set
+	//
+	AABB instanceBounds(int i) const;
+
+	//  edits counts the instances added and moved; editedBounds covers
+	//  where they were and where they went since clearEditedBounds(),
+	//  relative to the set, so an incremental frame retraces only there
+	//
+	uint32_t getEdits() const { return edits; }
+	const AABB& getEditedBounds() const { return editedBounds; }
+	void clearEditedBounds() { editedBounds = AABB(); }
+
+	int getNumInstances() const { return instances.size(); }
+	int getNodeCount() const { return nodes.size(); }
+	size_t getMemoryBytes() const;
+
+	vector<std::shared_ptr<const TriangleMesh>> geometries;
+	vector<string> geometryPaths;	// one per geometry, empty for meshes built in code
+	vector<InstanceMaterial> materials;
+	vector<Instance> instances;
+
+	static const int maxLeafSize = 2;
+	static const int maxDepth = 48;
+	static const int stackSize = 128;
+	static const int maxDrawnInstances = 2000;
+
+private:
+	void refitLeaf(int node);
+
+	vector<MeshNode> nodes;
+	vector<uint32_t> order;			// instance numbers in leaf order
+	vector<uint32_t> leafOf;		// per instance, the leaf holding it
+	AABB bounds;
+	uint32_t edits = 0;
+	AABB editedBounds;
+};
@@ -0,0 +1,244 @@
+#include "lightTree.h"
+
+#include <algorithm>
+
+//  ambient light and highlights reach past the cosine bounds, so no
+//  bound is allowed to fall below this share of a node's energy
+//
+static const float minShare = .05f;
+
+static const float pi = PI;
+
+static float angleBetween(const glm::vec3& a, const glm::vec3& b) {
+	return std::acos(glm::clamp(glm::dot(a, b), -1.0f, 1.0f));
+}
+
+//cosine of max(a - b, 0) from the sines and cosines of a and b
+static float cosMinusClamped(float sinA, float cosA, float sinB, float cosB) {
+	if (cosA > cosB) return 1;
+	return cosA * cosB + sinA * sinB;
+}
+
+static float sinMinusClamped(float sinA, float cosA, float sinB, float cosB) {
+	if (cosA > cosB) return 0;
+	return sinA * cosB - cosA * sinB;
+}
+
+//--------------------------------------------------------------
+//leaf for one light: its bounds, energy and emission cone
+//
+static LightNode leafFor(const LightRecord& light, int index) {
+	LightNode node;
+	node.light = index;
+	node.energy = light.intensity;
+	node.bounds.grow(light.position);
+
+	glm::vec3 aim = light.aimPoint - light.position;
+	bool aimed = glm::length(aim) > 1e-6f && light.type != LIGHT_POINT;
+	if (aimed) node.axis = glm::normalize(aim);
+	if (!aimed) {
+		node.thetaO = pi;
+		node.thetaE = pi / 2;
+	}
+	else if (light.type == LIGHT_SPOT) {
+		node.thetaE = std::min(light.coneAngle / 2, pi);
+	}
+	else {
+		//the rectangle, centred on position, lights its front side
+		glm::vec3 corner = light.position - (light.edgeU + light.edgeV) * .5f;
+		node.bounds.grow(corner + light.edgeU);
+		node.bounds.grow(corner + light.edgeV);
+		node.bounds.grow(corner + light.edgeU + light.edgeV);
+		node.bounds.grow(corner);
+		node.thetaE = pi / 2;
+	}
+	return node;
+}
+
+//--------------------------------------------------------------
+//smallest cone holding the cones of a and b, returned in a
+//
+static void mergeCones(LightNode& a, const LightNode& b) {
+	a.thetaE = std::max(a.thetaE, b.thetaE);
+
+	glm::vec3 axis = b.axis;
+	float thetaO = b.thetaO;
+	if (thetaO > a.thetaO) {
+		std::swap(axis, a.axis);
+		std::swap(thetaO, a.thetaO);
+	}
+	float between = angleBetween(a.axis, axis);
+	if (std::min(between + thetaO, pi) <= a.thetaO) return;
+
+	float merged = (a.thetaO + between + thetaO) / 2;
+	glm::vec3 across = axis - a.axis * glm::dot(a.axis, axis);
+	if (merged >= pi || glm::length(across) < 1e-6f) {
+		a.thetaO = pi;
+		return;
+	}
+	float turn = merged - a.thetaO;
+	a.axis = glm::normalize(a.axis * std::cos(turn) + glm::normalize(across) * std::sin(turn));
+	a.thetaO = merged;
+}
+
+//--------------------------------------------------------------
+//rebuilds the tree over a frame's light records
+//
+void LightTree::build(const vector<LightRecord>& lights) {
+	nodes.clear();
+	if (lights.empty()) return;
+
+	vector<LightNode> leaves(lights.size());
+	vector<int> order(lights.size());
+	for (int i = 0; i < lights.size(); i++) {
+		leaves[i] = leafFor(lights[i], i);
+		order[i] = i;
+	}
+	nodes.reserve(2 * lights.size() - 1);
+	buildNode(order, 0, order.size(), leaves);
+
+	for (LightNode& node : nodes) {
+		node.cosO = std::cos(node.thetaO);
+		node.sinO = std::sin(node.thetaO);
+		node.cosE = std::cos(node.thetaE);
+	}
+}
+
+//--------------------------------------------------------------
+//splits order[start, end) at the median of the light centres along the
+//axis they spread furthest on, so the tree stays balanced
+//returns the index of the new node
+//
+int LightTree::buildNode(vector<int>& order, int start, int end, const vector<LightNode>& leaves) {
+	int index = nodes.size();
+	if (end - start == 1) {
+		nodes.push_back(leaves[order[start]]);
+		return index;
+	}
+	nodes.emplace_back();
+
+	AABB centres;
+	for (int i = start; i < end; i++) centres.grow(leaves[order[i]].bounds.center());
+	glm::vec3 extent = centres.extent();
+	int axis = extent.x > extent.y && extent.x > extent.z ? 0 : extent.y > extent.z ? 1 : 2;
+	int middle = (start + end) / 2;
+	std::nth_element(order.begin() + start, order.begin() + middle, order.begin() + end, [&](int a, int b) {
+		return leaves[a].bounds.center()[axis] < leaves[b].bounds.center()[axis];
+	});
+
+	int left = buildNode(order, start, middle, leaves);
+	int right = buildNode(order, middle, end, leaves);
+
+	LightNode node = nodes[left];
+	node.light = -1;
+	node.right = right;
+	node.bounds.grow(nodes[right].bounds);
+	node.energy += nodes[right].energy;
+	mergeCones(node, nodes[right]);
+	nodes[index] = node;
+	return index;
+}
+
+//--------------------------------------------------------------
+//energy times upper bounds on the emission and receiving cosines over
+//the node's bounding sphere; the lights of this tracer do not fall off
+//with distance (see RayTracer::phong()), so neither does the importance
+//angles are subtracted through their sines and cosines, without any
+//inverse trigonometry
+//
+float LightTree::importance(const LightNode& node, const glm::vec3& p, const glm::vec3& n) const {
+	glm::vec3 centre = node.bounds.center();
+	glm::vec3 half = node.bounds.extent() * .5f;
+	glm::vec3 toPoint = p - centre;
+	float distance2 = glm::dot(toPoint, toPoint);
+	float radius2 = glm::dot(half, half);
+	if (distance2 <= radius2) return node.energy;
+
+	//half the angle the bounding sphere covers from p
+	glm::vec3 dir = toPoint / std::sqrt(distance2);
+	float sinB2 = radius2 / distance2;
+	float sinB = std::sqrt(sinB2);
+	float cosB = std::sqrt(1 - sinB2);
+
+	//p may only be lit from inside the emission cones
+	float emitted = 1;
+	if (node.thetaO < pi) {
+		float cosW = glm::dot(node.axis, dir);
+		float sinW = std::sqrt(std::max(1 - cosW * cosW, 0.0f));
+		float cosT = cosMinusClamped(sinW, cosW, node.sinO, node.cosO);
+		float sinT = sinMinusClamped(sinW, cosW, node.sinO, node.cosO);
+		float cosTheta = cosMinusClamped(sinT, cosT, sinB, cosB);
+		if (cosTheta <= node.cosE) return 0;
+		emitted = std::max(cosTheta, minShare);
+	}
+
+	float cosI = -glm::dot(n, dir);
+	float sinI = std::sqrt(std::max(1 - cosI * cosI, 0.0f));
+	float received = std::max(cosMinusClamped(sinI, cosI, sinB, cosB), minShare);
+	return node.energy * emitted * received;
+}
+
+//--------------------------------------------------------------
+//u picks the child at each level and is then rescaled to [0, 1) within
+//it, so stratified u give stratified lights
+//
+int LightTree::sample(const glm::vec3& p, const glm::vec3& n, float u, float& pdf) const {
+	pdf = 0;
+	if (nodes.empty()) return -1;
+
+	float probability = 1;
+	int index = 0;
+	while (!nodes[index].isLeaf()) {
+		int left = index + 1;
+		int right = nodes[index].right;
+		float wLeft = importance(nodes[left], p, n);
+		float wRight = importance(nodes[right], p, n);
+		if (wLeft + wRight <= 0) return -1;
+
+		float pLeft = wLeft / (wLeft + wRight);
+		if (u < pLeft) {
+			u = std::min(u / pLeft, 0.99999994f);
+			probability *= pLeft;
+			index = left;
+		}
+		else {
+			u = std::min((u - pLeft) / (1 - pLeft), 0.99999994f);
+			probability *= 1 - pLeft;
+			index = right;
+		}
+	}
+	pdf = probability;
+	return nodes[index].light;
+}
+
+//--------------------------------------------------------------
+//spot lights against the box's bounding sphere, area lights against the
+//half-space in front of their rectangle
+//
+bool lightMayReach(const LightRecord& light, const AABB& box) {
+	static const float margin = 1e-4f;
+
+	if (light.type == LIGHT_POINT) return true;
+	if (!(glm::dot(light.axis, light.axis) > .5f)) return true;		// aimed at itself, no direction to cull by
+
+	glm::vec3 centre = box.center();
+	glm::vec3 half = box.extent() * .5f;
+	glm::vec3 toCentre = centre - light.position;
+
+	if (light.type == LIGHT_AREA) {
+		//furthest any corner gets in front of the rectangle
+		float front = glm::dot(light.axis, toCentre) + glm::dot(glm::abs(light.axis), half);
+		return front > -margin * (1 + glm::length(toCentre));
+	}
+
+	float distance2 = glm::dot(toCentre, toCentre);
+	float radius2 = glm::dot(half, half) * (1 + margin);
+	if (distance2 <= radius2 || light.cosCutoff < -1) return true;
+
+	float sinB2 = radius2 / distance2;
+	float sinB = std::sqrt(sinB2);
+	float cosB = std::sqrt(1 - sinB2);
+	float cosW = glm::dot(light.axis, toCentre) / std::sqrt(distance2);
+	float sinW = std::sqrt(std::max(1 - cosW * cosW, 0.0f));
+	return cosMinusClamped(sinW, cosW, sinB, cosB) > light.cosCutoff - margin;
+}
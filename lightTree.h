@@ -0,0 +1,70 @@
+#pragma once
+
+#include "scene.h"
+
+//  Flattened light tree node.  Children of an interior node are stored
+//  at index + 1 (left) and at "right"; a leaf holds one light.
+//
+//  The orientation bounds follow Conty and Kulla's light BVH: every
+//  light below emits along directions within thetaO of axis, and each
+//  of those spreads its light up to thetaE further.  Queries only use
+//  the cosines, kept next to the angles the build merges.
+//
+struct LightNode {
+	AABB bounds;
+	glm::vec3 axis = glm::vec3(0, 0, 1);
+	float thetaO = 0;
+	float thetaE = 0;
+	float cosO = 1, sinO = 0;
+	float cosE = 1;
+	float energy = 0;           // summed intensity
+	int right = 0;
+	int light = -1;             // index into the records, -1 for interior nodes
+
+	bool isLeaf() const { return light >= 0; }
+};
+
+//  Hierarchy over a frame's light records for picking a light at a
+//  shading point with probability roughly proportional to what it adds
+//  there.  Each node bounds its lights' positions (area lights with their
+//  whole rectangle), their summed intensity and the cone they emit into:
+//  everywhere for point lights, the spot cone for spot lights, the front
+//  hemisphere for area lights.
+//
+//  sample() walks down from the root, at each node choosing a child by
+//  the ratio of their importances, and returns the light's probability
+//  with it, so dividing the light's shading by that probability gives an
+//  unbiased estimate of the sum over all lights.  The importances are
+//  conservative: no light that can light a point gets probability 0.
+//
+//  Queries are const and safe to run from any number of threads once the
+//  tree is built.
+//
+class LightTree {
+public:
+	void build(const vector<LightRecord>& lights);
+
+	//  picks a light for point p with normal n using u in [0, 1); returns
+	//  its index and probability, or -1 if no light can reach p
+	//
+	int sample(const glm::vec3& p, const glm::vec3& n, float u, float& pdf) const;
+
+	//  how much the lights under a node may add at p, up to a common scale
+	//
+	float importance(const LightNode& node, const glm::vec3& p, const glm::vec3& n) const;
+
+	bool empty() const { return nodes.empty(); }
+	int getNodeCount() const { return nodes.size(); }
+
+private:
+	int buildNode(vector<int>& order, int start, int end, const vector<LightNode>& leaves);
+
+	vector<LightNode> nodes;
+};
+
+//  false only if the light cannot add anything anywhere in box: outside
+//  a spot light's cone or behind an area light.  Point lights reach
+//  everywhere.  Padded against rounding, so a light it rejects gives
+//  exactly zero at every point of the box.
+//
+bool lightMayReach(const LightRecord& light, const AABB& box);
@@ -1,3 +1,5 @@
+#if !defined(RAYTRACER_HEADLESS) && !defined(RAYTRACER_BENCHMARK)
+
 #include "ofMain.h"
 #include "ofApp.h"
 
@@ -11,3 +13,5 @@ int main( ){
 	ofRunApp(new ofApp());
 
 }
+
+#endif
@@ -0,0 +1,227 @@
+#ifdef RAYTRACER_HEADLESS
+
+#include "ofMain.h"
+#include "rayTracer.h"
+#include "imageWriter.h"
+#include "sceneFile.h"
+#include "renderProfiler.h"
+
+//  Headless render target: builds the scene, traces one frame and writes
+//  it to disk without ever opening a window or creating a GL context.
+//  Compile the project with RAYTRACER_HEADLESS defined to get this main
+//  instead of the interactive one in main.cpp.
+//
+//  usage: raytracer [--width w] [--height h] [--output file] [--threads n] [--tile size]
+//                   [--exposure e] [--tonemap clamp|reinhard] [--png-level 0-9] [--aa samples]
+//                   [--scene file] [--save-scene file] [--profile file] [--heatmap file]
+//                   [--eye x,y,z] [--look-at x,y,z] [--up x,y,z] [--fov degrees]
+//                   [--max-depth n] [--ray-budget n] [--light-samples n] [--light-passes n]
+//
+
+static void usage() {
+	cerr << "usage: raytracer [--width w] [--height h] [--output file] [--threads n] [--tile size]" << endl;
+	cerr << "                 [--exposure e] [--tonemap clamp|reinhard] [--png-level 0-9] [--aa samples]" << endl;
+	cerr << "                 [--scene file] [--save-scene file] [--profile file] [--heatmap file]" << endl;
+	cerr << "                 [--eye x,y,z] [--look-at x,y,z] [--up x,y,z] [--fov degrees]" << endl;
+	cerr << "                 [--max-depth n] [--ray-budget n] [--light-samples n] [--light-passes n]" << endl;
+	cerr << "  --width, --height   image resolution (default 1200 x 800)" << endl;
+	cerr << "  --output            image file to write, format taken from the extension (default output.png)" << endl;
+	cerr << "                      .pfm, .exr and .hdr keep the linear radiance, unclamped" << endl;
+	cerr << "                      .ppm is written uncompressed, none skips writing" << endl;
+	cerr << "  --threads           worker threads, 0 = one per hardware thread (default 0)" << endl;
+	cerr << "  --tile              tile size in pixels (default 32)" << endl;
+	cerr << "  --exposure          radiance scale before tone mapping 8 bit output (default 1)" << endl;
+	cerr << "  --tonemap           clamp or reinhard, for 8 bit output (default clamp)" << endl;
+	cerr << "  --png-level         zlib level for .png, 0 = stored, 1 = fastest, 9 = smallest (default 6)" << endl;
+	cerr << "  --aa                rays per edge pixel at most, 1 = no anti-aliasing (default 1)" << endl;
+	cerr << "  --scene             .scene or .bscene file to render instead of the default scene" << endl;
+	cerr << "  --save-scene        writes the scene being rendered, binary if the name ends in .bscene" << endl;
+	cerr << "  --profile           prints ray counts and stage times and writes them to a JSON file" << endl;
+	cerr << "  --heatmap           profiles and writes an image of the time spent on each pixel" << endl;
+	cerr << "  --eye, --look-at    render camera position and the point it looks at (default 0,0,10 and 0,0,-1)" << endl;
+	cerr << "  --up                direction that is up in the image (default 0,1,0)" << endl;
+	cerr << "  --fov               vertical field of view (default about 43.6)" << endl;
+	cerr << "  --max-depth         bounces a reflected or refracted ray may follow (default 6)" << endl;
+	cerr << "  --ray-budget        reflected and refracted rays per primary hit at most (default 32)" << endl;
+	cerr << "  --light-samples     lights picked by importance per shading point, 0 = every light (default 0)" << endl;
+	cerr << "  --light-passes      passes averaged while picking lights (default 4)" << endl;
+}
+
+//--------------------------------------------------------------
+static bool parseVec3(const string& text, glm::vec3& v) {
+	vector<string> parts = ofSplitString(text, ",", true, true);
+	if (parts.size() != 3) return false;
+	v = glm::vec3(ofToFloat(parts[0]), ofToFloat(parts[1]), ofToFloat(parts[2]));
+	return true;
+}
+
+//========================================================================
+int main(int argc, char* argv[]) {
+	int width = 1200;
+	int height = 800;
+	int threads = 0;
+	int tileSize = 32;
+	float exposure = 1;
+	ToneMap toneMap = TONEMAP_CLAMP;
+	int pngLevel = 6;
+	int aaSamples = 1;
+	string output = "output.png";
+	string scenePath;
+	string saveScenePath;
+	string profilePath;
+	string heatmapPath;
+	glm::vec3 eye, lookAt, up;
+	bool setEye = false, setLookAt = false, setUp = false;
+	float fov = 0;
+	int maxDepth = 6;
+	int rayBudget = 32;
+	int lightSamples = 0;
+	int lightPasses = 4;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "--help" || arg == "-h") {
+			usage();
+			return 0;
+		}
+		if (i + 1 >= argc) {
+			cerr << "missing value for " << arg << endl;
+			usage();
+			return 2;
+		}
+		string value = argv[++i];
+		if (arg == "--width") width = ofToInt(value);
+		else if (arg == "--height") height = ofToInt(value);
+		else if (arg == "--output") output = value;
+		else if (arg == "--threads") threads = ofToInt(value);
+		else if (arg == "--tile") tileSize = ofToInt(value);
+		else if (arg == "--exposure") exposure = ofToFloat(value);
+		else if (arg == "--tonemap" && value == "clamp") toneMap = TONEMAP_CLAMP;
+		else if (arg == "--tonemap" && value == "reinhard") toneMap = TONEMAP_REINHARD;
+		else if (arg == "--png-level") pngLevel = ofToInt(value);
+		else if (arg == "--aa") aaSamples = ofToInt(value);
+		else if (arg == "--scene") scenePath = value;
+		else if (arg == "--save-scene") saveScenePath = value;
+		else if (arg == "--profile") profilePath = value;
+		else if (arg == "--heatmap") heatmapPath = value;
+		else if (arg == "--eye" && (setEye = parseVec3(value, eye))) {}
+		else if (arg == "--look-at" && (setLookAt = parseVec3(value, lookAt))) {}
+		else if (arg == "--up" && (setUp = parseVec3(value, up))) {}
+		else if (arg == "--fov" && (fov = ofToFloat(value)) > 0 && fov < 180) {}
+		else if (arg == "--max-depth" && (maxDepth = ofToInt(value)) >= 0) {}
+		else if (arg == "--ray-budget" && (rayBudget = ofToInt(value)) >= 0) {}
+		else if (arg == "--light-samples" && (lightSamples = ofToInt(value)) >= 0) {}
+		else if (arg == "--light-passes" && (lightPasses = ofToInt(value)) > 0) {}
+		else {
+			cerr << "unknown option or bad value: " << arg << " " << value << endl;
+			usage();
+			return 2;
+		}
+	}
+	if (width <= 0 || height <= 0 || threads < 0 || tileSize <= 0 || aaSamples <= 0) {
+		cerr << "resolution, thread count, tile size and anti-aliasing samples must be positive" << endl;
+		return 2;
+	}
+	if (pngLevel < 0 || pngLevel > 9) {
+		cerr << "png level must be between 0 and 9" << endl;
+		return 2;
+	}
+
+	SceneStore store;
+	RenderCam renderCam;
+	SceneFile sceneFile;
+	if (scenePath.empty()) {
+		buildDefaultScene(store);
+	}
+	else {
+		auto loadStart = std::chrono::steady_clock::now();
+		if (!sceneFile.load(scenePath)) return 1;
+		sceneFile.instantiate(store, renderCam);
+		auto loadElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - loadStart).count();
+		cout << "loaded " << scenePath << " (" << sceneFile.getNumPlanes() << " planes, " << sceneFile.getNumSpheres() << " spheres, "
+			<< sceneFile.getNumSDFs() << " SDF objects, " << sceneFile.getNumMeshes() << " meshes, " << sceneFile.getNumInstances() << " instances, "
+			<< sceneFile.getNumLights() << " lights) in " << loadElapsed << " ms" << endl;
+	}
+
+	// camera options, then the view plane aspect in step with the
+	// requested resolution
+	//
+	if (setEye) renderCam.position = eye;
+	if (setEye || setLookAt || setUp) renderCam.lookAt(setLookAt ? lookAt : renderCam.aim, setUp ? up : renderCam.up);
+	if (fov > 0) renderCam.setFov(fov);
+	renderCam.setAspect((float)width / height);
+
+	if (!saveScenePath.empty()) {
+		SceneFile saved;
+		saved.capture(store.scene, store.light, renderCam);
+		if (!saved.save(saveScenePath)) return 1;
+	}
+
+	RayTracer tracer(store.scene, store.light, renderCam);
+	tracer.numThreads = threads;
+	tracer.tileSize = tileSize;
+	tracer.aaSamples = aaSamples;
+	tracer.maxDepth = maxDepth;
+	tracer.rayBudget = rayBudget;
+	tracer.lightSamples = lightSamples;
+	tracer.lightPasses = lightPasses;
+	tracer.incremental = false;				// one frame, nothing to update
+
+	RadianceBuffer radiance;
+	radiance.allocate(width, height);
+
+	RenderProfiler& profiler = renderProfiler();
+	profiler.setEnabled(!profilePath.empty() || !heatmapPath.empty());
+	profiler.reset();
+
+	auto start = std::chrono::steady_clock::now();
+	tracer.render(radiance);
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+	cout << "rendered " << width << "x" << height << " in " << elapsed << " ms on "
+		<< tracer.renderer.getNumThreads() << " threads" << endl;
+	const RayTracer::LightCullStats& culled = tracer.getLightCullStats();
+	if (store.light.size() > 1 && lightSamples == 0 && culled.tiles > 0) {
+		cout << "shaded " << (double)culled.lights / culled.tiles << " of " << store.light.size() << " lights per tile on average" << endl;
+	}
+	if (aaSamples > 1) {
+		const RayTracer::AntiAliasStats& stats = tracer.getAntiAliasStats();
+		cout << "anti-aliased " << stats.edgePixels << " edge pixels (" << 100.0 * stats.edgePixels / stats.pixels << "%), "
+			<< stats.rays << " rays, " << (double)stats.rays / stats.pixels << " per pixel" << endl;
+	}
+
+	string path = ofFilePath::getAbsolutePath(output, false);
+	OutputFormat format;
+	bool saved;
+	if (output == "none") {
+		saved = true;
+	}
+	else if (ImageWriter::parseFormat(ofFilePath::getFileExt(output), format)) {
+		ofPixels pixels;
+		if (format != OUTPUT_PFM) radiance.toPixels(pixels, exposure, toneMap);
+		saved = ImageWriter::save(path, format, pixels, radiance, pngLevel);
+	}
+	else if (RadianceBuffer::isHdrPath(output)) {
+		saved = radiance.saveHdr(path);
+	}
+	else {
+		ofPixels pixels;
+		radiance.toPixels(pixels, exposure, toneMap);
+		saved = ofSaveImage(pixels, path);
+	}
+	if (!saved) {
+		cerr << "could not write " << output << endl;
+		return 1;
+	}
+
+	// after writing, so the report includes the encode
+	//
+	if (profiler.isEnabled()) {
+		profiler.printSummary(cout);
+		if (!profilePath.empty() && !profiler.saveJson(ofFilePath::getAbsolutePath(profilePath, false))) return 1;
+		if (!heatmapPath.empty() && !profiler.saveHeatmap(ofFilePath::getAbsolutePath(heatmapPath, false))) return 1;
+	}
+	return 0;
+}
+
+#endif
@@ -0,0 +1,555 @@
+#include "meshFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+//  bytes read from the file at a time
+//
+static const size_t chunkSize = 1 << 20;
+
+//  OBJ: marks an index into the vertices added for a second normal, which
+//  are only appended once the file's own vertices are all known
+//
+static const uint32_t extraVertex = 0x80000000u;
+static const uint32_t noNormal = 0xffffffffu;
+
+namespace {
+//  Hands out a file a line or a run of bytes at a time from one buffer,
+//  refilled as it empties; a line longer than the buffer grows it.
+//
+class ChunkReader {
+public:
+	~ChunkReader() { if (file) fclose(file); }
+
+	bool open(const string& path) {
+		file = fopen(path.c_str(), "rb");
+		if (!file) return false;
+		fseek(file, 0, SEEK_END);
+		fileSize = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		buffer.resize(chunkSize);
+		return true;
+	}
+
+	//  the next line, without its line end; false at the end of the file
+	//
+	bool line(const char*& begin, const char*& end) {
+		size_t scanned = 0;			// bytes after head known to hold no line end
+		while (true) {
+			const char* start = buffer.data() + head;
+			const char* newline = (const char*)memchr(start + scanned, '\n', tail - head - scanned);
+			if (newline) {
+				begin = start;
+				end = newline;
+				head += newline - start + 1;
+				break;
+			}
+			scanned = tail - head;
+			if (!refill(scanned + 1)) {
+				if (tail == head) return false;
+				begin = buffer.data() + head;
+				end = buffer.data() + tail;
+				head = tail;
+				break;
+			}
+		}
+		if (end > begin && end[-1] == '\r') end--;
+		return true;
+	}
+
+	//  the next n bytes, in one piece; false if the file ends first
+	//
+	bool bytes(size_t n, const char*& data) {
+		if (tail - head < n && !refill(n)) return false;
+		data = buffer.data() + head;
+		head += n;
+		return true;
+	}
+
+	//  the next n bytes without moving past them, nullptr if the file is
+	//  shorter
+	//
+	const char* peek(size_t n) {
+		if (tail - head < n && !refill(n)) return nullptr;
+		return buffer.data() + head;
+	}
+
+	size_t getFileSize() const { return fileSize; }
+
+private:
+	//moves the unread bytes to the front and reads until n are buffered
+	//false if the file ends first
+	bool refill(size_t n) {
+		memmove(buffer.data(), buffer.data() + head, tail - head);
+		tail -= head;
+		head = 0;
+		if (buffer.size() < n) buffer.resize(std::max(n, buffer.size() * 2));
+		while (tail < n && !atEnd) {
+			size_t got = fread(buffer.data() + tail, 1, buffer.size() - tail, file);
+			if (got == 0) atEnd = true;
+			tail += got;
+		}
+		return tail >= n;
+	}
+
+	FILE* file = nullptr;
+	size_t fileSize = 0;
+	vector<char> buffer;
+	size_t head = 0;			// next unread byte
+	size_t tail = 0;			// end of the bytes read
+	bool atEnd = false;
+};
+}
+
+static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f'; }
+
+static void skipSpaces(const char*& p, const char* end) {
+	while (p < end && isSpace(*p)) p++;
+}
+
+//  powers of ten a double holds exactly
+//
+static const double powersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+//--------------------------------------------------------------
+//reads a decimal number at p and moves past it; plain forms are
+//converted here, with one rounding in double, anything longer or
+//stranger (more than 19 digits, hex, inf, nan) goes to strtod
+//
+static bool parseFloat(const char*& p, const char* end, float& out) {
+	skipSpaces(p, end);
+	const char* start = p;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	for (; p < end && isDigit(*p); p++, digits++) mantissa = mantissa * 10 + (*p - '0');
+	if (p < end && *p == '.') {
+		for (p++; p < end && isDigit(*p); p++, digits++, exponent--) mantissa = mantissa * 10 + (*p - '0');
+	}
+	if (digits > 0 && p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+		bool negativeExponent = false;
+		if (p < end && (*p == '-' || *p == '+')) negativeExponent = *p++ == '-';
+		int e = 0;
+		const char* first = p;
+		for (; p < end && isDigit(*p); p++) e = std::min(e * 10 + (*p - '0'), 10000);
+		if (p == first) digits = 0;
+		exponent += negativeExponent ? -e : e;
+	}
+	if (digits > 0 && digits <= 19 && std::abs(exponent) <= 22 && (p == end || isSpace(*p))) {
+		double value = (double)mantissa;
+		value = exponent < 0 ? value / powersOfTen[-exponent] : value * powersOfTen[exponent];
+		out = (float)(negative ? -value : value);
+		return true;
+	}
+
+	char text[64];
+	size_t length = 0;
+	while (start + length < end && !isSpace(start[length]) && length < sizeof(text) - 1) length++;
+	memcpy(text, start, length);
+	text[length] = 0;
+	char* stop;
+	out = (float)strtod(text, &stop);
+	p = start + (stop - text);
+	return stop != text;
+}
+
+//--------------------------------------------------------------
+//reads an optionally signed decimal integer at p and moves past it
+//values too large for 64 bits stop growing, which no index survives
+//
+static bool parseInt(const char*& p, const char* end, long long& out) {
+	skipSpaces(p, end);
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+	const char* first = p;
+	long long value = 0;
+	for (; p < end && isDigit(*p); p++) {
+		if (value <= (INT64_MAX - 9) / 10) value = value * 10 + (*p - '0');
+	}
+	out = negative ? -value : value;
+	return p > first;
+}
+
+//--------------------------------------------------------------
+//the words of a line, for the few lines of a PLY header
+//
+static vector<string> words(const char* p, const char* end) {
+	vector<string> out;
+	while (true) {
+		skipSpaces(p, end);
+		if (p == end) return out;
+		const char* start = p;
+		while (p < end && !isSpace(*p)) p++;
+		out.emplace_back(start, p);
+	}
+}
+
+//--------------------------------------------------------------
+//v, vn and f lines; everything else is skipped
+//
+static bool loadObj(ChunkReader& reader, const string& path, TriangleMesh& mesh) {
+	vector<glm::vec3> fileNormals;
+	vector<uint32_t> vertexNormal;					// per vertex, the file normal it is stored with
+	vector<glm::vec3> extraVertices;				// copies of vertices used with a second normal
+	vector<uint32_t> extraNormals;
+	std::unordered_map<uint64_t, uint32_t> copies;	// (vertex, normal) to its copy
+	vector<uint32_t> polygon;
+	bool anyNormals = false;
+
+	long long lineNumber = 0;
+	auto fail = [&](const string& why) {
+		cerr << path << ":" << lineNumber << ": " << why << endl;
+		return false;
+	};
+
+	//the vertex to store a face corner with, copying v if it already has
+	//a different normal
+	auto corner = [&](uint32_t v, uint32_t n) {
+		if (n == noNormal) return v;
+		anyNormals = true;
+		if (vertexNormal[v] == noNormal) vertexNormal[v] = n;
+		if (vertexNormal[v] == n) return v;
+		auto found = copies.emplace(((uint64_t)v << 32) | n, extraVertex | (uint32_t)extraVertices.size());
+		if (found.second) {
+			extraVertices.push_back(mesh.vertices[v]);
+			extraNormals.push_back(n);
+		}
+		return found.first->second;
+	};
+
+	const char* begin;
+	const char* end;
+	while (reader.line(begin, end)) {
+		lineNumber++;
+		const char* p = begin;
+		skipSpaces(p, end);
+		const char* keyword = p;
+		while (p < end && !isSpace(*p)) p++;
+		string kind(keyword, p);
+
+		if (kind == "v") {
+			glm::vec3 v;
+			if (!parseFloat(p, end, v.x) || !parseFloat(p, end, v.y) || !parseFloat(p, end, v.z)) return fail("expected 3 numbers");
+			if (mesh.vertices.size() >= extraVertex) return fail("too many vertices");
+			mesh.vertices.push_back(v);
+			vertexNormal.push_back(noNormal);
+		}
+		else if (kind == "vn") {
+			glm::vec3 n;
+			if (!parseFloat(p, end, n.x) || !parseFloat(p, end, n.y) || !parseFloat(p, end, n.z)) return fail("expected 3 numbers");
+			fileNormals.push_back(n);
+		}
+		else if (kind == "f") {
+			polygon.clear();
+			while (true) {
+				skipSpaces(p, end);
+				if (p == end) break;
+
+				//v, v/vt, v//vn or v/vt/vn, counted from 1, or back from the
+				//last one if negative
+				long long v, vt, vn;
+				bool hasNormal = false;
+				if (!parseInt(p, end, v)) return fail("bad face corner");
+				if (p < end && *p == '/') {
+					p++;
+					if (p < end && *p != '/' && !parseInt(p, end, vt)) return fail("bad face corner");
+					if (p < end && *p == '/') {
+						p++;
+						if (!parseInt(p, end, vn)) return fail("bad face corner");
+						hasNormal = true;
+					}
+				}
+				if (p < end && !isSpace(*p)) return fail("bad face corner");
+
+				long long vertexCount = mesh.vertices.size(), normalCount = fileNormals.size();
+				v = v < 0 ? vertexCount + v : v - 1;
+				if (v < 0 || v >= vertexCount) return fail("vertex index out of range");
+				if (hasNormal) {
+					vn = vn < 0 ? normalCount + vn : vn - 1;
+					if (vn < 0 || vn >= normalCount) return fail("normal index out of range");
+				}
+				polygon.push_back(corner((uint32_t)v, hasNormal ? (uint32_t)vn : noNormal));
+			}
+			if (polygon.size() < 3) return fail("face with fewer than 3 corners");
+			for (int k = 1; k + 1 < polygon.size(); k++) {
+				mesh.indices.push_back(polygon[0]);
+				mesh.indices.push_back(polygon[k]);
+				mesh.indices.push_back(polygon[k + 1]);
+			}
+		}
+	}
+
+	//the copies go after the file's own vertices
+	uint32_t fileVertices = mesh.vertices.size();
+	if ((uint64_t)fileVertices + extraVertices.size() >= extraVertex) return fail("too many vertices");
+	for (uint32_t& index : mesh.indices) {
+		if (index & extraVertex) index = fileVertices + (index & ~extraVertex);
+	}
+	mesh.vertices.insert(mesh.vertices.end(), extraVertices.begin(), extraVertices.end());
+	if (anyNormals) {
+		mesh.normals.resize(mesh.vertices.size(), glm::vec3(0));
+		for (uint32_t i = 0; i < fileVertices; i++) {
+			if (vertexNormal[i] != noNormal) mesh.normals[i] = fileNormals[vertexNormal[i]];
+		}
+		for (int i = 0; i < extraNormals.size(); i++) mesh.normals[fileVertices + i] = fileNormals[extraNormals[i]];
+	}
+	mesh.vertices.shrink_to_fit();
+	mesh.indices.shrink_to_fit();
+	return true;
+}
+
+//  PLY property types, in the order of plyTypeNames
+//
+enum PlyType { PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64, numPlyTypes };
+
+static const char* plyTypeNames[][2] = { { "char", "int8" }, { "uchar", "uint8" }, { "short", "int16" }, { "ushort", "uint16" },
+	{ "int", "int32" }, { "uint", "uint32" }, { "float", "float32" }, { "double", "float64" } };
+static const int plyTypeSizes[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+
+static bool toPlyType(const string& name, PlyType& type) {
+	for (int t = 0; t < numPlyTypes; t++) {
+		if (name == plyTypeNames[t][0] || name == plyTypeNames[t][1]) {
+			type = (PlyType)t;
+			return true;
+		}
+	}
+	return false;
+}
+
+struct PlyProperty {
+	string name;
+	PlyType type;
+	PlyType countType;				// lists only
+	bool isList = false;
+};
+
+struct PlyElement {
+	string name;
+	uint64_t count;
+	vector<PlyProperty> properties;
+};
+
+namespace {
+//  Reads the values of PLY records in either encoding: ascii records are
+//  one line each, binary ones packed in the file's byte order.
+//
+class PlyValues {
+public:
+	PlyValues(ChunkReader& reader, bool ascii, bool swap) : reader(reader), ascii(ascii), swap(swap) {}
+
+	bool startRecord() {
+		if (!ascii) return true;
+		while (reader.line(cursor, end)) {
+			skipSpaces(cursor, end);
+			if (cursor < end) return true;
+		}
+		return false;
+	}
+
+	bool value(PlyType type, double& out) {
+		if (ascii) {
+			if (type == PLY_FLOAT32 || type == PLY_FLOAT64) {
+				float f;
+				if (!parseFloat(cursor, end, f)) return false;
+				out = f;
+				return true;
+			}
+			long long n;
+			if (!parseInt(cursor, end, n)) return false;
+			out = (double)n;
+			return true;
+		}
+
+		const char* data;
+		int size = plyTypeSizes[type];
+		if (!reader.bytes(size, data)) return false;
+		unsigned char b[8];
+		memcpy(b, data, size);
+		if (swap) std::reverse(b, b + size);
+		switch (type) {
+		case PLY_INT8: out = (int8_t)b[0]; break;
+		case PLY_UINT8: out = b[0]; break;
+		case PLY_INT16: { int16_t v; memcpy(&v, b, 2); out = v; break; }
+		case PLY_UINT16: { uint16_t v; memcpy(&v, b, 2); out = v; break; }
+		case PLY_INT32: { int32_t v; memcpy(&v, b, 4); out = v; break; }
+		case PLY_UINT32: { uint32_t v; memcpy(&v, b, 4); out = v; break; }
+		case PLY_FLOAT32: { float v; memcpy(&v, b, 4); out = v; break; }
+		default: { double v; memcpy(&v, b, 8); out = v; break; }
+		}
+		return true;
+	}
+
+private:
+	ChunkReader& reader;
+	bool ascii, swap;
+	const char* cursor = nullptr;
+	const char* end = nullptr;
+};
+}
+
+//--------------------------------------------------------------
+//the header, then every element in the order it declares them
+//
+static bool loadPly(ChunkReader& reader, const string& path, TriangleMesh& mesh) {
+	auto fail = [&](const string& why) {
+		cerr << path << ": " << why << endl;
+		return false;
+	};
+
+	vector<PlyElement> elements;
+	string format;
+	const char* begin;
+	const char* end;
+	bool ended = false;
+	while (!ended && reader.line(begin, end)) {
+		vector<string> w = words(begin, end);
+		if (w.empty() || w[0] == "ply" || w[0] == "comment" || w[0] == "obj_info") continue;
+		if (w[0] == "end_header") ended = true;
+		else if (w[0] == "format" && w.size() >= 2) format = w[1];
+		else if (w[0] == "element" && w.size() == 3) {
+			char* stop;
+			long long count = strtoll(w[2].c_str(), &stop, 10);
+			if (*stop != 0 || count < 0) return fail("bad element count '" + w[2] + "'");
+			elements.push_back(PlyElement{ w[1], (uint64_t)count, {} });
+		}
+		else if (w[0] == "property" && !elements.empty()) {
+			PlyProperty property;
+			bool ok;
+			if (w.size() == 5 && w[1] == "list") {
+				property.isList = true;
+				property.name = w[4];
+				ok = toPlyType(w[2], property.countType) && toPlyType(w[3], property.type);
+			}
+			else {
+				property.name = w.size() == 3 ? w[2] : "";
+				ok = w.size() == 3 && toPlyType(w[1], property.type);
+			}
+			if (!ok) return fail("bad property '" + string(begin, end) + "'");
+			elements.back().properties.push_back(property);
+		}
+		else return fail("bad header line '" + string(begin, end) + "'");
+	}
+	if (!ended) return fail("no end_header");
+
+	uint16_t one = 1;
+	bool littleEndian = *(uint8_t*)&one == 1;
+	bool ascii = format == "ascii";
+	if (!ascii && format != "binary_little_endian" && format != "binary_big_endian") return fail("unknown format '" + format + "'");
+	PlyValues values(reader, ascii, !ascii && (format == "binary_little_endian") != littleEndian);
+
+	//counts are only trusted as far as the file could hold them
+	size_t fileSize = reader.getFileSize();
+	vector<uint32_t> polygon;
+	for (const PlyElement& element : elements) {
+		bool isVertex = element.name == "vertex";
+		bool isFace = element.name == "face";
+		int position[3] = { -1, -1, -1 };
+		int normal[3] = { -1, -1, -1 };
+		int faceList = -1;
+		for (int k = 0; k < element.properties.size(); k++) {
+			const PlyProperty& property = element.properties[k];
+			const char* axes[] = { "x", "y", "z" };
+			const char* normalAxes[] = { "nx", "ny", "nz" };
+			for (int a = 0; a < 3; a++) {
+				if (isVertex && !property.isList && property.name == axes[a]) position[a] = k;
+				if (isVertex && !property.isList && property.name == normalAxes[a]) normal[a] = k;
+			}
+			if (isFace && property.isList && (property.name == "vertex_indices" || property.name == "vertex_index")) faceList = k;
+		}
+		bool hasNormals = normal[0] >= 0 && normal[1] >= 0 && normal[2] >= 0;
+		if (isVertex) {
+			if (position[0] < 0 || position[1] < 0 || position[2] < 0) return fail("vertex element without x, y and z");
+			if (element.count >= 0x80000000u) return fail("too many vertices");
+			mesh.vertices.reserve(std::min<uint64_t>(element.count, fileSize / 3));
+			if (hasNormals) mesh.normals.reserve(mesh.vertices.capacity());
+		}
+		if (isFace) {
+			if (faceList < 0) return fail("face element without vertex_indices");
+			mesh.indices.reserve(3 * std::min<uint64_t>(element.count, fileSize / 4));
+		}
+
+		vector<double> record(element.properties.size());
+		for (uint64_t i = 0; i < element.count; i++) {
+			if (!values.startRecord()) return fail("ends in " + element.name + " " + to_string(i));
+			for (int k = 0; k < element.properties.size(); k++) {
+				const PlyProperty& property = element.properties[k];
+				double x;
+				if (!property.isList) {
+					if (!values.value(property.type, x)) return fail("bad " + element.name + " " + to_string(i));
+					record[k] = x;
+					continue;
+				}
+				//every item takes at least a byte, so a longer list cannot be right
+				double count;
+				if (!values.value(property.countType, count)) return fail("bad " + element.name + " " + to_string(i));
+				if (!(count >= 0 && count <= fileSize)) return fail("bad " + element.name + " " + to_string(i) + " list length");
+				if (k == faceList) polygon.clear();
+				for (uint64_t item = 0; item < (uint64_t)count; item++) {
+					if (!values.value(property.type, x)) return fail("bad " + element.name + " " + to_string(i));
+					if (k == faceList) polygon.push_back(x < 0 ? 0xffffffffu : (uint32_t)std::min(x, 4294967295.0));
+				}
+			}
+			if (isVertex) {
+				mesh.vertices.push_back(glm::vec3(record[position[0]], record[position[1]], record[position[2]]));
+				if (hasNormals) mesh.normals.push_back(glm::vec3(record[normal[0]], record[normal[1]], record[normal[2]]));
+			}
+			if (isFace) {
+				if (polygon.size() < 3) return fail("face " + to_string(i) + " has fewer than 3 corners");
+				for (int k = 1; k + 1 < polygon.size(); k++) {
+					mesh.indices.push_back(polygon[0]);
+					mesh.indices.push_back(polygon[k]);
+					mesh.indices.push_back(polygon[k + 1]);
+				}
+			}
+		}
+	}
+
+	//faces may come before the vertices they use, so indices are only
+	//checked once both are in
+	for (uint32_t index : mesh.indices) {
+		if (index >= mesh.vertices.size()) return fail("vertex index " + to_string(index) + " out of range");
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+//PLY files say so in their first bytes; anything else is read as OBJ
+//
+bool loadMesh(const string& path, TriangleMesh& mesh) {
+	mesh = TriangleMesh();
+	ChunkReader reader;
+	if (!reader.open(path)) {
+		cerr << path << ": cannot open" << endl;
+		return false;
+	}
+	const char* magic = reader.peek(3);
+	bool ok = magic && memcmp(magic, "ply", 3) == 0 ? loadPly(reader, path, mesh) : loadObj(reader, path, mesh);
+	if (ok && mesh.getNumTriangles() == 0) {
+		cerr << path << ": no triangles" << endl;
+		ok = false;
+	}
+	if (!ok) {
+		mesh = TriangleMesh();
+		return false;
+	}
+	mesh.build();
+	return true;
+}
+
+//--------------------------------------------------------------
+bool isMeshPath(const string& path) {
+	string lower = ofToLower(path);
+	for (const string ext : { ".obj", ".ply" }) {
+		if (lower.size() >= ext.size() && lower.compare(lower.size() - ext.size(), ext.size(), ext) == 0) return true;
+	}
+	return false;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "triangleMesh.h"
+
+//  Triangle meshes from Wavefront OBJ and PLY files, streamed through one
+//  fixed size buffer, so reading never holds more than a chunk of the file
+//  besides the mesh itself.
+//
+//  - OBJ: v, vn and f lines; polygons are split into fans, negative indices
+//    count back from the last vertex, and texture coordinates, groups and
+//    materials are skipped.  A vertex used with two different normals is
+//    stored once per normal.  Buffers grow as the file is read and are
+//    trimmed to size at the end.
+//
+//  - PLY: ascii, binary_little_endian and binary_big_endian, with x, y, z
+//    and optional nx, ny, nz vertex properties of any type and a face list
+//    named vertex_indices or vertex_index; other elements and properties
+//    are skipped.  The header gives the counts, so buffers are sized once.
+//
+//  The mesh is replaced and built on success.  On failure it returns false
+//  with the reason on cerr, and the mesh is left empty.
+//
+bool loadMesh(const string& path, TriangleMesh& mesh);
+
+//  true for the extensions loadMesh reads: .obj and .ply, any case
+//
+bool isMeshPath(const string& path);
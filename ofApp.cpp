@@ -1,50 +1,6 @@
 #include "ofApp.h"
-#include <glm/gtx/intersect.hpp>
-
-
-//implement area light lambert
-
-// Intersect Ray with Plane  (wrapper on glm::intersect*
-//
-
-bool Plane::intersect(const Ray& ray, glm::vec3& point, glm::vec3& normalAtIntersect) {
-	float dist;
-	bool insidePlane = false;
-	bool hit = glm::intersectRayPlane(ray.p, ray.d, position, this->normal, dist);
-	if (hit) {
-		Ray r = ray;
-		point = r.evalPoint(dist);
-		setIntersectionPoint(r.evalPoint(dist));
-
-		normalAtIntersect = this->normal;
-		glm::vec2 xrange = glm::vec2(position.x - width / 2, position.x + width
-			/ 2);
-		glm::vec2 zrange = glm::vec2(position.z - height / 2, position.z +
-			height / 2);
-		if (point.x < xrange[1] && point.x > xrange[0] && point.z < zrange[1]
-			&& point.z > zrange[0]) {
-			insidePlane = true;
-		}
-	}
-	return insidePlane;
-}
-
-// Convert (u, v) to (x, y, z) 
-// We assume u,v is in [0, 1]
-//
-glm::vec3 ViewPlane::toWorld(float u, float v) {
-	float w = width();
-	float h = height();
-	return (glm::vec3((u * w) + min.x, (v * h) + min.y, position.z));
-}
-
-// Get a ray from the current camera position to the (u, v) position on
-// the ViewPlane
-//
-Ray RenderCam::getRay(float u, float v) {
-	glm::vec3 pointOnPlane = view.toWorld(u, v);
-	return(Ray(position, glm::normalize(pointOnPlane - position)));
-}
+#include "renderProfiler.h"
+#include "meshFile.h"
 
 //--------------------------------------------------------------
 //setup gui, scene objects, lights, textures, and camera
@@ -71,6 +27,11 @@ void ofApp::setup(){
 
 	gui.add(scale.setup("sphere scale", .5, .1, 3));
 	gui.add(color.setup("sphere color", glm::vec3(0,0,255), glm::vec3(0,0,0), glm::vec3(255,255,255)));
+	gui.add(reflectivity.setup("sphere reflectivity", 0, 0, 1));
+	gui.add(transparency.setup("sphere transparency", 0, 0, 1));
+	gui.add(ior.setup("sphere ior", 1.5, 1, 2.5));
+	gui.add(aaSamples.setup("AA samples", 16, 1, 64));
+	gui.add(lightSamples.setup("Light samples (0 = all)", 0, 0, 16));
 
 
 	bHide = false;
@@ -81,48 +42,27 @@ void ofApp::setup(){
 	sideCam.setPosition(glm::vec3(5, 0, 0));
 	sideCam.lookAt(glm::vec3(0, 0, 0));
 	sideCam.setNearClip(.1);
-	previewCam.setFov(90);
-	previewCam.setPosition(0, 0, 10);
-	previewCam.lookAt(glm::vec3(0, 0, -1));
-
+	renderCam.setAspect((float)imageWidth / imageHeight);
+	syncPreviewCam();
 
-	groundTexture.load("bamboo.jpg");
-	groundTextureSpecular.load("bamboo_spec.jpg");
-
-	wallTexture.load("ceramic_wall.jpg");
-	wallTextureSpecular.load("ceramic_wall_spec.jpg");
-
-	scene.clear();
-
-	scene.push_back(new Plane(glm::vec3(-1, -2, 0), glm::vec3(0, 1, 0), ofColor::darkBlue, 12, 10));				//ground plane
-
-	scene.push_back(new Plane(glm::vec3(-1, 1, -5), glm::vec3(0, 0, 1), ofColor::darkGray, 20, 10));	        	//wall plane
-	
-	aimPoint.clear();
 
-	aimPoint.push_back(new Sphere(glm::vec3(1, -2, 0), aimPointRadius));
-
-	light.clear();
-
-	light.push_back(new Light(glm::vec3(10, 5, 5), aimPoint[0]->position, .2, 15, 5));			//top right light
-	numofLights++;
-
-	scene[0]->setImage(groundTexture);
-	scene[0]->setImageSpec(groundTextureSpecular);
-
-
-	scene[1]->setImage(wallTexture);
-	scene[1]->setImageSpec(wallTextureSpecular);
+	buildDefaultScene(store, aimPointRadius);
+	numofLights = light.size();
 
 	cout << "t to start ray tracer" << endl;
 	cout << "r to toggle render image" << endl;
 	cout << "c to toggle camera control" << endl;
 	cout << "j to create new sphere" << endl;
-	cout << "d to delete selected sphere" << endl;
+	cout << "d to delete selected sphere, SDF object, mesh or instance set" << endl;
 	cout << "l to create new light" << endl;
 	cout << "k to delete selected light" << endl;
+	cout << "v to frame the render camera from the current view, F3 to look through it" << endl;
+	cout << "w to write the scene to scene.scene, drop a .scene or .bscene file to load one" << endl;
+	cout << "drop an .obj or .ply file to add it to the scene as a mesh" << endl;
 	cout << "h to toggle gui" << endl;
-	cout << "select a sphere or a light to change the parameters" << endl;
+	cout << "p to toggle render profiling, reported to profile.json and heatmap.png" << endl;
+	cout << "o to cycle output format (none, png, ppm, pfm), now " << ImageWriter::name(writer.format) << endl;
+	cout << "select a sphere or a light to change the parameters, drag an instance to move it" << endl;
 }
 
 //--------------------------------------------------------------
@@ -133,14 +73,21 @@ void ofApp::update() {
 	float angle = spotLightAngle;
 
 	glm::vec3 colorSlider = color;
+	ofColor diffuse = ofColor(colorSlider.x, colorSlider.y, colorSlider.z);
 
 	//update scene object parameters
 	//
 	for (int i = 0; i < scene.size(); i++) {
 		if (objSelected()) {
-			if (scene[i] == selected[0]) {
+			if (scene[i] == selected[0] && (scene[i]->radius != scale || scene[i]->diffuseColor != diffuse ||
+				scene[i]->reflectivity != reflectivity || scene[i]->transparency != transparency || scene[i]->ior != ior)) {
+				sceneEdited();
+				if (scene[i]->radius != scale) tracer.markObjectsMoved();
 				scene[i]->radius = scale;
-				scene[i]->diffuseColor = ofColor(colorSlider.x, colorSlider.y, colorSlider.z);
+				scene[i]->diffuseColor = diffuse;
+				scene[i]->reflectivity = reflectivity;
+				scene[i]->transparency = transparency;
+				scene[i]->ior = ior;
 			}
 		}
 	}
@@ -149,9 +96,15 @@ void ofApp::update() {
 	//update light parameters
 	//
 	for (int i = 0; i < light.size(); i++) {
-		light[i]->aimPoint = aimPoint[i]->position;
+		if (light[i]->aimPoint != aimPoint[i]->position) {
+			sceneEdited();
+			light[i]->aimPoint = aimPoint[i]->position;
+		}
 		if (objSelected()) {
-			if (light[i] == selected[0]) {
+			int type = light[i]->isSpotLight ? 2 : light[i]->isAreaLight ? 3 : 1;
+			if (light[i] == selected[0] && (light[i]->radius != scale || light[i]->intensity != intensity ||
+				light[i]->power != power || light[i]->coneAngleDeg != angle || light[i]->Width != areaLightWidth || type != lightTypeToggle)) {
+				sceneEdited();
 				light[i]->radius = scale;
 				light[i]->intensity = intensity;
 				light[i]->power = power;
@@ -165,7 +118,60 @@ void ofApp::update() {
 		}
 	}
 
+	//anti-aliasing and light sampling changes re-render like any other
+	//edit, but from scratch: the cached frame was sampled with the old
+	//settings
+	//
+	if (tracer.aaSamples != aaSamples || tracer.lightSamples != lightSamples) {
+		sceneEdited();
+		tracer.aaSamples = aaSamples;
+		tracer.lightSamples = lightSamples;
+		tracer.frameCache.invalidate();
+	}
+
+	//restart the live render after edits, then pick up its newest pass
+	//
+	if (restartRender) {
+		restartRender = false;
+		progressive.start(imageWidth, imageHeight);
+	}
+
+	bool finished = progressive.isFinished();
+	if (progressive.fetch(image.getPixels())) {
+		image.update();
+	}
+	if (finished && saveWhenDone) {
+		saveWhenDone = false;
+		writer.write(image.getPixels(), progressive.getRadiance());
+		if (progressive.wasIncremental()) {
+			const RayTracer::IncrementalStats& stats = tracer.getIncrementalStats();
+			cout << "render updated in " << progressive.getTotalMillis() << " ms, " << stats.retraced << " pixels retraced, "
+				<< stats.reshaded << " reshaded" << endl;
+		}
+		else {
+			cout << "render done, first preview " << progressive.getFirstPassMillis() << " ms, done in "
+				<< progressive.getTotalMillis() << " ms" << endl;
+		}
+		if (tracer.aaSamples > 1) {
+			const RayTracer::AntiAliasStats& stats = tracer.getAntiAliasStats();
+			cout << "anti-aliased " << stats.edgePixels << " edge pixels, " << (double)stats.rays / stats.pixels << " rays per pixel" << endl;
+		}
+		if (renderProfiler().isEnabled()) {
+			renderProfiler().printSummary(cout);
+			renderProfiler().saveJson(ofToDataPath("profile.json"));
+			renderProfiler().saveHeatmap(ofToDataPath("heatmap.png"));
+		}
+	}
+}
 
+//--------------------------------------------------------------
+//called before any change to the scene objects or lights
+//stops the background render so it never sees a half-made edit, and
+//queues a restart for the next update if the render is live
+//
+void ofApp::sceneEdited() {
+	progressive.cancel();
+	if (liveRender) restartRender = true;
 }
 
 //--------------------------------------------------------------
@@ -195,7 +201,11 @@ void ofApp::draw(){
 		}
 	}
 
-	//renderCam.view.draw();
+	//the render camera's frustum, unless looking through it
+	if (theCam != &previewCam) {
+		ofSetColor(ofColor::white);
+		renderCam.drawFrustum();
+	}
 
 
 	theCam->end();
@@ -234,6 +244,10 @@ void ofApp::keyPressed(int key){
 	case 'h':
 		bHide = !bHide;
 		break;
+	case 'o':
+		writer.format = (OutputFormat)((writer.format + 1) % (OUTPUT_PFM + 1));
+		cout << "output format " << ImageWriter::name(writer.format) << endl;
+		break;
 	case 'c':
 		if (mainCam.getMouseInputEnabled()) mainCam.disableMouseInput();
 		else mainCam.enableMouseInput();
@@ -250,6 +264,16 @@ void ofApp::keyPressed(int key){
 	case 'k':
 		deleteLight();
 		break;
+	case 'v':
+		frameRenderCam();
+		break;
+	case 'w':
+		saveScene("scene.scene");
+		break;
+	case 'p':
+		renderProfiler().setEnabled(!renderProfiler().isEnabled());
+		cout << "profiling " << (renderProfiler().isEnabled() ? "on" : "off") << ", from the next render" << endl;
+		break;
 	default:
 		break;
 	}
@@ -272,8 +296,16 @@ void ofApp::mouseDragged(int x, int y, int button){
 	if (objSelected() && bDrag) {
 		glm::vec3 point;
 		mouseToDragPlane(x, y, point);
-		selected[0]->position += (point - lastPoint);
+		sceneEdited();
+
+		//an instance moves on its own, refitting only its set's top level
+		if (selected[0]->type == OBJECT_INSTANCES) {
+			InstanceSet* set = static_cast<InstanceSet*>(selected[0]);
+			if (selectedInstance >= 0) set->moveInstance(selectedInstance, set->instances[selectedInstance].position + (point - lastPoint));
+		}
+		else selected[0]->position += (point - lastPoint);
 		lastPoint = point;
+		tracer.markObjectsMoved();
 	}
 
 }
@@ -377,6 +409,7 @@ void ofApp::mousePressed(int x, int y, int button){
 	if (selectedObj) {
 		selected.push_back(selectedObj);
 		selectedObj->isSelected = true;
+		selectedInstance = selectedObj->type == OBJECT_INSTANCES ? static_cast<InstanceSet*>(selectedObj)->pick(Ray(p, dn)) : -1;
 
 
 		//reset gui variables to selected object parameters
@@ -390,6 +423,9 @@ void ofApp::mousePressed(int x, int y, int button){
 		power = selectedObj->power;
 		spotLightAngle = selectedObj->coneAngleDeg;
 		areaLightWidth = selectedObj->Width;
+		reflectivity = selectedObj->reflectivity;
+		transparency = selectedObj->transparency;
+		ior = selectedObj->ior;
 
 		if (selectedObj->isSpotLight) {
 			lightTypeToggle = 2;
@@ -436,7 +472,9 @@ void ofApp::gotMessage(ofMessage msg){
 
 //--------------------------------------------------------------
 void ofApp::dragEvent(ofDragInfo dragInfo){ 
-
+	if (dragInfo.files.size() == 0) return;
+	if (isMeshPath(dragInfo.files[0])) addMesh(dragInfo.files[0]);
+	else loadScene(dragInfo.files[0]);
 }
 
 //--------------------------------------------------------------
@@ -453,6 +491,7 @@ bool ofApp::mouseToDragPlane(int x, int y, glm::vec3& point) {
 	glm::vec3 pos;
 	if (objSelected()) {
 		pos = selected[0]->position;
+		if (selected[0]->type == OBJECT_INSTANCES && selectedInstance >= 0) pos += static_cast<InstanceSet*>(selected[0])->instances[selectedInstance].position;
 	}
 	else pos = glm::vec3(0, 0, 0);
 	if (glm::intersectRayPlane(p, dn, pos, glm::normalize(theCam->getZAxis()), dist)) {
@@ -467,21 +506,24 @@ bool ofApp::mouseToDragPlane(int x, int y, glm::vec3& point) {
 //
 void ofApp::createSphere() {
 
-	scene.push_back(new Sphere(glm::vec3(0, 0, 0), sphereRadius, ofColor::blue));
+	sceneEdited();
+	store.addSphere(glm::vec3(0, 0, 0), sphereRadius, ofColor::blue);
+	tracer.markSceneChanged();
 
 }
 
 
 //--------------------------------------------------------------
-//deletes selected sphere from scene
+//deletes selected sphere, SDF object, mesh or instance set from scene
+//and frees it
 //
 void ofApp::deleteSphere() {
 	if (objSelected() && selected[0]) {
-		for (int i = 0; i < scene.size(); i++)
-		{
-			if (scene[i] == selected[0]) {
-				scene.erase(scene.begin() + i);
-			}
+		ObjectType type = selected[0]->handle.type;
+		if (type == OBJECT_SPHERE || type == OBJECT_SDF || type == OBJECT_MESH || type == OBJECT_INSTANCES) {
+			sceneEdited();
+			store.remove(selected[0]);
+			tracer.markSceneChanged();
 		}
 		selected.clear();
 	}
@@ -491,374 +533,113 @@ void ofApp::deleteSphere() {
 //creates an new light and pushes it onto scene vector
 //
 void ofApp::createLight() {
-	aimPoint.push_back(new Sphere(glm::vec3(3, -2, 0), aimPointRadius));
-	light.push_back(new Light(glm::vec3(1, 1, 1), aimPoint[numofLights]->position, .2, 10, 5));		//top left light
+	sceneEdited();
+	store.addLight(glm::vec3(1, 1, 1), glm::vec3(3, -2, 0), .2, 10, 5, aimPointRadius);		//top left light
 	numofLights++;
 }
 
 
 //--------------------------------------------------------------
-//deletes selected light from scene
+//deletes selected light and its aim point from scene and frees them
 //
 void ofApp::deleteLight() {
 	if (objSelected() && selected[0]) {
-		for (int i = 0; i < light.size(); i++)
-		{
-			if (light[i] == selected[0]) {
-				light.erase(light.begin() + i);
-				aimPoint.erase(aimPoint.begin() + i);
-				numofLights--;
-			}
+		if (selected[0]->handle.type == OBJECT_LIGHT) {
+			sceneEdited();
+			store.remove(selected[0]);
+			numofLights--;
 		}
 		selected.clear();
 	}
 }
 
 //--------------------------------------------------------------
-//ray tracing algorithm
-//loops through all pixels in image
-//shades each pixel with phong shading
-//saves image to disk
+//replaces the scene with the one in a .scene or .bscene file
+//the current scene is kept if the file does not load
 //
-void ofApp::rayTrace() {
-
-	cout << "drawing..." << endl;
-
-	ofColor closest;
-	float distance = FLT_MIN;
-	float close = FLT_MAX;
-	closestIndex = 0;
-	for (int i = 0; i < image.getWidth(); i++) {
-		for (int j = 0; j < image.getHeight(); j++) {
-			background = true;																//reset variables every pixel
-			distance = FLT_MIN;
-			close = FLT_MAX;
-			closestIndex = 0;
-
-			float u = (i + .5) / image.getWidth();
-			float v = 1 - (j + .5) / image.getHeight();
-
-			Ray r = renderCam.getRay(u, v);
-			for (int k = 0; k < scene.size(); k++) {
-				if (scene[k]->intersect(r, scene[k]->intersectionPoint, glm::vec3(0, 1, 0))) {
-					background = false;														//if intersected with scene object, pixel is not background
-
-					distance = glm::distance(r.p, scene[k]->position);						//calculate distance of intersection
-					if (distance < close)													//if current object is closest to viewplane
-					{
-						closestIndex = k;													//save index of closest object
-						close = distance;													//set threshold to new closest distance
-					}
-				}
-			}
-			if (!background) {
-				//get diffuse and specular
-				ofColor diffuse = scene[closestIndex]->getDiffuse(r.evalPoint(close));
-				ofColor specular = scene[closestIndex]->getSpecular(r.evalPoint(close));
-
-				//add shading contribution
-				closest = shade(r.evalPoint(close), scene[closestIndex]->getNormal(glm::vec3(0, 0, 0)), diffuse, close, specular, power, r);
-				image.setColor(i, j, closest);
-			}
-			else if (background) {
-				image.setColor(i, j, ofColor::black);
-			}
-		}
-	}
-
-	image.save("output.png");
-	image.load("output.png");
-
-	cout << "render saved" << endl;
-}
-
-//--------------------------------------------------------------
-//adds shading contribution
-//calculates shadows
-//returns shaded color
-//
-ofColor ofApp::shade(const glm::vec3& p, const glm::vec3& norm, const ofColor diffuse, float distance, const ofColor specular, float power, Ray r) {
-	ofColor shaded = (0, 0, 0);
-	glm::vec3 p1 = p;
-
-	//loop through all lights
-	for (int i = 0; i < light.size(); i++) {
-		blocked = false;
-
-		//test for shadows
-		if (closestIndex < 2) {								//if the closest object is one of the planes
-
-			for (int k = 0; k < 2; k++) {
-				if (scene[k]->intersect(r, p1, glm::vec3(0, 1, 0))) {													//check if current point intersected with ground plane
-
-					Ray shadowRay = Ray(scene[k]->getIntersectionPoint(), light[i]->position - scene[k]->getIntersectionPoint());
-
-					//check all sphere objects
-					for (int j = 2; j < scene.size(); j++) {
-						if (scene[j]->intersect(shadowRay, p1, scene[j]->getNormal(p1))) {
-							blocked = true;
-						}
-					}
-				}
-			}
-		}
-		if (!blocked) {
-			//add shading contribution for current light
-			//
-			if (light[i]->isSpotLight) {
-				shaded = spotLightPhong(p, norm, diffuse, specular, light[i]->power, distance, r, *light[i]);
-			}
-			else if (light[i]->isAreaLight) {
-				shaded = areaLightPhong(p, norm, diffuse, specular, light[i]->power, distance, r, *light[i]);
-			}
-			else {
-				shaded += phong(p, norm, diffuse, specular, light[i]->power, distance, r, *light[i]);
-			}
-		}
-	}
-	return shaded;
+bool ofApp::loadScene(const string& path) {
+	sceneEdited();
+	SceneFile sceneFile;
+	if (!sceneFile.load(path)) return false;
+	selected.clear();
+	sceneFile.instantiate(store, renderCam, aimPointRadius);
+	renderCam.setAspect((float)imageWidth / imageHeight);
+	syncPreviewCam();
+	numofLights = light.size();
+	tracer.markSceneChanged();
+	cout << "loaded " << path << ": " << sceneFile.getNumPlanes() << " planes, " << sceneFile.getNumSpheres() << " spheres, "
+		<< sceneFile.getNumSDFs() << " SDF objects, " << sceneFile.getNumMeshes() << " meshes, " << sceneFile.getNumInstances() << " instances, "
+		<< sceneFile.getNumLights() << " lights" << endl;
+	return true;
 }
 
 //--------------------------------------------------------------
-//calculates all shading for point lights including:
-// lambert
-// phong
-// ambient
-//returns shaded color
+//loads an OBJ or PLY file and adds it to the scene at the origin
+//the scene is left alone if the file does not load
 //
-ofColor ofApp::phong(const glm::vec3& p, const glm::vec3& norm, const ofColor diffuse, const ofColor specular, float power, float distance, Ray r, Light light) {
-	ofColor phong = ofColor(0, 0, 0);
-	glm::vec3 h = glm::vec3(0);
-
-	glm::vec3 l = glm::normalize(light.position - p);
-	glm::vec3 v = glm::normalize(renderCam.position - p);
-	h = glm::normalize(l + v);
-
-	float distance1 = glm::distance(light.position, p);
-
-
-	phong += (ambient(diffuse)) + (lambert(p, norm, diffuse, distance1, r, light)) + (specular * (light.intensity / distance1 * distance1) * glm::pow(glm::max(zero, glm::dot(norm, h)), power));
-
-	return phong;
-}
-
-//--------------------------------------------------------------
-//calculates lambert shading for point lights
-//returns shaded color
+bool ofApp::addMesh(const string& path) {
+	uint64_t start = ofGetElapsedTimeMillis();
+	std::shared_ptr<TriangleMesh> mesh = std::make_shared<TriangleMesh>();
+	if (!loadMesh(path, *mesh)) return false;
+	sceneEdited();
+	MeshObject* object = store.addMesh(glm::vec3(0, 0, 0), mesh);
+	object->path = path;
+	tracer.markSceneChanged();
+	cout << "loaded " << path << ": " << mesh->getNumTriangles() << " triangles, " << mesh->getNumVertices() << " vertices, "
+		<< mesh->getMemoryBytes() / (1 << 20) << " MB, in " << ofGetElapsedTimeMillis() - start << " ms" << endl;
+	return true;
+}
+
+//--------------------------------------------------------------
+//moves the render camera to the current view, field of view included,
+//so a shot can be framed with the mouse and then rendered
 //
-ofColor ofApp::lambert(const glm::vec3& p, const glm::vec3& norm, const ofColor diffuse, float distance, Ray r, Light light) {
-	ofColor lambert = ofColor(0, 0, 0);
-	float distance1 = glm::distance(light.position, p);
-
-	glm::vec3 l = glm::normalize(light.position - p);
-	lambert += diffuse * (light.intensity / distance1 * distance1) * (glm::max(zero, glm::dot(norm, l)));
-
-	return lambert;
+void ofApp::frameRenderCam() {
+	if (theCam == &previewCam) return;
+	sceneEdited();
+	renderCam.position = theCam->getPosition();
+	renderCam.lookAt(renderCam.position + theCam->getLookAtDir(), theCam->getUpDir());
+	renderCam.setFov(theCam->getFov());
+	renderCam.setAspect((float)imageWidth / imageHeight);
+	syncPreviewCam();
+	cout << "render camera at " << renderCam.position << ", field of view " << renderCam.getFov() << endl;
 }
 
 //--------------------------------------------------------------
-//calculates all shading for spot lights including:
-// lambert
-// phong
-//returns shaded color
+//the preview camera shows exactly what the render camera renders
 //
-ofColor ofApp::spotLightPhong(const glm::vec3& p, const glm::vec3& norm, const ofColor diffuse, const ofColor specular, float power, float distance, Ray r, Light light) {
-	ofColor phong = ofColor(0, 0, 0);
-	glm::vec3 h = glm::vec3(0);
-
-	glm::vec3 l = glm::normalize(light.position - p);
-	glm::vec3 v = glm::normalize(renderCam.position - p);
-	h = glm::normalize(l + v);
-
-	float distance1 = glm::distance(light.position, p);
-
-
-	phong += (spotLightLambert(p, norm, diffuse, distance1, r, light)) + (specular * (light.intensity / distance1 * distance1) * glm::pow(glm::max(zero, glm::dot(norm, h)), power));
-
-	return phong;
+void ofApp::syncPreviewCam() {
+	previewCam.setPosition(renderCam.position);
+	previewCam.lookAt(renderCam.aim, renderCam.upAxis);
+	previewCam.setFov(renderCam.getFov());
+	previewCam.setAspectRatio(renderCam.getAspect());
+	previewCam.setForceAspectRatio(true);
 }
 
 //--------------------------------------------------------------
-//calculates lambert shading for spot lights
-//returns shaded color
+//writes the scene, binary if the name ends in .bscene
 //
-ofColor ofApp::spotLightLambert(const glm::vec3& p, const glm::vec3& norm, const ofColor diffuse, float distance, Ray r, Light light) {
-	ofColor lambert = ofColor(0, 0, 0);
-	glm::vec3 point, normal;
-
-	float distance1 = glm::distance(light.position, p);
-
-
-	Ray s = Ray(renderCam.position, glm::normalize(p - renderCam.position));
-
-	//calculate angle between cone aim and current point
-	glm::vec3 coneAim = glm::normalize(light.position - light.aimPoint);
-	glm::vec3 pointVec = glm::normalize(light.position - p);
-	float theta = glm::dot(coneAim, pointVec);
-	float angle = glm::acos(theta);
-	//angle = glm::degrees(angle);
-
-	if (angle < light.coneAngle/2) {		//illuminate if p is inside spot light illumination area
-		glm::vec3 l = glm::normalize(light.position - p);
-		lambert += diffuse * (light.intensity / distance1 * distance1) * (glm::max(zero, glm::dot(norm, l)));
-	}
-
-	return lambert;
-}
-
-//--------------------------------------------------------------
-//calculates phong shading for area lights
-// lambert
-// phong
-//returns shaded color
-//
-ofColor ofApp::areaLightPhong(const glm::vec3& p, const glm::vec3& norm, const ofColor diffuse, const ofColor specular, float power, float distance, Ray r, Light light) {
-	ofColor phong = ofColor(0, 0, 0);
-	glm::vec3 h = glm::vec3(0);
-
-	glm::vec3 l = glm::normalize(light.position - p);
-	glm::vec3 v = glm::normalize(renderCam.position - p);
-	h = glm::normalize(l + v);
-
-	float distance1 = glm::distance(light.position, p);
-
-
-	phong += (areaLightLambert(p, norm, diffuse, distance1, r, light)) + (specular * (light.intensity / distance1 * distance1) * glm::pow(glm::max(zero, glm::dot(norm, h)), power));
-
-	return phong;
+void ofApp::saveScene(const string& path) {
+	SceneFile file;
+	file.capture(scene, light, renderCam);
+	if (file.save(path)) cout << "saved " << path << endl;
 }
 
 //--------------------------------------------------------------
-//--------------------------------------------------------------
-//--------------------------------------------------------------
-//--------------------------------------------------------------
-//--------------------------------------------------------------
-//--------------------------------------------------------------
-//--------------------------------------------------------------
-//--------------------------------------------------------------
-// 
-//calculates lambert shading for area lights
-//returns shaded color
+//ray tracing algorithm
+//starts a progressive render in the background and shows it as it
+//refines; update() hands the image to the writer once the last pass is
+//in, the texture is refreshed straight from memory
+//from then on scene edits restart the render
 //
-ofColor ofApp::areaLightLambert(const glm::vec3& p, const glm::vec3& norm, const ofColor diffuse, float distance, Ray r, Light light) {
-	ofColor lambert = ofColor(0, 0, 0);
-	glm::vec3 point, normal;
-
-	float distance1 = glm::distance(light.position, p);
-
-
-
-	//change algorithm here
-	//
-	// 
-	// 
-	// 
-	// 
-	// 
-	// 
-	//
-
-
-
-	//Ray s = Ray(renderCam.position, glm::normalize(p - renderCam.position));
-
-	float dis = glm::distance(light.aimPoint, p);
-
-	if (dis < light.Width) {		//if p is inside spot light illumination area
-		glm::vec3 l = glm::normalize(light.position - p);
-		lambert += diffuse * (light.intensity / distance1 * distance1) * (glm::max(zero, glm::dot(norm, l)));
-	}
-
-
-
-	return lambert;
-}
-
-
-// --------------------------------------------------------------
-//calculates ambient shading
-//returns shaded color
-ofColor ofApp::ambient(const ofColor diffuse) {
-	ofColor ambient = ofColor(0, 0, 0);
-
-	ambient = .05 * diffuse;
-	//ambient = .00 * diffuse;
-
-	return ambient;
-}
-
-//--------------------------------------------------------------
-//converts the current point on the plane to a pixel on texture map
-//returns the color from the texture
-ofColor Plane::textureMap(glm::vec3 p) {
-	ofColor tex = ofColor(0);
-	//ground plane
-	if (normal == glm::vec3(0, 1, 0)) {
-		float x = getIntersectionPoint().x - position.x;
-		float y = getIntersectionPoint().z - position.z;
-
-		float u = ofMap(x, position.x - getWidth() / 2, position.x + getWidth() / 2, 0, floortiles);
-		float v = ofMap(y, position.z - getHeight() / 2, position.z + getHeight() / 2, 0, floortiles);
-
-		int i = u * image.getWidth() - .5;
-		int j = v * image.getHeight() - .5;
-
-		if (i > 0 && j > 0) {
-			tex = image.getColor(fmod(i, image.getWidth()), fmod(j, image.getHeight()));
-		}
-	}
-	//wall plane
-	else if (normal == glm::vec3(0, 0, 1)) {
-		float x = getIntersectionPoint().x - position.x;
-		float y = getIntersectionPoint().y - position.y;
-
-		float u = ofMap(x, position.x - getWidth() / 2, position.x + getWidth() / 2, 0, walltiles);
-		float v = ofMap(y, position.y - getHeight() / 2, position.y + getHeight() / 2, 0, walltiles);
-
-		int i = u * image.getWidth() - .5;
-		int j = v * image.getHeight() - .5;
-
-		if (i > 0 && j > 0) {
-			tex = image.getColor(fmod(i, image.getWidth()), fmod(j, image.getHeight()));
-		}
-	}
-	return tex;
-}
-
-//--------------------------------------------------------------
-//converts the point to a pixel on the texture specular map
-//returns the specular color from the texture
-ofColor Plane::specularTextureMap(glm::vec3 p) {
-	ofColor tex = ofColor(0);
-	//ground plane
-	if (normal == glm::vec3(0, 1, 0)) {
-		float x = getIntersectionPoint().x - position.x;
-		float y = getIntersectionPoint().z - position.z;
-
-		float u = ofMap(x, position.x - getWidth() / 2, position.x + getWidth() / 2, 0, floortiles);
-		float v = ofMap(y, position.z - getHeight() / 2, position.z + getHeight() / 2, 0, floortiles);
-
-		int i = u * imageSpec.getWidth() - .5;
-		int j = v * imageSpec.getHeight() - .5;
-
-		if (i > 0 && j > 0) {
-			tex = imageSpec.getColor(fmod(i, imageSpec.getWidth()), fmod(j, imageSpec.getHeight()));
-		}
-	}
-	//wall plane
-	else if (normal == glm::vec3(0, 0, 1)) {
-		float x = getIntersectionPoint().x - position.x;
-		float y = getIntersectionPoint().y - position.y;
+void ofApp::rayTrace() {
 
-		float u = ofMap(x, position.x - getWidth() / 2, position.x + getWidth() / 2, 0, walltiles);
-		float v = ofMap(y, position.y - getHeight() / 2, position.y + getHeight() / 2, 0, walltiles);
+	cout << "drawing..." << endl;
 
-		int i = u * imageSpec.getWidth() - .5;
-		int j = v * imageSpec.getHeight() - .5;
+	liveRender = true;
+	restartRender = false;
+	saveWhenDone = true;
+	drawImage = true;
 
-		if (i > 0 && j > 0) {
-			tex = imageSpec.getColor(fmod(i, imageSpec.getWidth()), fmod(j, imageSpec.getHeight()));
-		}
-	}
-	return tex;
+	progressive.start(imageWidth, imageHeight);
 }
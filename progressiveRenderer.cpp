@@ -0,0 +1,113 @@
+#include "progressiveRenderer.h"
+#include "renderProfiler.h"
+
+ProgressiveRenderer::ProgressiveRenderer(RayTracer& tracer) : tracer(tracer) {
+}
+
+ProgressiveRenderer::~ProgressiveRenderer() {
+	cancel();
+}
+
+//--------------------------------------------------------------
+//stops any render in progress and starts a new one at width x height,
+//as an incremental update of the last frame when the tracer can do that
+//the BVH and light records are brought up to date here, on the caller's
+//thread, so the render thread never looks at Light objects
+//
+void ProgressiveRenderer::start(int width, int height) {
+	cancel();
+	if (renderProfiler().isEnabled()) renderProfiler().reset();
+
+	tracer.prepareFrame();
+	if (radiance.getWidth() != width || radiance.getHeight() != height) {
+		radiance.allocate(width, height);
+	}
+	incremental = tracer.canRenderIncremental(radiance);
+
+	cancelled = false;
+	finished = false;
+	running = true;
+	thread = std::thread(&ProgressiveRenderer::run, this);
+}
+
+//--------------------------------------------------------------
+//asks the render thread to stop and waits for it
+//afterwards the scene can be edited safely
+//
+void ProgressiveRenderer::cancel() {
+	cancelled = true;
+	if (thread.joinable()) thread.join();
+	running = false;
+}
+
+//--------------------------------------------------------------
+//render thread: one pass per block size, the extra passes that average
+//out sampled lights, then the anti-aliasing pass, each published as it
+//completes; an incremental update is a single pass
+//
+void ProgressiveRenderer::run() {
+	auto start = std::chrono::steady_clock::now();
+	auto millis = [&]() { return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count(); };
+
+	if (incremental) {
+		if (!tracer.renderIncremental(radiance, &cancelled)) {
+			running = false;
+			return;
+		}
+		publish();
+		firstPassMillis = totalMillis = millis();
+		finished = true;
+		running = false;
+		return;
+	}
+
+	int coarser = 0;
+	for (int block = coarsestBlock; block >= 1; block /= 2) {
+		if (!tracer.renderPass(radiance, block, coarser, &cancelled)) {
+			running = false;
+			return;
+		}
+		publish();
+		if (block == coarsestBlock) firstPassMillis = millis();
+		coarser = block;
+	}
+	if (tracer.isSamplingLights()) {
+		for (int pass = 1; pass < tracer.lightPasses; pass++) {
+			if (!tracer.lightPass(radiance, pass, &cancelled)) {
+				running = false;
+				return;
+			}
+			publish();
+		}
+	}
+	if (tracer.aaSamples > 1) {
+		if (!tracer.antialiasPass(radiance, &cancelled)) {
+			running = false;
+			return;
+		}
+		publish();
+	}
+
+	totalMillis = millis();
+	finished = true;
+	running = false;
+}
+
+//--------------------------------------------------------------
+//tone maps the radiance into the back buffer and swaps it to the front
+//
+void ProgressiveRenderer::publish() {
+	radiance.toPixels(back, tracer.exposure, tracer.toneMap);
+
+	std::lock_guard<std::mutex> lock(frontLock);
+	back.swap(front);
+	fresh = true;
+}
+
+bool ProgressiveRenderer::fetch(ofPixels& pixels) {
+	std::lock_guard<std::mutex> lock(frontLock);
+	if (!fresh) return false;
+	pixels.swap(front);
+	fresh = false;
+	return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "rayTracer.h"
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+//  Runs a RayTracer on a background thread, coarse to fine: one ray per
+//  8x8 block first, then 4x4, 2x2, every pixel and, if the tracer has them
+//  on, passes with other sampled lights and the anti-aliased edges.  After
+//  each pass the tone mapped frame is handed to the UI thread through a
+//  double buffer, so the window keeps drawing and shows the first rough
+//  image almost immediately.  When the tracer still has the previous
+//  frame cached, only the pixels an edit touched are rendered, in a
+//  single pass.
+//
+//  The scene must not be edited while a render runs.  Call cancel() before
+//  any edit (it returns once the render thread has stopped, within about
+//  one tile) and start() again afterwards.
+//
+class ProgressiveRenderer {
+public:
+	ProgressiveRenderer(RayTracer& tracer);
+	~ProgressiveRenderer();
+
+	void start(int width, int height);
+	void cancel();
+
+	bool isRunning() const { return running; }
+	bool isFinished() const { return finished; }
+	bool wasIncremental() const { return incremental; }
+
+	//  swaps the newest finished pass into pixels; false if nothing new
+	//  arrived since the last call
+	//
+	bool fetch(ofPixels& pixels);
+
+	//  radiance of the last pass; only valid while no render is running
+	//
+	const RadianceBuffer& getRadiance() const { return radiance; }
+
+	float getFirstPassMillis() const { return firstPassMillis; }
+	float getTotalMillis() const { return totalMillis; }
+
+	static const int coarsestBlock = 8;
+
+private:
+	void run();
+	void publish();
+
+	RayTracer& tracer;
+	RadianceBuffer radiance;
+
+	std::thread thread;
+	std::atomic<bool> cancelled{ false };
+	std::atomic<bool> running{ false };
+	std::atomic<bool> finished{ false };
+	bool incremental = false;	// set by start(), before the thread runs
+
+	std::mutex frontLock;
+	ofPixels back;			// tone mapped by the render thread
+	ofPixels front;			// last complete pass, waiting for fetch()
+	bool fresh = false;
+
+	std::atomic<float> firstPassMillis{ 0 };
+	std::atomic<float> totalMillis{ 0 };
+};
@@ -0,0 +1,125 @@
+#include "radianceBuffer.h"
+#include "renderProfiler.h"
+
+#include <cmath>
+#include <fstream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RADIANCE_SSE2
+#include <emmintrin.h>
+#endif
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "toPixels reads the buffer as packed floats");
+
+void RadianceBuffer::allocate(int w, int h) {
+	width = w;
+	height = h;
+	data.assign(w * h, glm::vec3(0));
+}
+
+void RadianceBuffer::clear() {
+	std::fill(data.begin(), data.end(), glm::vec3(0));
+}
+
+//--------------------------------------------------------------
+//tone maps and quantizes one channel, NaN goes to black
+//rounds to nearest like the SIMD path
+//
+static unsigned char quantize(float x, float exposure, ToneMap toneMap) {
+	x *= exposure;
+	if (toneMap == TONEMAP_REINHARD) x = x / (1 + x);
+	x = x > 0 ? x : 0;
+	x = x < 1 ? x : 1;
+	return (unsigned char)lrintf(x * 255);
+}
+
+//--------------------------------------------------------------
+//tone map pass from linear radiance to 8 bit RGB
+//treats the buffer as one flat float array and converts 16 channels per
+//iteration when SSE2 is available
+//
+void RadianceBuffer::toPixels(ofPixels& pixels, float exposure, ToneMap toneMap) const {
+	ProfileScope encode(PROFILE_ENCODE);
+	if (pixels.getWidth() != width || pixels.getHeight() != height || pixels.getNumChannels() < 3) {
+		pixels.allocate(width, height, OF_IMAGE_COLOR);
+	}
+
+	const float* src = getData();
+	unsigned char* dst = pixels.getData();
+
+	if (pixels.getNumChannels() != 3) {						//RGBA, fill alpha as opaque
+		for (int j = 0; j < height; j++) {
+			for (int i = 0; i < width; i++) {
+				const glm::vec3& c = at(i, j);
+				pixels.setColor(i, j, ofColor(quantize(c.x, exposure, toneMap), quantize(c.y, exposure, toneMap), quantize(c.z, exposure, toneMap)));
+			}
+		}
+		return;
+	}
+
+	int n = width * height * 3;
+	int k = 0;
+
+#ifdef RADIANCE_SSE2
+	const __m128 scale = _mm_set1_ps(exposure);
+	const __m128 one = _mm_set1_ps(1);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 full = _mm_set1_ps(255);
+	bool reinhard = toneMap == TONEMAP_REINHARD;
+
+	for (; k + 16 <= n; k += 16) {
+		__m128i q[4];
+		for (int m = 0; m < 4; m++) {
+			__m128 x = _mm_mul_ps(_mm_loadu_ps(src + k + 4 * m), scale);
+			if (reinhard) x = _mm_div_ps(x, _mm_add_ps(one, x));
+			x = _mm_min_ps(_mm_max_ps(x, zero), one);			//max returns zero for NaN
+			q[m] = _mm_cvtps_epi32(_mm_mul_ps(x, full));
+		}
+		__m128i lo = _mm_packs_epi32(q[0], q[1]);
+		__m128i hi = _mm_packs_epi32(q[2], q[3]);
+		_mm_storeu_si128((__m128i*)(dst + k), _mm_packus_epi16(lo, hi));
+	}
+#endif
+
+	for (; k < n; k++) {
+		dst[k] = quantize(src[k], exposure, toneMap);
+	}
+}
+
+//--------------------------------------------------------------
+//copies the linear radiance into float RGB pixels
+//
+void RadianceBuffer::toFloatPixels(ofFloatPixels& pixels) const {
+	pixels.allocate(width, height, OF_IMAGE_COLOR);
+	memcpy(pixels.getData(), getData(), width * height * 3 * sizeof(float));
+}
+
+bool RadianceBuffer::isHdrPath(const string& path) {
+	string ext = ofToLower(ofFilePath::getFileExt(path));
+	return ext == "pfm" || ext == "exr" || ext == "hdr";
+}
+
+bool RadianceBuffer::saveHdr(const string& path) const {
+	string ext = ofToLower(ofFilePath::getFileExt(path));
+	if (ext == "pfm") return savePfm(path);
+	if (ext != "exr" && ext != "hdr") return false;
+
+	ofFloatPixels pixels;
+	toFloatPixels(pixels);
+	return ofSaveImage(pixels, path);
+}
+
+//--------------------------------------------------------------
+//portable float map: text header, then little endian RGB floats with
+//the bottom row first
+//
+bool RadianceBuffer::savePfm(const string& path) const {
+	std::ofstream file(path, std::ios::binary);
+	if (!file) return false;
+
+	file << "PF\n" << width << " " << height << "\n-1.0\n";
+	for (int j = height - 1; j >= 0; j--) {
+		file.write((const char*)&at(0, j), width * sizeof(glm::vec3));
+	}
+	return (bool)file;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "ofMain.h"
+
+enum ToneMap {
+	TONEMAP_CLAMP,          // clip at 1, same look as the old 8 bit shading
+	TONEMAP_REINHARD        // x / (1 + x), keeps highlights from several lights
+};
+
+//  Linear floating point radiance for every pixel of a frame, 1.0 = full
+//  white.  Shading adds light contributions here without clamping; the
+//  only quantization is the single tone map pass that produces the 8 bit
+//  image for display.  The same data can be written out as HDR.
+//
+//  Pixels are packed vec3s with no padding, so the buffer is also a flat
+//  array of width * height * 3 floats in ofPixels RGB order.
+//
+class RadianceBuffer {
+public:
+	void allocate(int width, int height);
+	void clear();
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	bool isAllocated() const { return !data.empty(); }
+
+	glm::vec3& at(int i, int j) { return data[j * width + i]; }
+	const glm::vec3& at(int i, int j) const { return data[j * width + i]; }
+	float* getData() { return &data[0].x; }
+	const float* getData() const { return &data[0].x; }
+
+	//  exposure scales radiance before the tone map; pixels are allocated
+	//  as RGB at this buffer's size if they do not match
+	//
+	void toPixels(ofPixels& pixels, float exposure = 1, ToneMap toneMap = TONEMAP_CLAMP) const;
+	void toFloatPixels(ofFloatPixels& pixels) const;
+
+	//  writes linear radiance: .pfm directly, .exr and .hdr through
+	//  ofSaveImage; returns false for other extensions or on failure
+	//
+	bool saveHdr(const string& path) const;
+	bool savePfm(const string& path) const;
+
+	static bool isHdrPath(const string& path);
+
+private:
+	int width = 0;
+	int height = 0;
+	vector<glm::vec3> data;
+};
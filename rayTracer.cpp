@@ -0,0 +1,1270 @@
+#include "rayTracer.h"
+#include "renderProfiler.h"
+#include "instanceSet.h"
+
+#include <cstring>
+
+//--------------------------------------------------------------
+//integer hash, used to jitter area light samples; the same point always
+//gets the same samples, whichever thread or pass shades it
+//
+static unsigned int hashBits(unsigned int x) {
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+	return x;
+}
+
+static unsigned int hashPoint(const glm::vec3& p) {
+	unsigned int bits[3];
+	memcpy(bits, &p, sizeof(bits));
+	return hashBits(bits[0] ^ hashBits(bits[1] ^ hashBits(bits[2])));
+}
+
+static float unitFloat(unsigned int bits) {
+	return (bits >> 8) * (1.0f / 16777216.0f);
+}
+
+//  each worker's primary hits and light list for the tile it is on,
+//  kept between tiles so their storage is reused
+//
+static thread_local vector<RayTracer::PrimaryHit> tileHits;
+static thread_local vector<int> tileLights;
+
+//--------------------------------------------------------------
+//index-th point of the radical inverse sequence in base, in [0, 1)
+//
+static float halton(int index, int base) {
+	float result = 0;
+	float f = 1;
+	while (index > 0) {
+		f /= base;
+		result += f * (index % base);
+		index /= base;
+	}
+	return result;
+}
+
+//--------------------------------------------------------------
+//how a mirror or glass surface divides what leaves it towards a ray
+//arriving along d: its own shading, the reflected ray and the refracted
+//ray, each with the tint it carries; the three weights sum to one
+//
+struct SurfaceSplit {
+	float local = 1;
+	glm::vec3 reflect = glm::vec3(0);
+	glm::vec3 refract = glm::vec3(0);
+	glm::vec3 facing;			// the normal on the side d arrives from
+	glm::vec3 reflectDir;
+	glm::vec3 refractDir;
+};
+
+//--------------------------------------------------------------
+//unpolarized Fresnel reflectance of a dielectric boundary, light going
+//from index n1 into n2; 1 on total internal reflection
+//
+static float fresnel(float cosI, float n1, float n2, float& cosT) {
+	float eta = n1 / n2;
+	float sin2T = eta * eta * (1 - cosI * cosI);
+	if (sin2T >= 1) {
+		cosT = 0;
+		return 1;
+	}
+	cosT = std::sqrt(1 - sin2T);
+	float rs = (n1 * cosI - n2 * cosT) / (n1 * cosI + n2 * cosT);
+	float rp = (n1 * cosT - n2 * cosI) / (n1 * cosT + n2 * cosI);
+	return .5f * (rs * rs + rp * rp);
+}
+
+//--------------------------------------------------------------
+//bends says whether the surface encloses a volume rays refract into;
+//elsewhere the transmitted ray keeps its direction
+//
+static SurfaceSplit splitSurface(const glm::vec3& d, const glm::vec3& normal, const MaterialRecord& material, bool bends) {
+	SurfaceSplit split;
+	float cosI = -glm::dot(d, normal);
+	bool entering = cosI >= 0;
+	split.facing = entering ? normal : -normal;
+	cosI = std::min(std::abs(cosI), 1.0f);
+	split.reflectDir = glm::normalize(d + 2 * cosI * split.facing);
+
+	//mirror: Schlick's approximation from the head-on reflectance
+	float mirror = 0;
+	if (material.reflectivity > 0) {
+		float m = 1 - cosI;
+		mirror = material.reflectivity + (1 - material.reflectivity) * m * m * m * m * m;
+	}
+
+	//glass: exact Fresnel, inside to outside when leaving a volume
+	float t = material.transparency;
+	float glass = 0;
+	if (t > 0) {
+		float n1 = entering || !bends ? 1 : material.ior;
+		float n2 = entering || !bends ? material.ior : 1;
+		float cosT;
+		glass = fresnel(cosI, n1, n2, cosT);
+		float eta = n1 / n2;
+		split.refractDir = bends ? glm::normalize(eta * d + (eta * cosI - cosT) * split.facing) : d;
+	}
+
+	split.local = (1 - t) * (1 - mirror);
+	split.reflect = (1 - t) * mirror * material.specular + glm::vec3(t * glass);
+	split.refract = t * (1 - glass) * material.diffuse;
+	return split;
+}
+
+static float maxComponent(const glm::vec3& v) {
+	return std::max(v.x, std::max(v.y, v.z));
+}
+
+//  a reflected or refracted ray waiting to be traced
+//
+struct SecondaryRay {
+	Ray ray;
+	glm::vec3 throughput;		// share of the pixel it carries
+	float distance;				// from the camera to its origin, for texture footprints
+	int depth;					// bounces so far, 1 for rays leaving the primary hit
+};
+
+static const int maxQueuedRays = 16;
+
+//--------------------------------------------------------------
+//largest channel difference, after clamping to the displayable range
+//
+static float contrast(const glm::vec3& a, const glm::vec3& b) {
+	float dx = std::abs(std::min(a.x, 1.0f) - std::min(b.x, 1.0f));
+	float dy = std::abs(std::min(a.y, 1.0f) - std::min(b.y, 1.0f));
+	float dz = std::abs(std::min(a.z, 1.0f) - std::min(b.z, 1.0f));
+	return std::max(dx, std::max(dy, dz));
+}
+
+RayTracer::RayTracer(vector<SceneObject*>& scene, vector<Light*>& light, RenderCam& renderCam)
+	: scene(scene), light(light), renderCam(renderCam) {
+}
+
+//--------------------------------------------------------------
+//ray tracing algorithm
+//splits the image into tiles and shades them on the worker pool
+//writes linear radiance for every pixel into the buffer
+//
+void RayTracer::render(RadianceBuffer& buffer) {
+	prepareFrame();
+	renderPass(buffer, 1, 0);
+	if (isSamplingLights()) {
+		for (int pass = 1; pass < lightPasses; pass++) lightPass(buffer, pass);
+	}
+	if (aaSamples > 1) antialiasPass(buffer);
+}
+
+//--------------------------------------------------------------
+//brings the BVH and light records up to date with the scene
+//the only part of a frame that reads Light objects or rebuilds shared
+//state, so it runs on the thread that edits the scene
+//
+void RayTracer::prepareFrame() {
+	renderCam.updateBasis();
+	updateBvh();
+	packLights();
+}
+
+//--------------------------------------------------------------
+//one level of a coarse-to-fine render: traces the top left pixel of
+//every blockSize x blockSize block and fills the block with it
+//pixels on the coarser grid were traced by an earlier pass and are
+//skipped (coarserSize 0 = trace all of them)
+//tiles left when cancel is set are skipped; returns false if that
+//happened
+//
+bool RayTracer::renderPass(RadianceBuffer& buffer, int blockSize, int coarserSize, const std::atomic<bool>* cancel) {
+	int width = buffer.getWidth();
+	int height = buffer.getHeight();
+
+	//angle covered by one full resolution pixel, for texture filtering;
+	//pixels traced by the coarse passes are kept in the final frame, so
+	//they must filter as render() would
+	pixelSpread = renderCam.view.width() / width / renderCam.viewDistance;
+	lightSeed = 0;
+
+	//keep what every pixel saw for anti-aliasing and later incremental
+	//frames; the cache is only valid again once the last pass is done
+	recording = incremental || aaSamples > 1;
+	if (recording) frameCache.allocate(width, height, incremental && !isSamplingLights() ? lightRecords.size() : 0);
+	else frameCache.invalidate();
+	aaStats = AntiAliasStats();
+	aaStats.pixels = width * height;
+	aaStats.rays = aaStats.pixels;
+	if (renderProfiler().isEnabled()) renderProfiler().beginImage(width, height);
+
+	std::atomic<int> tiles(0);
+	std::atomic<long long> tileLightCount(0);
+	RenderProfiler& profiler = renderProfiler();
+
+	renderer.setNumThreads(numThreads);
+	renderer.setTileSize(tileSize);
+	renderer.render(width, height, [&](const Tile& tile) {
+		if (cancel && *cancel) return;
+
+		//trace the whole tile first
+		vector<PrimaryHit>& hits = tileHits;
+		hits.clear();
+		int y0 = (tile.y0 + blockSize - 1) / blockSize * blockSize;
+		int x0 = (tile.x0 + blockSize - 1) / blockSize * blockSize;
+		for (int j = y0; j < tile.y1; j += blockSize) {
+			bool rowTraced = coarserSize && j % coarserSize == 0;
+
+			if (blockSize == 1 && !rowTraced && useBvh && usePackets) {
+				for (int i = tile.x0; i < tile.x1; i += RayPacket::maxSize) {
+					tracePacket(i, j, std::min((int)RayPacket::maxSize, tile.x1 - i), width, height, hits);
+				}
+				continue;
+			}
+			for (int i = x0; i < tile.x1; i += blockSize) {
+				if (rowTraced && i % coarserSize == 0) continue;
+				tracePrimary(i, j, width, height, hits);
+			}
+		}
+
+		//then shade it with the lights that can reach its hits
+		const vector<int>* lights = cullTile(hits);
+		tiles++;
+		tileLightCount += lights ? lights->size() : lightRecords.size();
+
+		bool profiling = profiler.isEnabled();
+		for (const PrimaryHit& primary : hits) {
+			int pixel = primary.j * width + primary.i;
+			long long start = profiling ? RenderProfiler::now() : 0;
+			glm::vec3 color = shadeHit(primary.ray, primary.hit, recording ? pixel : -1, lights);
+			if (profiling) profiler.addPixelCost(pixel, primary.cost + RenderProfiler::now() - start);
+
+			for (int y = primary.j; y < std::min(primary.j + blockSize, height); y++) {
+				for (int x = primary.i; x < std::min(primary.i + blockSize, width); x++) {
+					buffer.at(x, y) = color;
+				}
+			}
+		}
+	});
+	if (cancel && *cancel) return false;
+
+	cullStats.tiles = tiles;
+	cullStats.lights = tileLightCount;
+
+	if (blockSize == 1 && recording && aaSamples <= 1) cacheFrame(buffer);
+	return true;
+}
+
+//--------------------------------------------------------------
+//one more full resolution pass with other lights picked, averaged into
+//buffer; the G-buffer keeps the running mean too, so anti-aliasing
+//starts from it
+//
+bool RayTracer::lightPass(RadianceBuffer& buffer, int pass, const std::atomic<bool>* cancel) {
+	int width = buffer.getWidth();
+	int height = buffer.getHeight();
+	pixelSpread = renderCam.view.width() / width / renderCam.viewDistance;
+	lightSeed = pass;
+	float weight = 1.0f / (pass + 1);
+
+	renderer.render(width, height, [&](const Tile& tile) {
+		if (cancel && *cancel) return;
+
+		for (int j = tile.y0; j < tile.y1; j++) {
+			for (int i = tile.x0; i < tile.x1; i++) {
+				HitRecord hit;
+				glm::vec3 color = traceSample(i + .5f, j + .5f, width, height, hit);
+				glm::vec3& mean = buffer.at(i, j);
+				mean += (color - mean) * weight;
+				if (recording) frameCache.at(j * width + i).radiance = mean;
+			}
+		}
+	});
+	return !(cancel && *cancel);
+}
+
+//--------------------------------------------------------------
+//true if the frame cache describes the frame now in buffer and the
+//camera, resolution and object and light counts are unchanged, so
+//renderIncremental() can update it; call after prepareFrame()
+//
+bool RayTracer::canRenderIncremental(const RadianceBuffer& buffer) {
+	return incremental && !isSamplingLights() && frameCache.isValid() && cachedBuffer == &buffer &&
+		frameCache.matches(buffer.getWidth(), buffer.getHeight(), lightRecords.size()) &&
+		frameCache.objects.size() == scene.size() &&
+		frameCache.cameraPosition == renderCam.position && frameCache.viewPosition == renderCam.view.position &&
+		frameCache.viewUp == renderCam.view.up && frameCache.viewMin == renderCam.view.min && frameCache.viewMax == renderCam.view.max;
+}
+
+//--------------------------------------------------------------
+//brings the last frame in buffer up to date with the scene: pixels that
+//can see a changed object are retraced, pixels whose shadow ray to a
+//light may cross one (or whose light changed) reshade just that light,
+//all others are left alone
+//returns false if cancelled; the dirty pixels are then kept and added to
+//the next incremental frame
+//
+bool RayTracer::renderIncremental(RadianceBuffer& buffer, const std::atomic<bool>* cancel) {
+	int width = buffer.getWidth();
+	int height = buffer.getHeight();
+
+	pixelSpread = renderCam.view.width() / width / renderCam.viewDistance;
+	recording = true;
+	if (renderProfiler().isEnabled()) renderProfiler().beginImage(width, height);
+	renderer.setNumThreads(numThreads);
+	renderer.setTileSize(tileSize);
+
+	markDirty(width, height, cancel);
+	if (cancel && *cancel) return false;
+
+	std::atomic<int> retraced(0);
+	std::atomic<int> reshaded(0);
+	renderer.render(width, height, [&](const Tile& tile) {
+		if (cancel && *cancel) return;
+
+		int tileRetraced = 0;
+		int tileReshaded = 0;
+		for (int j = tile.y0; j < tile.y1; j++) {
+			for (int i = tile.x0; i < tile.x1; i++) {
+				int pixel = j * width + i;
+				unsigned int bits = frameCache.dirtyAt(pixel);
+				if (!bits) continue;
+
+				if (bits & FrameCache::retrace) {
+					buffer.at(i, j) = tracePixel(i, j, width, height);
+					tileRetraced++;
+					continue;
+				}
+
+				//same hit, only some lights changed; the sum keeps light order
+				ProfileScope shading(PROFILE_SHADING);
+				GBufferTexel& texel = frameCache.at(pixel);
+				glm::vec3 shaded = glm::vec3(0);
+				for (int l = 0; l < lightRecords.size(); l++) {
+					glm::vec3& contribution = frameCache.contribution(l, pixel);
+					if (bits & frameCache.lightBit(l)) contribution = shadeLight(texel.point, texel.normal, texel.material, lightRecords[l], renderCam.position);
+					shaded += contribution;
+				}
+				texel.radiance = shaded;
+				buffer.at(i, j) = shaded;
+				tileReshaded++;
+			}
+		}
+		retraced += tileRetraced;
+		reshaded += tileReshaded;
+	});
+	if (cancel && *cancel) return false;
+
+	incrementalStats.retraced = retraced;
+	incrementalStats.reshaded = reshaded;
+	aaStats = AntiAliasStats();
+	aaStats.pixels = width * height;
+	aaStats.rays = retraced;
+	if (aaSamples > 1 && !antialias(buffer, cancel, true)) return false;
+
+	cacheFrame(buffer);
+	return true;
+}
+
+//--------------------------------------------------------------
+//pixel rectangle [x0, x1) x [y0, y1) that can see anything inside box,
+//padded by a pixel; the whole image if the box is unbounded or reaches
+//behind the camera
+//
+void RayTracer::screenBounds(const AABB& box, int width, int height, int& x0, int& y0, int& x1, int& y1) {
+	x0 = 0;
+	y0 = 0;
+	x1 = width;
+	y1 = height;
+	if (!box.isBounded()) return;
+
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	for (int k = 0; k < 8; k++) {
+		glm::vec3 c = glm::vec3(k & 1 ? box.max.x : box.min.x, k & 2 ? box.max.y : box.min.y, k & 4 ? box.max.z : box.min.z);
+
+		//project onto the view plane, then into pixels
+		float u, v;
+		if (!renderCam.project(c, u, v)) return;
+		minX = std::min(minX, u * width);
+		maxX = std::max(maxX, u * width);
+		minY = std::min(minY, (1 - v) * height);
+		maxY = std::max(maxY, (1 - v) * height);
+	}
+	x0 = std::max((int)floorf(minX) - 1, 0);
+	y0 = std::max((int)floorf(minY) - 1, 0);
+	x1 = std::min((int)ceilf(maxX) + 1, width);
+	y1 = std::min((int)ceilf(maxY) + 1, height);
+}
+
+//--------------------------------------------------------------
+//true if the segment from p to q passes through box
+//
+static bool segmentHitsBox(const glm::vec3& p, const glm::vec3& q, const AABB& box) {
+	float t0 = 0, t1 = 1;
+	glm::vec3 d = q - p;
+	for (int a = 0; a < 3; a++) {
+		if (std::abs(d[a]) < 1e-12f) {
+			if (p[a] < box.min[a] || p[a] > box.max[a]) return false;
+			continue;
+		}
+		float near = (box.min[a] - p[a]) / d[a];
+		float far = (box.max[a] - p[a]) / d[a];
+		if (near > far) std::swap(near, far);
+		t0 = std::max(t0, near);
+		t1 = std::min(t1, far);
+		if (t0 > t1) return false;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+//true if a shadow ray from p to within spread of the light position can
+//pass through box; the ray is split in four so the part near p is only
+//widened by a little of the spread
+//
+bool RayTracer::shadowMayCross(const glm::vec3& p, const glm::vec3& light, float spread, const AABB& box) {
+	//most rays pass nowhere near: reject by the distance from the box's
+	//centre to the ray's line, against its bounding sphere
+	glm::vec3 d = light - p;
+	glm::vec3 across = glm::cross(box.center() - p, d);
+	float reach = .5f * glm::length(box.extent()) + shadowBias + spread;
+	if (glm::dot(across, across) > reach * reach * glm::dot(d, d)) return false;
+
+	int pieces = spread > 0 ? 4 : 1;
+	for (int k = 0; k < pieces; k++) {
+		float pad = shadowBias + spread * (k + 1) / pieces;
+		AABB grown = AABB(box.min - glm::vec3(pad), box.max + glm::vec3(pad));
+		if (segmentHitsBox(p + (light - p) * ((float)k / pieces), p + (light - p) * ((float)(k + 1) / pieces), grown)) return true;
+	}
+	return false;
+}
+
+//--------------------------------------------------------------
+//compares the scene with the state the cached frame was rendered from
+//and adds the pixels each difference can reach to the dirty mask
+//
+void RayTracer::markDirty(int width, int height, const std::atomic<bool>* cancel) {
+	struct Change {
+		int x0, y0, x1, y1;		// pixels that can see it, before or after
+		AABB before, after;
+		bool moved;
+	};
+	vector<Change> changes;
+	for (int k = 0; k < scene.size(); k++) {
+		const ObjectState& was = frameCache.objects[k];
+		AABB before = was.bounds;
+		AABB bounds = scene[k]->getBounds();
+		bool moved = bounds.min != was.bounds.min || bounds.max != was.bounds.max;
+
+		//adding or moving instances leaves the rest of their set as it
+		//was, so only the places the edited ones left and went to count
+		if (scene[k]->type == OBJECT_INSTANCES && static_cast<const InstanceSet*>(scene[k])->getEdits() != was.edits) {
+			const InstanceSet* set = static_cast<const InstanceSet*>(scene[k]);
+			const AABB& edited = set->getEditedBounds();
+			before = bounds = AABB(edited.min + set->position, edited.max + set->position);
+			moved = true;
+		}
+		if (!moved && scene[k]->diffuseColor == was.diffuse && scene[k]->specularColor == was.specular &&
+			scene[k]->reflectivity == was.reflectivity && scene[k]->transparency == was.transparency && scene[k]->ior == was.ior) continue;
+
+		Change change;
+		change.before = before;
+		change.after = bounds;
+		change.moved = moved;
+		int x0, y0, x1, y1;
+		screenBounds(before, width, height, change.x0, change.y0, change.x1, change.y1);
+		screenBounds(bounds, width, height, x0, y0, x1, y1);
+		change.x0 = std::min(change.x0, x0);
+		change.y0 = std::min(change.y0, y0);
+		change.x1 = std::max(change.x1, x1);
+		change.y1 = std::max(change.y1, y1);
+		changes.push_back(change);
+	}
+
+	//a light that changed needs reshading wherever something is hit
+	unsigned int changedLights = 0;
+	for (int l = 0; l < lightRecords.size(); l++) {
+		if (memcmp(&lightRecords[l], &frameCache.lights[l], sizeof(LightRecord)) != 0) changedLights |= frameCache.lightBit(l);
+	}
+
+	bool anyChange = !changes.empty() || changedLights;
+
+	//area light shadow rays stay within half the rectangle's diagonal of
+	//the ray to its centre, less the nearer they are to the surface
+	vector<float> spreads(lightRecords.size());
+	for (int l = 0; l < lightRecords.size(); l++) {
+		const LightRecord& light = lightRecords[l];
+		spreads[l] = light.type == LIGHT_AREA ? .5f * glm::length(light.edgeU + light.edgeV) : 0;
+	}
+
+	renderer.render(width, height, [&](const Tile& tile) {
+		if (cancel && *cancel) return;
+
+		for (int j = tile.y0; j < tile.y1; j++) {
+			for (int i = tile.x0; i < tile.x1; i++) {
+				int pixel = j * width + i;
+				unsigned int bits = frameCache.dirtyAt(pixel);
+				for (const Change& change : changes) {
+					if (i >= change.x0 && i < change.x1 && j >= change.y0 && j < change.y1) bits |= FrameCache::retrace;
+				}
+
+				//mirrors and glass can show any change anywhere
+				const GBufferTexel& texel = frameCache.at(pixel);
+				if (anyChange && texel.objectIndex >= 0 && texel.material.hasSecondaryRays()) bits |= FrameCache::retrace;
+
+				if (!(bits & FrameCache::retrace) && texel.objectIndex >= 0) {
+					bits |= changedLights;
+					for (int l = 0; l < lightRecords.size(); l++) {
+						if (bits & frameCache.lightBit(l)) continue;
+
+						for (const Change& change : changes) {
+							if (!change.moved) continue;
+							if (shadowMayCross(texel.point, lightRecords[l].position, spreads[l], change.before) ||
+								shadowMayCross(texel.point, lightRecords[l].position, spreads[l], change.after)) {
+								bits |= frameCache.lightBit(l);
+								break;
+							}
+						}
+					}
+				}
+				frameCache.dirtyAt(pixel) = bits;
+			}
+		}
+	});
+}
+
+//--------------------------------------------------------------
+//records the scene state behind the frame just finished in buffer and
+//marks the cache valid, with nothing dirty
+//
+void RayTracer::cacheFrame(const RadianceBuffer& buffer) {
+	frameCache.objects.resize(scene.size());
+	for (int k = 0; k < scene.size(); k++) {
+		SceneObject* object = scene[k];
+		uint32_t edits = 0;
+		if (object->type == OBJECT_INSTANCES) {
+			InstanceSet* set = static_cast<InstanceSet*>(object);
+			edits = set->getEdits();
+			set->clearEditedBounds();
+		}
+		frameCache.objects[k] = ObjectState{ object->getBounds(), object->diffuseColor, object->specularColor,
+			object->reflectivity, object->transparency, object->ior, edits };
+	}
+	frameCache.lights = lightRecords;
+	frameCache.cameraPosition = renderCam.position;
+	frameCache.viewPosition = renderCam.view.position;
+	frameCache.viewUp = renderCam.view.up;
+	frameCache.viewMin = renderCam.view.min;
+	frameCache.viewMax = renderCam.view.max;
+	frameCache.clearDirty();
+	frameCache.validate();
+	cachedBuffer = &buffer;
+}
+
+//--------------------------------------------------------------
+//renders into the radiance member at the size of the pixels, then tone
+//maps it into the allocated RGB pixel buffer in one pass
+//
+void RayTracer::render(ofPixels& pixels) {
+	if (radiance.getWidth() != pixels.getWidth() || radiance.getHeight() != pixels.getHeight()) {
+		radiance.allocate(pixels.getWidth(), pixels.getHeight());
+	}
+	render(radiance);
+	radiance.toPixels(pixels, exposure, toneMap);
+}
+
+//--------------------------------------------------------------
+//copies the shading parameters of every light into lightRecords, and
+//builds the light tree over them when lights are sampled
+//reuses the vector's storage, so after the first frame this allocates
+//nothing but the tree
+//
+void RayTracer::packLights() {
+	lightRecords.clear();
+	for (int i = 0; i < light.size(); i++) {
+		lightRecords.push_back(light[i]->getRecord());
+	}
+	if (isSamplingLights()) lightTree.build(lightRecords);
+}
+
+//--------------------------------------------------------------
+//brings the BVH up to date with any edits since the last frame
+//a refit is kept unless it made the tree much worse than a fresh build
+//
+void RayTracer::updateBvh() {
+	if (!rebuildBvh && refitBvh) {
+		bvh.refit();
+		if (bvh.sahCost() > refitTolerance * builtCost) rebuildBvh = true;
+	}
+	if (rebuildBvh) {
+		bvh.build(scene);
+		builtCost = bvh.sahCost();
+	}
+	rebuildBvh = false;
+	refitBvh = false;
+}
+
+//--------------------------------------------------------------
+//profiler counts for one ray tested against every object
+//
+void RayTracer::countLinearTests() {
+	RenderProfiler& profiler = renderProfiler();
+	if (!profiler.isEnabled()) return;
+	for (int k = 0; k < scene.size(); k++) {
+		if (scene[k]->type == OBJECT_SPHERE) profiler.count(PROFILE_SPHERE_TESTS);
+		else if (scene[k]->type == OBJECT_PLANE) profiler.count(PROFILE_PLANE_TESTS);
+	}
+}
+
+//--------------------------------------------------------------
+//closest hit over the whole scene, nearer than hit.t on entry
+//
+bool RayTracer::intersect(const Ray& ray, HitRecord& hit) {
+	ProfileScope traversal(PROFILE_TRAVERSAL);
+	if (useBvh) return bvh.intersect(ray, hit);
+
+	Ray r = Ray(ray.p, glm::normalize(ray.d));
+	bool found = false;
+	countLinearTests();
+	for (int k = 0; k < scene.size(); k++) {
+		if (scene[k]->intersect(r, 0, hit)) {
+			hit.objectIndex = k;
+			found = true;
+		}
+	}
+	return found;
+}
+
+//--------------------------------------------------------------
+//true if any object lies between tMin and tMax along the ray
+//
+bool RayTracer::occluded(const Ray& ray, float tMin, float tMax) {
+	ProfileScope traversal(PROFILE_TRAVERSAL);
+	renderProfiler().count(PROFILE_SHADOW_RAYS);
+	if (useBvh) return bvh.occluded(ray, tMin, tMax);
+
+	Ray r = Ray(ray.p, glm::normalize(ray.d));
+	countLinearTests();
+	for (int k = 0; k < scene.size(); k++) {
+		if (scene[k]->occludes(r, tMin, tMax)) return true;
+	}
+	return false;
+}
+
+//--------------------------------------------------------------
+//traces the primary ray through pixel (i, j)
+//only touches the per-ray hit record and the pixel's own cache entry, so
+//it is safe to call from several threads at once
+//returns linear radiance
+//
+glm::vec3 RayTracer::tracePixel(int i, int j, int width, int height) {
+	HitRecord hit;
+	int pixel = j * width + i;
+	RenderProfiler& profiler = renderProfiler();
+	if (!profiler.isEnabled()) return traceSample(i + .5f, j + .5f, width, height, hit, recording ? pixel : -1);
+
+	long long start = RenderProfiler::now();
+	glm::vec3 color = traceSample(i + .5f, j + .5f, width, height, hit, recording ? pixel : -1);
+	profiler.addPixelCost(pixel, RenderProfiler::now() - start);
+	return color;
+}
+
+//--------------------------------------------------------------
+//traces a primary ray through image position (x, y), in pixels from the
+//top left corner, and fills in its closest hit
+//pixel >= 0 records the hit in that pixel of the frame cache
+//returns linear radiance
+//
+glm::vec3 RayTracer::traceSample(float x, float y, int width, int height, HitRecord& hit, int pixel) {
+	float u = x / (double)width;
+	float v = 1 - y / (double)height;
+
+	renderProfiler().count(PROFILE_PRIMARY_RAYS);
+	Ray r;
+	{
+		ProfileScope camera(PROFILE_CAMERA);
+		r = renderCam.getRay(u, v);
+	}
+	intersect(r, hit);
+	return shadeHit(r, hit, pixel);
+}
+
+//--------------------------------------------------------------
+//traces the primary ray through the centre of pixel (i, j) and appends
+//it and its closest hit to hits, for shading later
+//
+void RayTracer::tracePrimary(int i, int j, int width, int height, vector<PrimaryHit>& hits) {
+	bool profiling = renderProfiler().isEnabled();
+	long long start = profiling ? RenderProfiler::now() : 0;
+	renderProfiler().count(PROFILE_PRIMARY_RAYS);
+
+	hits.emplace_back();
+	PrimaryHit& primary = hits.back();
+	primary.i = i;
+	primary.j = j;
+	{
+		ProfileScope camera(PROFILE_CAMERA);
+		primary.ray = renderCam.getRay((i + .5f) / (double)width, 1 - (j + .5f) / (double)height);
+	}
+	intersect(primary.ray, primary.hit);
+	primary.cost = profiling ? RenderProfiler::now() - start : 0;
+}
+
+//--------------------------------------------------------------
+//traces count neighbouring pixels of row j, starting at column i, as
+//one SIMD ray packet and appends the rays and their closest hits to
+//hits, for shading later
+//
+void RayTracer::tracePacket(int i, int j, int count, int width, int height, vector<PrimaryHit>& hits) {
+	RenderProfiler& profiler = renderProfiler();
+	bool profiling = profiler.isEnabled();
+	long long start = profiling ? RenderProfiler::now() : 0;
+	profiler.count(PROFILE_PRIMARY_RAYS, count);
+
+	Ray rays[RayPacket::maxSize];
+	HitRecord packetHits[RayPacket::maxSize];
+	{
+		ProfileScope camera(PROFILE_CAMERA);
+		renderCam.getRays(i, j, i + count, j + 1, width, height, rays);
+	}
+	{
+		ProfileScope traversal(PROFILE_TRAVERSAL);
+		bvh.intersectPacket(rays, count, packetHits);
+	}
+
+	//the packet's cost is split evenly over its pixels
+	long long shared = profiling ? (RenderProfiler::now() - start) / count : 0;
+	for (int k = 0; k < count; k++) {
+		hits.push_back(PrimaryHit{ rays[k], packetHits[k], i + k, j, shared });
+	}
+}
+
+//--------------------------------------------------------------
+//supersamples the edges of a finished one ray per pixel frame
+//
+bool RayTracer::antialiasPass(RadianceBuffer& buffer, const std::atomic<bool>* cancel) {
+	if (aaSamples <= 1) return true;
+	if (!antialias(buffer, cancel, false)) return false;
+	cacheFrame(buffer);
+	return true;
+}
+
+//--------------------------------------------------------------
+//first marks every pixel that differs from a neighbour, then, once the
+//whole mask is known, replaces each marked pixel with the mean of its
+//samples; the centre ray kept in the G-buffer counts as the first
+//dirtyOnly limits both steps to the dirty pixels and their neighbours,
+//the others keep what the buffer already holds
+//
+bool RayTracer::antialias(RadianceBuffer& buffer, const std::atomic<bool>* cancel, bool dirtyOnly) {
+	int width = buffer.getWidth();
+	int height = buffer.getHeight();
+	if (!frameCache.matches(width, height, frameCache.getNumLights())) return true;
+
+	//0 = leave alone, 1 = centre sample only, 2 = supersample
+	edgeMask.assign(width * height, 0);
+	renderer.render(width, height, [&](const Tile& tile) {
+		if (cancel && *cancel) return;
+
+		for (int j = tile.y0; j < tile.y1; j++) {
+			for (int i = tile.x0; i < tile.x1; i++) {
+				if (dirtyOnly) {
+					bool near = false;
+					for (int y = std::max(j - 1, 0); y <= std::min(j + 1, height - 1) && !near; y++) {
+						for (int x = std::max(i - 1, 0); x <= std::min(i + 1, width - 1); x++) {
+							if (frameCache.dirtyAt(y * width + x)) near = true;
+						}
+					}
+					if (!near) continue;
+				}
+
+				const GBufferTexel& texel = frameCache.at(j * width + i);
+				unsigned char mark = 1;
+				int neighbours[4][2] = { { i - 1, j }, { i + 1, j }, { i, j - 1 }, { i, j + 1 } };
+				for (int k = 0; k < 4; k++) {
+					int x = neighbours[k][0];
+					int y = neighbours[k][1];
+					if (x < 0 || y < 0 || x >= width || y >= height) continue;
+
+					const GBufferTexel& other = frameCache.at(y * width + x);
+					bool edge = other.objectIndex != texel.objectIndex ||
+						(texel.objectIndex >= 0 && std::abs(other.t - texel.t) > aaDepthRatio * std::min(other.t, texel.t)) ||
+						contrast(other.radiance, texel.radiance) > aaContrast;
+					if (edge) {
+						mark = 2;
+						break;
+					}
+				}
+				edgeMask[j * width + i] = mark;
+			}
+		}
+	});
+	if (cancel && *cancel) return false;
+
+	std::atomic<int> edgePixels(0);
+	std::atomic<long long> rays(0);
+	RenderProfiler& profiler = renderProfiler();
+	renderer.render(width, height, [&](const Tile& tile) {
+		if (cancel && *cancel) return;
+
+		int tileEdges = 0;
+		long long tileRays = 0;
+		for (int j = tile.y0; j < tile.y1; j++) {
+			for (int i = tile.x0; i < tile.x1; i++) {
+				const GBufferTexel& texel = frameCache.at(j * width + i);
+				unsigned char mark = edgeMask[j * width + i];
+				if (mark == 1) buffer.at(i, j) = texel.radiance;
+				if (mark != 2) continue;
+				tileEdges++;
+
+				long long start = profiler.isEnabled() ? RenderProfiler::now() : 0;
+				glm::vec3 first = texel.radiance;
+				glm::vec3 sum = first;
+				bool agree = true;
+				int n = 1;
+				for (; n < aaSamples; n++) {
+					if (n >= aaMinSamples && agree) break;
+
+					HitRecord hit;
+					glm::vec3 color = traceSample(i + halton(n, 2), j + halton(n, 3), width, height, hit);
+					agree = agree && hit.objectIndex == texel.objectIndex && contrast(color, first) <= aaContrast;
+					sum += color;
+				}
+				tileRays += n - 1;
+				buffer.at(i, j) = sum / (float)n;
+				if (profiler.isEnabled()) profiler.addPixelCost(j * width + i, RenderProfiler::now() - start);
+			}
+		}
+		edgePixels += tileEdges;
+		rays += tileRays;
+	});
+
+	aaStats.edgePixels = edgePixels;
+	aaStats.rays += rays;
+	return !(cancel && *cancel);
+}
+
+//--------------------------------------------------------------
+//shades the closest hit of primary ray r
+//pixel >= 0 also stores the hit, its material and each light's share of
+//the result in that pixel of the frame cache
+//returns linear radiance, black for background
+//
+glm::vec3 RayTracer::shadeHit(const Ray& r, const HitRecord& hit, int pixel, const vector<int>* lights) {
+	ProfileScope shading(PROFILE_SHADING);
+	if (hit.objectIndex < 0) {													//background
+		if (pixel >= 0) {
+			frameCache.at(pixel) = GBufferTexel{ hit.point, hit.normal, MaterialRecord{ glm::vec3(0), glm::vec3(0) }, glm::vec3(0), hit.t, -1 };
+			for (int l = 0; l < frameCache.getNumPlanes(); l++) frameCache.contribution(l, pixel) = glm::vec3(0);
+		}
+		return glm::vec3(0);
+	}
+
+	//get diffuse and specular, filtered over the pixel's footprint
+	float footprint = hit.t * pixelSpread / glm::max(glm::abs(glm::dot(hit.normal, r.d)), .05f);
+	MaterialRecord material = materialAt(scene[hit.objectIndex], hit, footprint);
+
+	//add shading contribution
+	//lights culled for the tile add nothing, but still clear their planes
+	glm::vec3 shaded = glm::vec3(0);
+	if (lights && (pixel < 0 || frameCache.getNumPlanes() == 0)) {
+		shaded = shadeLights(hit.point, hit.normal, material, renderCam.position, *lights);
+	}
+	else if (pixel < 0 || isSamplingLights()) {
+		shaded = shade(hit.point, hit.normal, material, renderCam.position);
+	}
+	else {
+		int next = 0;
+		for (int l = 0; l < lightRecords.size(); l++) {
+			glm::vec3 contribution = glm::vec3(0);
+			if (!lights || (next < lights->size() && (*lights)[next] == l)) {
+				contribution = shadeLight(hit.point, hit.normal, material, lightRecords[l], renderCam.position);
+				next++;
+			}
+			if (l < frameCache.getNumPlanes()) frameCache.contribution(l, pixel) = contribution;
+			shaded += contribution;
+		}
+	}
+
+	//mirror and glass: the light planes keep the surface's own shading,
+	//the pixel adds what the secondary rays bring back; such pixels are
+	//retraced after any edit rather than reshaded
+	if (material.hasSecondaryRays()) {
+		float local;
+		glm::vec3 secondary = traceSecondary(r, hit, material, local);
+		shaded = shaded * local + secondary;
+	}
+
+	if (pixel >= 0) frameCache.at(pixel) = GBufferTexel{ hit.point, hit.normal, material, shaded, hit.t, hit.objectIndex };
+	return shaded;
+}
+
+//--------------------------------------------------------------
+//material of an object at a hit, with its mirror and glass settings
+//spheres are untextured, so skip the virtual lookup for them; instance
+//sets keep mirror and glass settings per instance
+//
+MaterialRecord RayTracer::materialAt(SceneObject* object, const HitRecord& hit, float footprint) {
+	if (object->type == OBJECT_INSTANCES) return object->getMaterial(hit, footprint);
+
+	MaterialRecord material;
+	if (object->type == OBJECT_SPHERE) {
+		material = MaterialRecord{ toRadiance(object->diffuseColor), toRadiance(object->specularColor) };
+	}
+	else {
+		ProfileScope texturing(PROFILE_TEXTURING);
+		material = object->getMaterial(hit, footprint);
+	}
+	material.reflectivity = object->reflectivity;
+	material.transparency = object->transparency;
+	material.ior = object->ior;
+	return material;
+}
+
+//--------------------------------------------------------------
+//radiance the reflected and refracted rays leaving the primary hit of r
+//bring back, and in local the share left to the surface's own shading
+//
+//secondary rays wait in a fixed size queue on the stack instead of in
+//C++ recursion; the ray carrying the largest share of the pixel is traced
+//first, until the queue is empty or rayBudget rays were traced.  A ray is
+//dropped when it carries less than minThroughput, when it would bounce
+//past maxDepth, or by Russian roulette: from rouletteDepth on, a ray
+//carrying less than rouletteThroughput survives with probability
+//carried / rouletteThroughput and then carries rouletteThroughput, so
+//the image stays unbiased while no survivor stands out as a speckle.
+//The roulette is seeded by the ray origin, so images do not depend on
+//threads or passes.
+//
+glm::vec3 RayTracer::traceSecondary(const Ray& r, const HitRecord& hit, const MaterialRecord& material, float& local) {
+	SecondaryRay queue[maxQueuedRays];
+	int queued = 0;
+
+	auto push = [&](const glm::vec3& origin, const glm::vec3& dir, glm::vec3 throughput, float distance, int depth) {
+		float carried = maxComponent(throughput);
+		if (carried < minThroughput) return;
+		if (depth >= rouletteDepth && carried < rouletteThroughput) {
+			float survival = carried / rouletteThroughput;
+			if (unitFloat(hashBits(hashPoint(origin) + depth)) >= survival) return;
+			throughput /= survival;
+			carried = rouletteThroughput;
+		}
+
+		//full: the new ray replaces the weakest queued one if it carries more
+		int slot = queued;
+		if (queued == maxQueuedRays) {
+			slot = 0;
+			for (int k = 1; k < queued; k++) {
+				if (maxComponent(queue[k].throughput) < maxComponent(queue[slot].throughput)) slot = k;
+			}
+			if (maxComponent(queue[slot].throughput) >= carried) return;
+		}
+		else queued++;
+		queue[slot] = SecondaryRay{ Ray(origin, dir), throughput, distance, depth };
+	};
+
+	//queues the rays leaving a hit, returns the surface's own share
+	auto spawn = [&](const Ray& in, const HitRecord& h, const MaterialRecord& m, const glm::vec3& throughput, float distance, int depth) {
+		SurfaceSplit split = splitSurface(in.d, h.normal, m, scene[h.objectIndex]->type == OBJECT_SPHERE);
+		if (depth <= maxDepth) {
+			if (split.reflect != glm::vec3(0)) push(h.point + split.facing * shadowBias, split.reflectDir, throughput * split.reflect, distance, depth);
+			if (split.refract != glm::vec3(0)) push(h.point - split.facing * shadowBias, split.refractDir, throughput * split.refract, distance, depth);
+		}
+		return split.local;
+	};
+
+	local = spawn(r, hit, material, glm::vec3(1), hit.t, 1);
+
+	glm::vec3 radiance = glm::vec3(0);
+	int traced = 0;
+	while (queued > 0 && traced < rayBudget) {
+		int next = 0;
+		for (int k = 1; k < queued; k++) {
+			if (maxComponent(queue[k].throughput) > maxComponent(queue[next].throughput)) next = k;
+		}
+		SecondaryRay ray = queue[next];
+		queue[next] = queue[--queued];
+		traced++;
+
+		HitRecord h;
+		if (!intersect(ray.ray, h)) continue;				//background is black
+
+		float distance = ray.distance + h.t;
+		float footprint = distance * pixelSpread / glm::max(glm::abs(glm::dot(h.normal, ray.ray.d)), .05f);
+		MaterialRecord m = materialAt(scene[h.objectIndex], h, footprint);
+		float share = m.hasSecondaryRays() ? spawn(ray.ray, h, m, ray.throughput, distance, ray.depth + 1) : 1;
+		if (share > 0) radiance += ray.throughput * share * shade(h.point, h.normal, m, ray.ray.p);
+	}
+	renderProfiler().count(PROFILE_SECONDARY_RAYS, traced);
+	return radiance;
+}
+
+//--------------------------------------------------------------
+//adds shading contribution of every light
+//returns shaded radiance
+//
+glm::vec3 RayTracer::shade(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const glm::vec3& eye) {
+	if (isSamplingLights()) return shadeSampled(p, norm, material, eye);
+	glm::vec3 shaded = glm::vec3(0);
+
+	//loop through all lights
+	for (int i = 0; i < lightRecords.size(); i++) {
+		shaded += shadeLight(p, norm, material, lightRecords[i], eye);
+	}
+	return shaded;
+}
+
+//--------------------------------------------------------------
+//adds shading contribution of the listed lights, in list order
+//returns shaded radiance
+//
+glm::vec3 RayTracer::shadeLights(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const glm::vec3& eye, const vector<int>& lights) {
+	glm::vec3 shaded = glm::vec3(0);
+	for (int l : lights) {
+		shaded += shadeLight(p, norm, material, lightRecords[l], eye);
+	}
+	return shaded;
+}
+
+//--------------------------------------------------------------
+//lights that can reach any primary hit of a tile, in light order, or
+//nullptr to shade with every light: culling is off, lights are sampled
+//from the light tree instead, or there is at most one light
+//
+const vector<int>* RayTracer::cullTile(const vector<PrimaryHit>& hits) {
+	if (!cullLights || isSamplingLights() || lightRecords.size() <= 1) return nullptr;
+
+	AABB box;
+	bool anyHit = false;
+	for (const PrimaryHit& primary : hits) {
+		if (primary.hit.objectIndex < 0) continue;
+		box.grow(primary.hit.point);
+		anyHit = true;
+	}
+	vector<int>& lights = tileLights;
+	lights.clear();
+	if (!anyHit) return &lights;			//nothing hit, nothing to light
+
+	for (int l = 0; l < lightRecords.size(); l++) {
+		if (lightMayReach(lightRecords[l], box)) lights.push_back(l);
+	}
+	return &lights;
+}
+
+//--------------------------------------------------------------
+//estimates the sum over all lights from lightSamples lights picked by
+//importance, each weighted by one over its probability; the picks are
+//stratified over [0, 1) and seeded by the point and the pass, so they do
+//not depend on threads and change from pass to pass
+//returns shaded radiance
+//
+glm::vec3 RayTracer::shadeSampled(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const glm::vec3& eye) {
+	glm::vec3 shaded = glm::vec3(0);
+	unsigned int seed = hashBits(hashPoint(p) + 0x9e3779b9u * lightSeed);
+	for (int k = 0; k < lightSamples; k++) {
+		float u = (k + unitFloat(hashBits(seed + k))) / lightSamples;
+		float pdf;
+		int picked = lightTree.sample(p, norm, u, pdf);
+		if (picked < 0) continue;
+		shaded += shadeLight(p, norm, material, lightRecords[picked], eye) / pdf;
+	}
+	return shaded / (float)lightSamples;
+}
+
+//--------------------------------------------------------------
+//shading contribution of one light
+//calculates shadows
+//returns shaded radiance
+//
+glm::vec3 RayTracer::shadeLight(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const LightRecord& light, const glm::vec3& eye) {
+	//area lights cast one shadow ray per sample on their rectangle
+	if (light.type == LIGHT_AREA) {
+		return areaLightPhong(p, norm, material, light, eye);
+	}
+
+	//spot lights reach nothing outside their cone, so need no shadow ray
+	//there
+	if (light.type == LIGHT_SPOT && !light.inCone(p)) {
+		return glm::vec3(0);
+	}
+
+	//test for shadows on every surface, only up to the light
+	//the ray starts just off the surface on the light's side so it
+	//cannot hit the surface it leaves
+	glm::vec3 toLight = light.position - p;
+	glm::vec3 origin = p + (glm::dot(norm, toLight) < 0 ? -norm : norm) * shadowBias;
+	Ray shadowRay = Ray(origin, light.position - origin);
+	if (occluded(shadowRay, 0, glm::distance(origin, light.position))) {
+		return glm::vec3(0);
+	}
+
+	//add shading contribution for current light
+	//
+	if (light.type == LIGHT_SPOT) {
+		return spotLightPhong(p, norm, material, light, eye);
+	}
+	return phong(p, norm, material, light, eye);
+}
+
+//--------------------------------------------------------------
+//calculates all shading for point lights including:
+// lambert
+// phong
+// ambient
+//returns shaded radiance
+//
+glm::vec3 RayTracer::phong(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const LightRecord& light, const glm::vec3& eye) {
+	glm::vec3 phong = glm::vec3(0);
+	glm::vec3 h = glm::vec3(0);
+
+	glm::vec3 l = glm::normalize(light.position - p);
+	glm::vec3 v = glm::normalize(eye - p);
+	h = glm::normalize(l + v);
+
+	float distance1 = glm::distance(light.position, p);
+
+
+	phong += (ambient(material.diffuse)) + (lambert(p, norm, material, light)) + (material.specular * (light.intensity / distance1 * distance1) * glm::pow(glm::max(zero, glm::dot(norm, h)), light.power));
+
+	return phong;
+}
+
+//--------------------------------------------------------------
+//calculates lambert shading for point lights
+//returns shaded radiance
+//
+glm::vec3 RayTracer::lambert(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const LightRecord& light) {
+	glm::vec3 lambert = glm::vec3(0);
+	float distance1 = glm::distance(light.position, p);
+
+	glm::vec3 l = glm::normalize(light.position - p);
+	lambert += material.diffuse * (light.intensity / distance1 * distance1) * (glm::max(zero, glm::dot(norm, l)));
+
+	return lambert;
+}
+
+//--------------------------------------------------------------
+//calculates all shading for spot lights including:
+// lambert
+// phong
+//both only inside the cone
+//returns shaded radiance
+//
+glm::vec3 RayTracer::spotLightPhong(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const LightRecord& light, const glm::vec3& eye) {
+	glm::vec3 phong = glm::vec3(0);
+	glm::vec3 h = glm::vec3(0);
+	if (!light.inCone(p)) return phong;
+
+	glm::vec3 l = glm::normalize(light.position - p);
+	glm::vec3 v = glm::normalize(eye - p);
+	h = glm::normalize(l + v);
+
+	float distance1 = glm::distance(light.position, p);
+
+
+	phong += (spotLightLambert(p, norm, material, light)) + (material.specular * (light.intensity / distance1 * distance1) * glm::pow(glm::max(zero, glm::dot(norm, h)), light.power));
+
+	return phong;
+}
+
+//--------------------------------------------------------------
+//calculates lambert shading for spot lights
+//returns shaded radiance
+//
+glm::vec3 RayTracer::spotLightLambert(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const LightRecord& light) {
+	glm::vec3 lambert = glm::vec3(0);
+
+	float distance1 = glm::distance(light.position, p);
+
+	if (light.inCone(p)) {		//illuminate if p is inside spot light illumination area
+		glm::vec3 l = glm::normalize(light.position - p);
+		lambert += material.diffuse * (light.intensity / distance1 * distance1) * (glm::max(zero, glm::dot(norm, l)));
+	}
+
+	return lambert;
+}
+
+//--------------------------------------------------------------
+//calculates phong shading for area lights
+//the Width x Width rectangle is split into areaLightGrid x areaLightGrid
+//cells with one jittered sample and shadow ray in each.  The four corner
+//cells go first: when they all agree (fully lit or fully shadowed) the
+//point is taken to be outside the penumbra and the rest are skipped
+//a light aimed at itself has no front face or rectangle and lights nothing
+//returns shaded radiance
+//
+glm::vec3 RayTracer::areaLightPhong(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const LightRecord& light, const glm::vec3& eye) {
+	if (!(glm::dot(light.axis, light.axis) > .5f)) return glm::vec3(0);		// aimed at itself
+	int grid = glm::max(areaLightGrid, 1);
+	int cells = grid * grid;
+	unsigned int seed = hashPoint(p);
+	glm::vec3 v = glm::normalize(eye - p);
+	glm::vec3 corner = light.position - (light.edgeU + light.edgeV) * .5f;
+	glm::vec3 facing = light.axis;
+
+	glm::vec3 phong = glm::vec3(0);
+	int lit = 0;
+	int traced = 0;
+	auto sample = [&](int cell) {
+		float su = (cell % grid + unitFloat(hashBits(seed + 2 * cell))) / grid;
+		float sv = (cell / grid + unitFloat(hashBits(seed + 2 * cell + 1))) / grid;
+		glm::vec3 s = corner + light.edgeU * su + light.edgeV * sv;
+		traced++;
+
+		//no shadow ray for samples facing away from p or p facing away from them
+		glm::vec3 l = glm::normalize(s - p);
+		float emitted = -glm::dot(facing, l);
+		if (emitted <= 0 || glm::dot(norm, l) <= 0) return;
+
+		glm::vec3 origin = p + norm * shadowBias;
+		if (occluded(Ray(origin, s - origin), 0, glm::distance(origin, s))) return;
+
+		glm::vec3 h = glm::normalize(l + v);
+		phong += areaLightLambert(p, norm, material, light, s) + (material.specular * light.intensity * emitted * glm::pow(glm::max(zero, glm::dot(norm, h)), light.power));
+		lit++;
+	};
+
+	int corners[4] = { 0, grid - 1, cells - grid, cells - 1 };
+	int probes = grid > 1 ? 4 : 1;
+	for (int k = 0; k < probes; k++) sample(corners[k]);
+
+	if (!adaptiveAreaLight || (lit != 0 && lit != probes)) {
+		for (int cell = 0; cell < cells; cell++) {
+			if (grid > 1 && (cell == corners[0] || cell == corners[1] || cell == corners[2] || cell == corners[3])) continue;
+			sample(cell);
+		}
+	}
+	return phong / (float)traced;
+}
+
+//--------------------------------------------------------------
+//calculates lambert shading from one sample point s on an area light
+//the rectangle emits from its front face only, towards the aim point,
+//falling off with the cosine to its normal
+//returns shaded radiance
+//
+glm::vec3 RayTracer::areaLightLambert(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const LightRecord& light, const glm::vec3& s) {
+	glm::vec3 lambert = glm::vec3(0);
+	if (!(glm::dot(light.axis, light.axis) > .5f)) return lambert;		// aimed at itself
+
+	glm::vec3 l = glm::normalize(s - p);
+	glm::vec3 facing = light.axis;
+	float emitted = glm::max(zero, -glm::dot(facing, l));
+	float received = glm::max(zero, glm::dot(norm, l));
+
+	lambert += material.diffuse * light.intensity * emitted * received;
+
+	return lambert;
+}
+
+
+// --------------------------------------------------------------
+//calculates ambient shading
+//returns shaded radiance
+glm::vec3 RayTracer::ambient(const glm::vec3& diffuse) {
+	glm::vec3 ambient = glm::vec3(0);
+
+	ambient = .05f * diffuse;
+	//ambient = .00f * diffuse;
+
+	return ambient;
+}
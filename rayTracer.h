@@ -0,0 +1,214 @@
+#pragma once
+
+#include "scene.h"
+#include "bvh.h"
+#include "tileRenderer.h"
+#include "radianceBuffer.h"
+#include "frameCache.h"
+#include "lightTree.h"
+
+#include <atomic>
+
+//  Whitted-style tracer over a set of scene objects and lights, seen
+//  through a RenderCam.  Does not own the scene and needs no window or
+//  GL context, so it is shared by the interactive app and the headless
+//  command line target.
+//
+class RayTracer {
+public:
+	RayTracer(vector<SceneObject*>& scene, vector<Light*>& light, RenderCam& renderCam);
+
+	void render(RadianceBuffer& buffer);
+	void render(ofPixels& pixels);
+
+	//  A frame can also be rendered in pieces: prepareFrame() on the thread
+	//  that owns the scene, then renderPass() from any one thread while the
+	//  scene is left alone.  Passes with blockSize 8, 4, 2, 1, each given the
+	//  previous size as coarserSize, trace every pixel exactly once and give
+	//  the same image as render().
+	//
+	void prepareFrame();
+	bool renderPass(RadianceBuffer& buffer, int blockSize, int coarserSize, const std::atomic<bool>* cancel = nullptr);
+
+	//  Anti-aliasing, run after the one ray per pixel pass: pixels on an
+	//  edge (another object, a depth jump or a colour step next to one of
+	//  their four neighbours) get up to aaSamples rays at Halton (2, 3)
+	//  points inside the pixel, stopping after aaMinSamples if those agree.
+	//  Returns false if cancelled.
+	//
+	bool antialiasPass(RadianceBuffer& buffer, const std::atomic<bool>* cancel = nullptr);
+
+	//  Many lights: with lightSamples > 0 each shading point picks that
+	//  many lights from the light tree instead of shading every light, so
+	//  its cost no longer grows with the light count.  The picks differ
+	//  from pass to pass; lightPass() traces every pixel again with pass
+	//  number pass (1, 2, ...) and folds it into the running mean in
+	//  buffer, so the noise falls as passes are added.  render() runs
+	//  lightPasses passes in all.  Returns false if cancelled.
+	//
+	bool lightPass(RadianceBuffer& buffer, int pass, const std::atomic<bool>* cancel = nullptr);
+	bool isSamplingLights() const { return lightSamples > 0 && lightRecords.size() > 1; }
+
+	struct AntiAliasStats {
+		int pixels = 0;
+		int edgePixels = 0;			// pixels that were supersampled
+		long long rays = 0;			// primary rays, first pass included
+	};
+	const AntiAliasStats& getAntiAliasStats() const { return aaStats; }
+
+	//  Incremental re-render.  Every full-resolution frame leaves what each
+	//  pixel saw, and each light's share of it, in the frame cache.  After
+	//  an edit, renderIncremental() retraces only the pixels that can see
+	//  a changed object (its old and new screen bounds), reshades one
+	//  light where the object may cross the shadow ray to it, and keeps
+	//  the rest of the frame in buffer.  Changes are found by comparing the
+	//  scene with the cached state, so edits need no extra calls; render
+	//  settings are not compared, so invalidate the cache after changing
+	//  any of them.
+	//
+	bool canRenderIncremental(const RadianceBuffer& buffer);
+	bool renderIncremental(RadianceBuffer& buffer, const std::atomic<bool>* cancel = nullptr);
+
+	struct IncrementalStats {
+		int retraced = 0;
+		int reshaded = 0;
+	};
+	const IncrementalStats& getIncrementalStats() const { return incrementalStats; }
+
+	//  Light culling: a render pass traces all of a tile's primary rays
+	//  before shading any of them, bins into the tile only the lights that
+	//  can reach the box around its hits (see lightMayReach()) and shades
+	//  the tile with just those.  Culled lights would add exactly zero, so
+	//  the image is the same as without culling.  Secondary rays leave the
+	//  box and still see every light.
+	//
+	struct LightCullStats {
+		int tiles = 0;				// tiles of the last pass
+		long long lights = 0;		// lights kept, summed over those tiles
+	};
+	const LightCullStats& getLightCullStats() const { return cullStats; }
+
+	//  a traced primary ray waiting to be shaded
+	//
+	struct PrimaryHit {
+		Ray ray;
+		HitRecord hit;
+		int i, j;
+		long long cost;				// nanoseconds spent on it so far, when profiling
+	};
+
+	glm::vec3 tracePixel(int i, int j, int width, int height);
+	glm::vec3 traceSample(float x, float y, int width, int height, HitRecord& hit, int pixel = -1);
+	void tracePrimary(int i, int j, int width, int height, vector<PrimaryHit>& hits);
+	void tracePacket(int i, int j, int count, int width, int height, vector<PrimaryHit>& hits);
+	glm::vec3 shadeHit(const Ray& r, const HitRecord& hit, int pixel = -1, const vector<int>* lights = nullptr);
+
+	bool intersect(const Ray& ray, HitRecord& hit);
+	bool occluded(const Ray& ray, float tMin, float tMax);
+
+	//  Scene edits invalidate the BVH; it is rebuilt or refit lazily at the
+	//  start of the next render.  Adding or removing objects needs a rebuild,
+	//  moving or resizing them only a refit.
+	//
+	void markSceneChanged() { rebuildBvh = true; }
+	void markObjectsMoved() { refitBvh = true; }
+	void updateBvh();
+	void packLights();
+
+	//  shading functions read the light records packed at the start of the
+	//  frame, never the Light objects themselves; eye is where the point is
+	//  seen from, the camera for primary hits and the last bounce after
+	//  a reflection or refraction
+	//
+	glm::vec3 ambient(const glm::vec3& diffuse);
+	glm::vec3 lambert(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const LightRecord& light);
+	glm::vec3 phong(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const LightRecord& light, const glm::vec3& eye);
+	glm::vec3 shade(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const glm::vec3& eye);
+	glm::vec3 shadeLight(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const LightRecord& light, const glm::vec3& eye);
+	glm::vec3 spotLightPhong(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const LightRecord& light, const glm::vec3& eye);
+	glm::vec3 spotLightLambert(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const LightRecord& light);
+	glm::vec3 areaLightPhong(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const LightRecord& light, const glm::vec3& eye);
+	glm::vec3 areaLightLambert(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const LightRecord& light, const glm::vec3& s);
+
+	const float zero = 0.0;
+
+	// shading is done in linear float radiance; render(ofPixels&) keeps the
+	// last frame here and tone maps it once at the end
+	//
+	RadianceBuffer radiance;
+	float exposure = 1;
+	ToneMap toneMap = TONEMAP_CLAMP;
+
+	// tiled multithreaded render engine
+	//
+	TileRenderer renderer;
+	int numThreads = 0;		// 0 = one per hardware thread
+	int tileSize = 32;
+
+	// acceleration structure over the scene objects
+	//
+	BVH bvh;
+	bool useBvh = true;				// false = test every object, for comparison
+	bool usePackets = true;			// trace primary rays in SIMD packets of neighbouring pixels
+	float refitTolerance = 1.5;		// rebuild once a refit costs this much more than a fresh build
+	float shadowBias = 1e-3;
+	int areaLightGrid = 4;			// area light samples per side, at most grid x grid shadow rays
+	bool adaptiveAreaLight = true;	// stop after the four corner samples when they agree
+
+	// reflection and refraction, see traceSecondary()
+	//
+	int maxDepth = 6;				// bounces a secondary ray may follow
+	int rayBudget = 32;				// secondary rays per primary hit at most
+	int rouletteDepth = 3;			// bounces before Russian roulette may end a ray
+	float rouletteThroughput = .1;	// share of a pixel below which roulette plays
+	float minThroughput = .01;		// share of a pixel below which a ray is dropped
+
+	bool cullLights = true;			// shade each tile with only the lights that can reach it
+
+	// many lights, see lightPass()
+	//
+	int lightSamples = 0;			// lights picked per shading point, 0 = shade every light
+	int lightPasses = 4;			// passes averaged per frame while picking lights
+	LightTree lightTree;
+
+	// anti-aliasing, see antialiasPass()
+	//
+	int aaSamples = 1;				// rays per edge pixel at most, 1 = off
+	int aaMinSamples = 4;			// rays before an edge pixel may stop early
+	float aaContrast = .1;			// colour step that counts as an edge, in clamped radiance
+	float aaDepthRatio = .1;		// relative depth step that counts as an edge
+
+	bool incremental = true;		// keep the frame cache for renderIncremental()
+	FrameCache frameCache;
+	float pixelSpread = 0;			// radians per full resolution pixel, 0 = sharpest textures
+
+private:
+	bool rebuildBvh = true;
+	bool refitBvh = false;
+	float builtCost = 0;
+
+	bool antialias(RadianceBuffer& buffer, const std::atomic<bool>* cancel, bool dirtyOnly);
+	void markDirty(int width, int height, const std::atomic<bool>* cancel);
+	bool shadowMayCross(const glm::vec3& p, const glm::vec3& light, float spread, const AABB& box);
+	void screenBounds(const AABB& box, int width, int height, int& x0, int& y0, int& x1, int& y1);
+	void cacheFrame(const RadianceBuffer& buffer);
+	void countLinearTests();
+	MaterialRecord materialAt(SceneObject* object, const HitRecord& hit, float footprint);
+	glm::vec3 traceSecondary(const Ray& r, const HitRecord& hit, const MaterialRecord& material, float& local);
+	glm::vec3 shadeLights(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const glm::vec3& eye, const vector<int>& lights);
+	const vector<int>* cullTile(const vector<PrimaryHit>& hits);
+	glm::vec3 shadeSampled(const glm::vec3& p, const glm::vec3& norm, const MaterialRecord& material, const glm::vec3& eye);
+
+	bool recording = false;					// passes write the frame cache
+	int lightSeed = 0;						// pass number, varies the lights picked
+	const RadianceBuffer* cachedBuffer = nullptr;	// holds the cached frame
+	vector<unsigned char> edgeMask;
+	AntiAliasStats aaStats;
+	LightCullStats cullStats;
+	IncrementalStats incrementalStats;
+
+	vector<SceneObject*>& scene;
+	vector<Light*>& light;
+	vector<LightRecord> lightRecords;		// snapshot of light, refreshed every frame
+	RenderCam& renderCam;
+};
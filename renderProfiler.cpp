@@ -0,0 +1,154 @@
+#include "renderProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+thread_local ProfileThread* RenderProfiler::current = nullptr;
+
+//  keys in the JSON report and labels in the summary, in enum order
+//
+static const char* counterKeys[numProfileCounters] = { "primaryRays", "shadowRays", "secondaryRays", "boxTests", "sphereTests", "planeTests", "sdfSteps", "triangleTests", "textureFetches" };
+static const char* counterLabels[numProfileCounters] = { "primary rays", "shadow rays", "secondary rays", "BVH box tests", "sphere tests", "plane tests", "SDF steps", "triangle tests", "texture fetches" };
+static const char* stageKeys[numProfileStages] = { "camera", "traversal", "shading", "texturing", "encode" };
+
+//--------------------------------------------------------------
+RenderProfiler& renderProfiler() {
+	static RenderProfiler profiler;
+	return profiler;
+}
+
+//--------------------------------------------------------------
+const char* RenderProfiler::counterName(ProfileCounter counter) {
+	return counterKeys[counter];
+}
+
+//--------------------------------------------------------------
+const char* RenderProfiler::stageName(ProfileStage stage) {
+	return stageKeys[stage];
+}
+
+//--------------------------------------------------------------
+//first count on a thread: gives it a block of its own, kept for the
+//life of the profiler so totals still include threads that have exited
+//
+ProfileThread& RenderProfiler::addThread() {
+	std::lock_guard<std::mutex> guard(lock);
+	threads.emplace_back(new ProfileThread());
+	current = threads.back().get();
+	return *current;
+}
+
+//--------------------------------------------------------------
+void RenderProfiler::reset() {
+	std::lock_guard<std::mutex> guard(lock);
+	for (auto& thread : threads) {
+		int stage = thread->stage;
+		*thread = ProfileThread();
+		thread->stage = stage;
+	}
+	std::fill(pixelCost.begin(), pixelCost.end(), 0);
+	resetTime = now();
+}
+
+//--------------------------------------------------------------
+RenderProfiler::Totals RenderProfiler::totals() const {
+	std::lock_guard<std::mutex> guard(lock);
+	Totals sum;
+	for (auto& thread : threads) {
+		bool used = false;
+		for (int c = 0; c < numProfileCounters; c++) {
+			sum.counts[c] += thread->counts[c];
+			used |= thread->counts[c] != 0;
+		}
+		for (int s = 0; s < numProfileStages; s++) {
+			sum.nanos[s] += thread->nanos[s];
+			used |= thread->nanos[s] != 0;
+		}
+		if (used) sum.threads++;
+	}
+	sum.wallMs = (now() - resetTime) / 1e6;
+	return sum;
+}
+
+//--------------------------------------------------------------
+void RenderProfiler::beginImage(int width, int height) {
+	if (this->width == width && this->height == height) return;
+	this->width = width;
+	this->height = height;
+	pixelCost.assign(width * height, 0);
+}
+
+//--------------------------------------------------------------
+//counters, then stage times with their share of all staged time
+//
+void RenderProfiler::printSummary(ostream& out) const {
+	Totals t = totals();
+	long long staged = 0;
+	for (int s = 0; s < numProfileStages; s++) staged += t.nanos[s];
+
+	out << "profile: " << t.wallMs << " ms wall clock on " << t.threads << " threads" << endl;
+	for (int c = 0; c < numProfileCounters; c++) {
+		out << "  " << std::left << std::setw(18) << counterLabels[c] << std::right << std::setw(14) << t.counts[c] << endl;
+	}
+	if (t.wallMs > 0) {
+		out << "  " << std::left << std::setw(18) << "primary rays/s" << std::right << std::setw(14)
+			<< (long long)(t.counts[PROFILE_PRIMARY_RAYS] / (t.wallMs / 1000)) << endl;
+	}
+	for (int s = 0; s < numProfileStages; s++) {
+		out << "  " << std::left << std::setw(18) << stageKeys[s] << std::right << std::setw(11) << std::fixed << std::setprecision(2)
+			<< t.nanos[s] / 1e6 << " ms " << std::setw(5) << std::setprecision(1) << (staged ? 100.0 * t.nanos[s] / staged : 0) << "%" << endl;
+	}
+	out << std::defaultfloat << std::setprecision(6);
+}
+
+//--------------------------------------------------------------
+bool RenderProfiler::saveJson(const string& path) const {
+	ofstream out(path);
+	if (!out) {
+		cerr << path << ": cannot write" << endl;
+		return false;
+	}
+	Totals t = totals();
+	out << "{\n";
+	out << "  \"wallMs\": " << t.wallMs << ",\n";
+	out << "  \"threads\": " << t.threads << ",\n";
+	out << "  \"counters\": {";
+	for (int c = 0; c < numProfileCounters; c++) {
+		out << (c ? ", " : " ") << "\"" << counterKeys[c] << "\": " << t.counts[c];
+	}
+	out << " },\n";
+	out << "  \"stageMs\": {";
+	for (int s = 0; s < numProfileStages; s++) {
+		out << (s ? ", " : " ") << "\"" << stageKeys[s] << "\": " << t.nanos[s] / 1e6;
+	}
+	out << " },\n";
+	out << "  \"primaryRaysPerSecond\": " << (t.wallMs > 0 ? t.counts[PROFILE_PRIMARY_RAYS] / (t.wallMs / 1000) : 0) << "\n";
+	out << "}\n";
+	return (bool)out;
+}
+
+//--------------------------------------------------------------
+bool RenderProfiler::saveHeatmap(const string& path) const {
+	if (pixelCost.empty()) {
+		cerr << path << ": no pixel costs recorded" << endl;
+		return false;
+	}
+	vector<long long> sorted = pixelCost;
+	auto percentile = sorted.begin() + sorted.size() * 99 / 100;
+	std::nth_element(sorted.begin(), percentile, sorted.end());
+	float scale = *percentile > 0 ? 1.0f / *percentile : 0;
+
+	const glm::vec3 ramp[] = { glm::vec3(0, 0, 0), glm::vec3(0, 0, 1), glm::vec3(1, 0, 0), glm::vec3(1, 1, 0), glm::vec3(1, 1, 1) };
+	const int segments = sizeof(ramp) / sizeof(ramp[0]) - 1;
+
+	ofPixels pixels;
+	pixels.allocate(width, height, OF_PIXELS_RGB);
+	for (int i = 0; i < width * height; i++) {
+		float t = std::min(pixelCost[i] * scale, 1.0f) * segments;
+		int k = std::min((int)t, segments - 1);
+		glm::vec3 c = glm::mix(ramp[k], ramp[k + 1], t - k) * 255.0f;
+		pixels.setColor(i % width, i / width, ofColor(c.x, c.y, c.z));
+	}
+	return ofSaveImage(pixels, path);
+}
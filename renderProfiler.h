@@ -0,0 +1,150 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+enum ProfileCounter {
+	PROFILE_PRIMARY_RAYS,
+	PROFILE_SHADOW_RAYS,
+	PROFILE_SECONDARY_RAYS,     // reflected and refracted
+	PROFILE_BOX_TESTS,          // BVH node bounds
+	PROFILE_SPHERE_TESTS,
+	PROFILE_PLANE_TESTS,
+	PROFILE_SDF_STEPS,          // field evaluations while sphere tracing
+	PROFILE_TRIANGLE_TESTS,
+	PROFILE_TEXTURE_FETCHES,
+	numProfileCounters
+};
+
+enum ProfileStage {
+	PROFILE_CAMERA,             // primary ray generation
+	PROFILE_TRAVERSAL,          // closest hit and shadow queries
+	PROFILE_SHADING,
+	PROFILE_TEXTURING,
+	PROFILE_ENCODE,             // tone mapping and image encoding
+	numProfileStages
+};
+
+//  One thread's counters and stage times, on its own cache lines so
+//  threads never write to a line another thread is counting in.
+//
+struct alignas(64) ProfileThread {
+	long long counts[numProfileCounters] = {};
+	long long nanos[numProfileStages] = {};
+	int stage = -1;             // innermost open ProfileScope
+	long long stageStart = 0;
+};
+
+//  Where a render spends its time.  Off by default; while off every hook
+//  is one predictable branch.  While on, each thread counts into its own
+//  ProfileThread, reached through a thread_local pointer, and the blocks
+//  are only summed when a report is asked for, so profiling a render
+//  does not make its threads contend.
+//
+//  Stage times are exclusive: a shadow query inside shading is charged
+//  to traversal, not to both.  Times are summed over threads, so with n
+//  threads they add up to about n times the wall clock.
+//
+//  The per-pixel cost buffer holds the nanoseconds spent on each pixel's
+//  rays, coarse passes and anti-aliasing included, for the heatmap.
+//
+//  Turn it on, reset and read reports only between frames.
+//
+class RenderProfiler {
+public:
+	struct Totals {
+		long long counts[numProfileCounters] = {};
+		long long nanos[numProfileStages] = {};
+		double wallMs = 0;          // since reset()
+		int threads = 0;            // that counted anything
+	};
+
+	void setEnabled(bool on) { enabled.store(on, std::memory_order_relaxed); }
+	bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+	//  zeroes every thread's counters and the pixel costs and restarts
+	//  the wall clock
+	//
+	void reset();
+	Totals totals() const;
+
+	void count(ProfileCounter counter, long long n = 1) {
+		if (isEnabled()) local().counts[counter] += n;
+	}
+
+	//  sizes the pixel cost buffer, keeping it if the size is unchanged
+	//
+	void beginImage(int width, int height);
+	void addPixelCost(int pixel, long long nanos) { if (pixel >= 0 && pixel < pixelCost.size()) pixelCost[pixel] += nanos; }
+
+	void printSummary(ostream& out) const;
+	bool saveJson(const string& path) const;
+
+	//  pixel costs through a black, blue, red, yellow, white ramp, scaled
+	//  so the 99th percentile is white
+	//
+	bool saveHeatmap(const string& path) const;
+
+	ProfileThread& local() {
+		ProfileThread* thread = current;
+		return thread ? *thread : addThread();
+	}
+
+	static long long now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	static const char* counterName(ProfileCounter counter);
+	static const char* stageName(ProfileStage stage);
+
+private:
+	ProfileThread& addThread();
+
+	std::atomic<bool> enabled{ false };
+	long long resetTime = now();
+	mutable std::mutex lock;                    // guards threads
+	vector<std::unique_ptr<ProfileThread>> threads;
+	vector<long long> pixelCost;
+	int width = 0;
+	int height = 0;
+
+	static thread_local ProfileThread* current;
+};
+
+//  the profiler every tracer, BVH and writer in the process reports to
+//
+RenderProfiler& renderProfiler();
+
+//  Charges the time until it goes out of scope to one stage, pausing the
+//  stage of any enclosing scope meanwhile
+//
+class ProfileScope {
+public:
+	ProfileScope(ProfileStage stage) {
+		RenderProfiler& profiler = renderProfiler();
+		if (!profiler.isEnabled()) return;
+		thread = &profiler.local();
+		long long t = RenderProfiler::now();
+		if (thread->stage >= 0) thread->nanos[thread->stage] += t - thread->stageStart;
+		outer = thread->stage;
+		thread->stage = stage;
+		thread->stageStart = t;
+	}
+	~ProfileScope() {
+		if (!thread) return;
+		long long t = RenderProfiler::now();
+		thread->nanos[thread->stage] += t - thread->stageStart;
+		thread->stage = outer;
+		thread->stageStart = t;
+	}
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	ProfileThread* thread = nullptr;
+	int outer = -1;
+};
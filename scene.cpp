@@ -0,0 +1,326 @@
+#include "scene.h"
+#include "renderProfiler.h"
+#include <glm/gtx/intersect.hpp>
+
+//--------------------------------------------------------------
+//hit record form of intersect: accepts only hits in (tMin, hit.t) and
+//narrows hit.t; ray.d must be normalized so t is a distance
+//the caller fills in objectIndex
+//
+bool SceneObject::intersect(const Ray& ray, float tMin, HitRecord& hit) {
+	glm::vec3 point, normal;
+	if (!intersect(ray, point, normal)) return false;
+
+	float t = glm::distance(ray.p, point);
+	if (t <= tMin || t >= hit.t) return false;
+
+	hit.point = point;
+	hit.normal = normal;
+	hit.uv = getUV(point, normal);
+	hit.t = t;
+	return true;
+}
+
+//--------------------------------------------------------------
+//any-hit form for shadow rays: true if the object is hit in
+//(tMin, tMax), without building a hit record
+//
+bool SceneObject::occludes(const Ray& ray, float tMin, float tMax) {
+	glm::vec3 point, normal;
+	if (!intersect(ray, point, normal)) return false;
+
+	float t = glm::distance(ray.p, point);
+	return t > tMin && t < tMax;
+}
+
+//--------------------------------------------------------------
+//latitude / longitude mapping, u around the y axis and v from the
+//south pole up
+//
+glm::vec2 Sphere::getUV(const glm::vec3& p, const glm::vec3& normal) {
+	float u = .5f + atan2f(normal.z, normal.x) / TWO_PI;
+	float v = .5f + asinf(glm::clamp(normal.y, -1.0f, 1.0f)) / PI;
+	return glm::vec2(u, v);
+}
+
+// Intersect Ray with Plane  (wrapper on glm::intersect*
+//
+
+bool Plane::intersect(const Ray& ray, glm::vec3& point, glm::vec3& normalAtIntersect) {
+	float dist;
+	bool insidePlane = false;
+	bool hit = glm::intersectRayPlane(ray.p, ray.d, position, this->normal, dist);
+	if (hit) {
+		Ray r = ray;
+		point = r.evalPoint(dist);
+
+		normalAtIntersect = this->normal;
+		glm::vec2 xrange = glm::vec2(position.x - width / 2, position.x + width
+			/ 2);
+		glm::vec2 zrange = glm::vec2(position.z - height / 2, position.z +
+			height / 2);
+		if (point.x < xrange[1] && point.x > xrange[0] && point.z < zrange[1]
+			&& point.z > zrange[0]) {
+			insidePlane = true;
+		}
+	}
+	return insidePlane;
+}
+
+//--------------------------------------------------------------
+//bounds of the region Plane::intersect accepts: clipped in x and z,
+//flat along the normal and unbounded along any remaining axis
+//
+AABB Plane::getBounds() {
+	const float thickness = 1e-4;
+	AABB box = AABB::infinite();
+	box.min.x = position.x - width / 2;
+	box.max.x = position.x + width / 2;
+	box.min.z = position.z - height / 2;
+	box.max.z = position.z + height / 2;
+	for (int axis = 0; axis < 3; axis++) {
+		if (glm::abs(normal[axis]) == 1) {
+			box.min[axis] = position[axis] - thickness;
+			box.max[axis] = position[axis] + thickness;
+		}
+	}
+	return box;
+}
+
+//--------------------------------------------------------------
+//signed distance from p to the plane's infinite extension, positive on
+//the side the normal faces
+//
+float Plane::sdf(const glm::vec3& p) {
+	return glm::dot(p - position, glm::normalize(normal));
+}
+
+//--------------------------------------------------------------
+//loads the diffuse and specular maps from image files, kept CPU-side
+//an empty path leaves that map alone
+//
+void Plane::loadTextures(const string& diffusePath, const string& specularPath) {
+	if (!diffusePath.empty()) {
+		ofImage diffuse;
+		diffuse.setUseTexture(false);
+		diffuse.load(diffusePath);
+		texturePath = diffusePath;
+		setImage(diffuse);
+	}
+	if (!specularPath.empty()) {
+		ofImage specular;
+		specular.setUseTexture(false);
+		specular.load(specularPath);
+		specularTexturePath = specularPath;
+		setImageSpec(specular);
+	}
+}
+
+// Convert (u, v) to (x, y, z) 
+// We assume u,v is in [0, 1]
+//
+glm::vec3 ViewPlane::toWorld(float u, float v) {
+	float w = width();
+	float h = height();
+	return position + right * ((u * w) + min.x) + up * ((v * h) + min.y);
+}
+
+//--------------------------------------------------------------
+//points the camera at target; up only needs to be roughly up, it is
+//squared to the view direction
+//
+void RenderCam::lookAt(glm::vec3 target, glm::vec3 up) {
+	aim = target;
+	this->up = up;
+	updateBasis();
+}
+
+//--------------------------------------------------------------
+void RenderCam::setFov(float degrees) {
+	glm::vec2 center = (view.min + view.max) / 2.0f;
+	float h = 2 * viewDistance * tanf(glm::radians(degrees) / 2);
+	glm::vec2 half = glm::vec2(h * getAspect(), h) / 2.0f;
+	view.setSize(center - half, center + half);
+	updateBasis();
+}
+
+//--------------------------------------------------------------
+void RenderCam::setAspect(float aspect) {
+	glm::vec2 center = (view.min + view.max) / 2.0f;
+	glm::vec2 half = glm::vec2(view.height() * aspect, view.height()) / 2.0f;
+	view.setSize(center - half, center + half);
+	updateBasis();
+}
+
+//--------------------------------------------------------------
+float RenderCam::getFov() {
+	return glm::degrees(2 * atanf(view.height() / 2 / viewDistance));
+}
+
+//--------------------------------------------------------------
+//camera axes, the view plane placed in front of the eye, and the corner
+//and steps getRay builds directions from
+//
+void RenderCam::updateBasis() {
+	glm::vec3 d = aim - position;
+	forward = glm::length(d) > 1e-6f ? glm::normalize(d) : glm::vec3(0, 0, -1);
+
+	//an up along the view direction leaves roll open; take any other axis
+	glm::vec3 side = glm::cross(forward, up);
+	if (glm::length(side) < 1e-6f) side = glm::cross(forward, fabs(forward.y) < .9f ? glm::vec3(0, 1, 0) : glm::vec3(0, 0, -1));
+	right = glm::normalize(side);
+	upAxis = glm::cross(right, forward);
+
+	view.position = position + forward * viewDistance;
+	view.normal = -forward;
+	view.right = right;
+	view.up = upAxis;
+
+	corner = forward * viewDistance + right * view.min.x + upAxis * view.min.y;
+	stepU = right * view.width();
+	stepV = upAxis * view.height();
+}
+
+//--------------------------------------------------------------
+// Get a ray from the current camera position to the (u, v) position on
+// the ViewPlane
+//
+Ray RenderCam::getRay(float u, float v) const {
+	return Ray(position, glm::normalize(corner + v * stepV + u * stepU));
+}
+
+//--------------------------------------------------------------
+//each row starts from its own multiple of stepV, so a pixel's ray does
+//not depend on which block it was generated in
+//
+void RenderCam::getRays(int x0, int y0, int x1, int y1, int width, int height, Ray* rays) const {
+	for (int y = y0; y < y1; y++) {
+		float v = 1 - (y + .5) / height;
+		glm::vec3 row = corner + v * stepV;
+		for (int x = x0; x < x1; x++) {
+			float u = (x + .5) / width;
+			*rays++ = Ray(position, glm::normalize(row + u * stepU));
+		}
+	}
+}
+
+//--------------------------------------------------------------
+bool RenderCam::project(const glm::vec3& p, float& u, float& v) const {
+	glm::vec3 q = p - position;
+	float z = glm::dot(q, forward);
+	if (z < 1e-4f) return false;
+
+	float s = viewDistance / z;
+	u = (s * glm::dot(q, right) - view.min.x) / (view.max.x - view.min.x);
+	v = (s * glm::dot(q, upAxis) - view.min.y) / (view.max.y - view.min.y);
+	return true;
+}
+
+//--------------------------------------------------------------
+//the edges from the eye to the corners of the view, and the view itself
+//
+void RenderCam::drawFrustum() {
+	ofNoFill();
+	glm::vec3 corners[4] = { view.toWorld(0, 0), view.toWorld(1, 0), view.toWorld(1, 1), view.toWorld(0, 1) };
+	for (int k = 0; k < 4; k++) ofDrawLine(position, corners[k]);
+	view.draw();
+	ofFill();
+}
+
+//--------------------------------------------------------------
+//converts the image and specular map into the sampling cache
+//called whenever either of them is set
+//
+void Plane::buildTexture() {
+	ofPixels none;
+	texture.build(hasTexture ? image.getPixels() : none, hasTextureSpecular ? imageSpec.getPixels() : none);
+	updateTiling();
+
+	int tiles = normal == glm::vec3(0, 1, 0) ? floortiles : walltiles;
+	texelsPerUnit = std::max(texture.getWidth() * tiles / width, texture.getHeight() * tiles / height);
+}
+
+//--------------------------------------------------------------
+//the scales textureCoords() multiplies by, so a hit needs no divide
+//called again by buildTexture() in case the size or tiles were changed
+//
+void Plane::updateTiling() {
+	int tiles = normal == glm::vec3(0, 1, 0) ? floortiles : walltiles;
+	tilesPerUnit = glm::vec2(tiles / width, tiles / height);
+}
+
+//--------------------------------------------------------------
+//texture coordinates of a point on the plane, repeating every
+//1 / tiles of the plane
+//only the ground (y up) and wall (z facing) orientations are mapped;
+//returns false for any other plane
+//
+bool Plane::textureCoords(const glm::vec3& p, glm::vec2& uv) {
+	//ground plane
+	if (normal == glm::vec3(0, 1, 0)) {
+		float x = p.x - position.x;
+		float y = p.z - position.z;
+
+		uv.x = (x - (position.x - getWidth() / 2)) * tilesPerUnit.x;
+		uv.y = (y - (position.z - getHeight() / 2)) * tilesPerUnit.y;
+		return true;
+	}
+	//wall plane
+	else if (normal == glm::vec3(0, 0, 1)) {
+		float x = p.x - position.x;
+		float y = p.y - position.y;
+
+		uv.x = (x - (position.x - getWidth() / 2)) * tilesPerUnit.x;
+		uv.y = (y - (position.y - getHeight() / 2)) * tilesPerUnit.y;
+		return true;
+	}
+	return false;
+}
+
+glm::vec2 Plane::getUV(const glm::vec3& p, const glm::vec3& normal) {
+	glm::vec2 uv = glm::vec2(0);
+	textureCoords(p, uv);
+	return uv;
+}
+
+//--------------------------------------------------------------
+//diffuse and specular at the hit's uv in one texture lookup, filtered
+//for a pixel footprint wide
+//untextured channels keep the plane's material color; planes the
+//texture coordinates do not cover stay black, as before
+//
+MaterialRecord Plane::getMaterial(const HitRecord& hit, float footprint) {
+	MaterialRecord material = { toRadiance(diffuseColor), toRadiance(specularColor) };
+	if (!hasTexture && !hasTextureSpecular) return material;
+
+	glm::vec3 diffuse = glm::vec3(0), specular = glm::vec3(0);
+	if (normal == glm::vec3(0, 1, 0) || normal == glm::vec3(0, 0, 1)) {
+		renderProfiler().count(PROFILE_TEXTURE_FETCHES);
+		texture.sample(hit.uv.x, hit.uv.y, footprint * texelsPerUnit, diffuse, specular);
+	}
+	if (hasTexture) material.diffuse = diffuse;
+	if (hasTextureSpecular) material.specular = specular;
+	return material;
+}
+
+//--------------------------------------------------------------
+//converts the current point on the plane to a pixel on texture map
+//returns the color from the texture
+ofColor Plane::textureMap(glm::vec3 p) {
+	HitRecord hit;
+	hit.point = p;
+	hit.uv = getUV(p, normal);
+	glm::vec3 c = getMaterial(hit, 0).diffuse * 255.0f;
+	return ofColor(c.x, c.y, c.z);
+}
+
+//--------------------------------------------------------------
+//converts the point to a pixel on the texture specular map
+//returns the specular color from the texture
+ofColor Plane::specularTextureMap(glm::vec3 p) {
+	HitRecord hit;
+	hit.point = p;
+	hit.uv = getUV(p, normal);
+	glm::vec3 c = getMaterial(hit, 0).specular * 255.0f;
+	return ofColor(c.x, c.y, c.z);
+}
@@ -0,0 +1,570 @@
+#pragma once
+
+#include "ofMain.h"
+#include "surfaceTexture.h"
+
+#include <glm/gtx/intersect.hpp>
+
+//  General Purpose Ray class 
+//
+class Ray {
+public:
+	Ray() {}
+	Ray(glm::vec3 p, glm::vec3 d) { this->p = p; this->d = d; }
+	void draw(float t) { ofDrawLine(p, p + t * d); }
+
+	glm::vec3 evalPoint(float t) {
+		return (p + t * d);
+	}
+
+	glm::vec3 p, d;
+};
+
+//  Per-ray intersection state.  Filled in by the tracer instead of
+//  writing into the scene objects, so any number of rays can be traced
+//  against the same scene at once.
+//
+//  t is the parametric distance along the (normalized) ray and doubles as
+//  tMax: an intersect call only accepts hits nearer than t and narrows it,
+//  so objects tested later can give up early.
+//
+struct HitRecord {
+	glm::vec3 point;
+	glm::vec3 normal;
+	glm::vec2 uv = glm::vec2(0);
+	float t = FLT_MAX;
+	int objectIndex = -1;
+	int instance = -1;			// which instance, when the object is an InstanceSet
+};
+
+//  Axis aligned bounding box.  Objects that extend forever along some
+//  axis report FLT_MAX there and are kept out of the BVH.
+//
+struct AABB {
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	AABB() {}
+	AABB(const glm::vec3& min, const glm::vec3& max) { this->min = min; this->max = max; }
+	static AABB infinite() { return AABB(glm::vec3(-FLT_MAX), glm::vec3(FLT_MAX)); }
+
+	void grow(const glm::vec3& p) { min = glm::min(min, p); max = glm::max(max, p); }
+	void grow(const AABB& b) { min = glm::min(min, b.min); max = glm::max(max, b.max); }
+	glm::vec3 center() const { return (min + max) * .5f; }
+	glm::vec3 extent() const { return max - min; }
+	float area() const {
+		glm::vec3 e = extent();
+		return 2 * (e.x * e.y + e.y * e.z + e.z * e.x);
+	}
+	bool isBounded() const {
+		return min.x > -FLT_MAX && min.y > -FLT_MAX && min.z > -FLT_MAX &&
+			max.x < FLT_MAX && max.y < FLT_MAX && max.z < FLT_MAX;
+	}
+};
+
+//  8 bit material color to linear radiance, 255 = 1.0
+//
+inline glm::vec3 toRadiance(const ofColor& c) {
+	return glm::vec3(c.r, c.g, c.b) / 255.0f;
+}
+
+//  Rotation about x, then y, then z, angles in degrees
+//
+inline glm::mat3 eulerRotation(const glm::vec3& degrees) {
+	float cx = cos(glm::radians(degrees.x)), sx = sin(glm::radians(degrees.x));
+	float cy = cos(glm::radians(degrees.y)), sy = sin(glm::radians(degrees.y));
+	float cz = cos(glm::radians(degrees.z)), sz = sin(glm::radians(degrees.z));
+	glm::mat3 x = glm::mat3(glm::vec3(1, 0, 0), glm::vec3(0, cx, sx), glm::vec3(0, -sx, cx));
+	glm::mat3 y = glm::mat3(glm::vec3(cy, 0, -sy), glm::vec3(0, 1, 0), glm::vec3(sy, 0, cy));
+	glm::mat3 z = glm::mat3(glm::vec3(cz, sz, 0), glm::vec3(-sz, cz, 0), glm::vec3(0, 0, 1));
+	return z * y * x;
+}
+
+//  Surface colors at a hit point in linear radiance.  Plain data, looked
+//  up once per hit and handed to the shading functions by reference.
+//
+struct MaterialRecord {
+	glm::vec3 diffuse;
+	glm::vec3 specular;
+	float reflectivity = 0;         // mirror and glass, see SceneObject
+	float transparency = 0;
+	float ior = 1.5;
+
+	bool hasSecondaryRays() const { return reflectivity > 0 || transparency > 0; }
+};
+
+//  What an object is, for dispatching without virtual calls or casts
+//
+enum ObjectType {
+	OBJECT_OTHER,
+	OBJECT_PLANE,
+	OBJECT_SPHERE,
+	OBJECT_SDF,
+	OBJECT_MESH,
+	OBJECT_INSTANCES,
+	OBJECT_LIGHT,
+	OBJECT_AIM_POINT
+};
+
+//  Names an object owned by a SceneStore: the pool it lives in, its slot
+//  there and how often that slot had been freed when the object was made
+//
+struct SceneHandle {
+	ObjectType type = OBJECT_OTHER;
+	int slot = -1;
+	uint32_t generation = 0;
+};
+
+//  Base class for any renderable object in the scene
+//
+class SceneObject {
+public:
+	virtual ~SceneObject() {}
+	virtual void draw() = 0;    // pure virtual funcs - must be overloaded
+	virtual bool intersect(const Ray& ray, glm::vec3& point, glm::vec3& normal) { cout << "SceneObject::intersect" << endl; return false; }
+	virtual bool intersect(const Ray& ray, float tMin, HitRecord& hit);
+	virtual bool occludes(const Ray& ray, float tMin, float tMax);
+	virtual glm::vec2 getUV(const glm::vec3& p, const glm::vec3& normal) { return glm::vec2(0); }
+	virtual glm::vec3 getNormal(const glm::vec3& p) { return glm::vec3(0); }
+	virtual AABB getBounds() { return AABB::infinite(); }
+	virtual void setImage(ofImage i) {}
+	virtual void setImageSpec(ofImage i) {}
+	virtual ofColor getDiffuse(glm::vec3 p) { return diffuseColor; }
+	virtual ofColor getSpecular(glm::vec3 p) { return specularColor; }
+
+	//  footprint is the width in world units of the pixel seen at the hit,
+	//  for picking a texture mip level (0 = sharpest)
+	//
+	virtual MaterialRecord getMaterial(const HitRecord& hit, float footprint = 0) { return MaterialRecord{ toRadiance(getDiffuse(hit.point)), toRadiance(getSpecular(hit.point)) }; }
+	virtual bool aimPointIntersect(const Ray& ray, glm::vec3& point, glm::vec3& normal) { return false; }
+
+	// any data common to all scene objects goes here
+	ObjectType type = OBJECT_OTHER;
+	SceneHandle handle;				// set by the SceneStore that owns the object
+	glm::vec3 position = glm::vec3(0, 0, 0);
+	float radius = 0;
+	float intensity = 0;
+	float power = 0;
+	float coneAngle = 0;
+	float Width = 0;
+	float coneAngleDeg = 0;
+
+
+	// material properties (we will ultimately replace this with a Material class - TBD)
+	//
+	ofColor diffuseColor = ofColor::grey;    // default colors - can be changed.
+	ofColor specularColor = ofColor::lightGray;
+
+	// mirror and glass, traced with secondary rays.  reflectivity is the
+	// mirror's reflectance head on, rising towards 1 at grazing angles and
+	// tinted by the specular color.  transparency is the share that is a
+	// dielectric of index ior, split between reflection and refraction by
+	// the Fresnel equations and tinted by the diffuse color.  Rays bend
+	// only at spheres; other objects are thin sheets they pass straight
+	// through.
+	//
+	float reflectivity = 0;
+	float transparency = 0;
+	float ior = 1.5;
+
+	ofImage image;
+
+	bool isSpotLight = false;
+	bool isAreaLight = false;
+
+	bool isSelectable = true;
+	bool isSelected = false;
+	bool hasTexture = false;
+	bool hasTextureSpecular = false;
+	
+};
+
+//  General purpose plane 
+//
+class Plane : public SceneObject {
+public:
+	Plane(glm::vec3 p, glm::vec3 n, ofColor diffuse,
+		float w, float h) {
+		position = p; normal = n;
+		width = w;
+		height = h;
+		diffuseColor = diffuse;
+		isSelectable = false;
+		type = OBJECT_PLANE;
+		if (normal == glm::vec3(0, 1, 0)) plane.rotateDeg(90, 1, 0, 0);
+		updateTiling();
+	}
+	Plane() {
+		type = OBJECT_PLANE;
+		normal = glm::vec3(0, 1, 0);
+		plane.rotateDeg(90, 1, 0, 0);
+		isSelectable = false;
+
+	}
+	bool intersect(const Ray& ray, glm::vec3& point, glm::vec3& normal);
+	using SceneObject::intersect;
+	float sdf(const glm::vec3& p);
+	glm::vec3 getNormal(const glm::vec3& p) { return this->normal; }
+	AABB getBounds();
+	float getWidth() { return width; }
+	float getHeight() { return height; }
+	ofColor textureMap(glm::vec3 p);
+	ofColor specularTextureMap(glm::vec3 p);
+	bool textureCoords(const glm::vec3& p, glm::vec2& uv);
+	glm::vec2 getUV(const glm::vec3& p, const glm::vec3& normal);
+	void buildTexture();
+	void updateTiling();
+	MaterialRecord getMaterial(const HitRecord& hit, float footprint);
+
+	ofColor getDiffuse(glm::vec3 p) {
+		if (hasTexture) {
+			return textureMap(p);
+		}
+		else {
+			return diffuseColor;
+		}
+	}
+
+	ofColor getSpecular(glm::vec3 p) {
+		if (hasTextureSpecular) {
+			return specularTextureMap(p);
+		}
+		else {
+			return specularColor;
+		}
+	}
+
+	void setImage(ofImage i) {
+		image = i;
+		hasTexture = true;
+		buildTexture();
+	}
+	void setImageSpec(ofImage i) {
+		imageSpec = i;
+		hasTextureSpecular = true;
+		buildTexture();
+	}
+	void loadTextures(const string& diffusePath, const string& specularPath);
+	void draw() {
+		plane.setPosition(position);
+		plane.setWidth(width);
+		plane.setHeight(height);
+		plane.setResolution(4, 4);
+		plane.draw();
+	}
+
+
+	ofPlanePrimitive plane;
+	glm::vec3 normal;
+	float width;
+	float height;
+	ofImage image;
+	ofImage imageSpec;
+	string texturePath;				// files image and imageSpec came from, for saving
+	string specularTexturePath;
+	SurfaceTexture texture;			// image and imageSpec converted for sampling
+	float texelsPerUnit = 0;		// level 0 texels per world unit, for mip selection
+	glm::vec2 tilesPerUnit = glm::vec2(1);	// texture repeats per world unit across and down, from updateTiling()
+
+	bool hasTexture = false;
+	bool hasTextureSpecular = false;
+
+	int floortiles = 1;
+	int walltiles = 1;
+};
+
+
+
+
+//  General purpose sphere  (assume parametric)
+//
+class Sphere : public SceneObject {
+public:
+	Sphere(glm::vec3 p, float r, ofColor diffuse = ofColor::lightGray) { type = OBJECT_SPHERE; position = p; radius = r; diffuseColor = diffuse; }
+	Sphere() { type = OBJECT_SPHERE; }
+	// ray.d must be normalized (RenderCam::getRay and the BVH queries do this)
+	//
+	bool intersect(const Ray& ray, glm::vec3& point, glm::vec3& normal) {
+		bool intersect = (glm::intersectRaySphere(ray.p, ray.d, position, radius, point, normal));
+		if (intersect) normal = glm::normalize(normal);
+		return intersect;
+	}
+	using SceneObject::intersect;
+	void draw() {
+		if (isSelected) {
+			ofNoFill();
+		}
+		else {
+			ofFill();
+		}
+		ofDrawSphere(position, radius);
+	}
+
+
+	glm::vec3 getNormal(const glm::vec3& p) { return glm::normalize(p - position); }
+	glm::vec2 getUV(const glm::vec3& p, const glm::vec3& normal);
+	AABB getBounds() { return AABB(position - glm::vec3(radius), position + glm::vec3(radius)); }
+
+	ofColor getDiffuse(glm::vec3 p) { return diffuseColor; }
+
+};
+
+
+enum LightType {
+	LIGHT_POINT,
+	LIGHT_SPOT,
+	LIGHT_AREA
+};
+
+//  Everything the shader needs to know about a light, without the image
+//  and GUI state SceneObject carries.  Trivially copyable: the tracer packs
+//  one per light at the start of a frame and shades from those.
+//
+struct LightRecord {
+	glm::vec3 position;
+	glm::vec3 aimPoint;
+	float intensity;
+	float power;            // Phong exponent of the highlight
+	float coneAngle;
+	float width;
+	LightType type;
+	glm::vec3 edgeU;        // area light: the two sides of its Width x Width
+	glm::vec3 edgeV;        // rectangle, as drawn, centred on position
+	glm::vec3 axis;         // unit vector from position towards aimPoint
+	float cosCutoff;        // spot light: cosine of half coneAngle, -2 if it lights everything
+
+	//  true if p is inside a spot light's cone; the test is on cosines, so
+	//  no inverse trigonometry per point
+	//
+	bool inCone(const glm::vec3& p) const {
+		return -glm::dot(axis, glm::normalize(position - p)) > cosCutoff;
+	}
+};
+
+class Light : public SceneObject {
+public:
+	Light(glm::vec3 p, glm::vec3 aimPos, float i, float angle, float width) { 
+		type = OBJECT_LIGHT;
+		position = p; 
+		intensity = i; 
+		power = 100;
+		coneAngleDeg = angle;
+		coneAngle = tan(glm::radians(angle)) * coneHeight;
+		Width = width;
+		radius = .5;
+		aimPoint = aimPos;
+		planeHeight = width;
+		setPointLight();
+	}
+	Light() { type = OBJECT_LIGHT; }
+
+	void setPointLight() {
+		isSpotLight = false;
+		isAreaLight = false;
+	}
+
+	void setSpotLight() {
+		isSpotLight = true;
+		isAreaLight = false;
+	}
+
+	void setAreaLight() {
+		isSpotLight = false;
+		isAreaLight = true;
+	}
+
+
+	using SceneObject::intersect;
+	bool intersect(const Ray& ray, glm::vec3& point, glm::vec3& normal) {
+		if (isAreaLight) {
+			Plane p = Plane(position, glm::normalize(position - aimPoint), ofColor::grey, planeHeight, planeHeight);
+			return p.intersect(ray, point, normal);
+		}
+		else {
+			return (glm::intersectRaySphere(ray.p, ray.d, position, radius, point, normal));
+		}
+	}
+
+	bool aimPointIntersect(const Ray& ray, glm::vec3& point, glm::vec3& normal) {
+		if (isSpotLight || isAreaLight) {
+			return (glm::intersectRaySphere(ray.p, ray.d, aimPoint, aimPointRadius, point, normal));
+		}
+		else {
+			return false;
+		}
+	}
+
+	void draw() {
+		ofSetColor(ofColor::gray);
+		if (isSelected) {
+			ofNoFill();
+		}
+		else {
+			ofFill();
+		}
+
+		if (isSpotLight) {
+			// draw a cone object oriented towards aim position using the lookAt transformation
+	// matrix.  The "up" vector is (0, 1, 0)
+	//
+			ofPushMatrix();
+			glm::mat4 m = glm::lookAt(position, aimPoint, glm::vec3(0, 1, 0));
+			ofMultMatrix(glm::inverse(m));
+			ofRotate(-90, 1, 0, 0);
+			ofDrawCone(coneAngle, 5);
+			ofPopMatrix();
+			ofDrawLine(position, aimPoint);
+
+		}
+		else if (isAreaLight) {
+			//draw rectangle
+			ofPushMatrix();
+			glm::mat4 m = glm::lookAt(position, aimPoint, glm::vec3(0, 1, 0));
+			ofMultMatrix(glm::inverse(m));
+			ofDrawRectangle(glm::vec3(-Width / 2, -Width / 2, 0), Width, Width);
+			ofPopMatrix();
+			ofDrawLine(position, aimPoint);
+		}
+		else {
+			ofDrawSphere(position, radius);
+		}
+	}
+
+	void setIntensity(float i) {
+		intensity = i;
+	}
+
+	LightRecord getRecord() const {
+		LightType type = isSpotLight ? LIGHT_SPOT : isAreaLight ? LIGHT_AREA : LIGHT_POINT;
+
+		//x and y axes of the lookAt frame draw() uses for the rectangle
+		glm::vec3 forward = glm::normalize(aimPoint - position);
+		glm::vec3 side = glm::cross(forward, glm::vec3(0, 1, 0));
+		side = glm::length(side) > 1e-6 ? glm::normalize(side) : glm::vec3(1, 0, 0);
+		glm::vec3 up = glm::cross(side, forward);
+		float cosCutoff = coneAngle / 2 < PI ? cos(coneAngle / 2) : -2;
+		return LightRecord{ position, aimPoint, intensity, power, coneAngle, Width, type, side * Width, up * Width, forward, cosCutoff };
+	}
+
+	glm::vec3 direction = glm::vec3(0);
+	glm::vec3 aimPoint = glm::vec3(0);
+
+
+	float aimPointRadius = .2;
+	float length = 10;
+	float coneHeight = 5;
+	int planeHeight;
+	
+};
+
+// view plane for render camera
+// 
+class  ViewPlane : public Plane {
+public:
+	ViewPlane(glm::vec2 p0, glm::vec2 p1) { min = p0; max = p1; }
+
+	ViewPlane() {                         // create reasonable defaults (6x4 aspect)
+		min = glm::vec2(-3, -2);
+		max = glm::vec2(3, 2);
+		position = glm::vec3(0, 0, 5);
+		normal = glm::vec3(0, 0, 1);      // the render camera turns it to face the eye
+	}
+
+	void setSize(glm::vec2 min, glm::vec2 max) { this->min = min; this->max = max; }
+	float getAspect() { return width() / height(); }
+
+	glm::vec3 toWorld(float u, float v);   //   (u, v) --> (x, y, z) [ world space ]
+
+	void draw() {
+		glm::vec3 corners[4] = { toWorld(0, 0), toWorld(1, 0), toWorld(1, 1), toWorld(0, 1) };
+		for (int k = 0; k < 4; k++) ofDrawLine(corners[k], corners[(k + 1) % 4]);
+	}
+
+	float width() {
+		return (max.x - min.x);
+	}
+	float height() {
+		return (max.y - min.y);
+	}
+
+	// some convenience methods for returning the corners
+	//
+	glm::vec2 topLeft() { return glm::vec2(min.x, max.y); }
+	glm::vec2 topRight() { return max; }
+	glm::vec2 bottomLeft() { return min; }
+	glm::vec2 bottomRight() { return glm::vec2(max.x, min.y); }
+
+	//  To define an infinite plane, we just need a point and normal.
+	//  The ViewPlane is a finite plane so we need to define the boundaries.
+	//  We will define this in terms of min, max  in 2D.  
+	//  (in local 2D space of the plane)
+	//  ultimately, will want to locate the ViewPlane with RenderCam anywhere
+	//  in the scene, so it is easier to define the View rectangle in a local'
+	//  coordinate system.  position is the point of the plane straight
+	//  ahead of the camera, right and up its local axes in world space.
+	//
+	glm::vec2 min, max;
+	glm::vec3 right = glm::vec3(1, 0, 0);
+	glm::vec3 up = glm::vec3(0, 1, 0);
+};
+
+
+//  render camera: a pinhole at position looking at aim, rolled so that up
+//  points up in the image.  The view plane stands viewDistance in front of
+//  it, square to the view direction; view.min and view.max bound the image
+//  on that plane, measured from the point straight ahead, so they set the
+//  field of view, the aspect and any off-center shift together.
+//
+//  updateBasis() turns all of this into the direction to the image's
+//  bottom left corner and one step per unit of u and v, so a ray is two
+//  multiply-adds and a normalize.  lookAt, setFov and setAspect update the
+//  basis, and so does every frame the tracer starts; call it yourself
+//  after changing the members directly.
+//
+class RenderCam : public SceneObject {
+public:
+	RenderCam() {
+		position = glm::vec3(0, 0, 10);
+		aim = glm::vec3(0, 0, -1);
+		updateBasis();
+	}
+
+	void lookAt(glm::vec3 target, glm::vec3 up = glm::vec3(0, 1, 0));
+	void setFov(float degrees);          // vertical, keeps the aspect
+	void setAspect(float aspect);        // width / height, keeps the vertical field of view
+	float getFov();
+	float getAspect() { return view.getAspect(); }
+	void updateBasis();
+
+	//  (u, v) in [0, 1], v up
+	//
+	Ray getRay(float u, float v) const;
+
+	//  one ray through the center of each pixel of the block [x0, x1) x
+	//  [y0, y1) of a width x height image, row by row, pixel rows counted
+	//  from the top; a tile or a row packet in one call
+	//
+	void getRays(int x0, int y0, int x1, int y1, int width, int height, Ray* rays) const;
+
+	//  the (u, v) a world point appears at; false if it is not in front of
+	//  the camera
+	//
+	bool project(const glm::vec3& p, float& u, float& v) const;
+
+	void draw() { ofDrawBox(position, 1.0); };
+	void drawFrustum();
+
+	glm::vec3 aim;
+	glm::vec3 up = glm::vec3(0, 1, 0);
+	float viewDistance = 5;
+	ViewPlane view;          // The camera viewplane, this is the view that we will render 
+
+	//  the camera's axes, set by updateBasis
+	//
+	glm::vec3 forward, right, upAxis;
+
+private:
+	glm::vec3 corner;        // eye to the view's bottom left corner
+	glm::vec3 stepU;         // across the whole view, u 0 to 1
+	glm::vec3 stepV;
+};
@@ -0,0 +1,1106 @@
+#include "sceneFile.h"
+#include "meshFile.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//  Binary layout: this header, then the sphere, plane, light, SDF object,
+//  shape, mesh, instance set, geometry, material and instance arrays and
+//  the string table, each starting on a 16 byte boundary at the offset
+//  the header gives.  Everything is stored in the
+//  writer's byte order; byteOrder lets a reader on the other kind of
+//  machine refuse the file.
+//
+//  Version 2 files end the header after the camera and hold no SDF
+//  objects, version 3 files end it before meshOffset and hold no meshes,
+//  version 4 files end it before instanceSetCount and hold no instance
+//  sets; all still load.
+//
+static const char binaryMagic[8] = { 'R', 'T', 'S', 'C', 'E', 'N', 'E', 0 };
+static const uint32_t binaryVersion = 5;                  // 2: mirror and glass settings, 3: SDF objects, 4: meshes, 5: instance sets
+static const uint32_t byteOrderMark = 0x01020304;
+
+struct BinaryHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t sphereCount;
+	uint32_t planeCount;
+	uint32_t lightCount;
+	uint32_t stringBytes;
+	uint64_t sphereOffset;
+	uint64_t planeOffset;
+	uint64_t lightOffset;
+	uint64_t stringOffset;
+	CameraEntry camera;             // its up vector took the place of three reserved words
+	uint32_t sdfCount;              // version 3 on
+	uint32_t shapeCount;
+	uint64_t sdfOffset;
+	uint64_t shapeOffset;
+	uint32_t meshCount;             // version 4 on, in what was a reserved word
+	uint32_t reserved;
+	uint64_t meshOffset;
+	uint64_t reserved2;
+	uint32_t instanceSetCount;      // version 5 on
+	uint32_t geometryCount;
+	uint32_t materialCount;
+	uint32_t instanceCount;
+	uint64_t instanceSetOffset;
+	uint64_t geometryOffset;
+	uint64_t materialOffset;
+	uint64_t instanceOffset;
+};
+
+static const size_t version2HeaderSize = offsetof(BinaryHeader, sdfCount);
+static const size_t version3HeaderSize = offsetof(BinaryHeader, meshOffset);
+static const size_t version4HeaderSize = offsetof(BinaryHeader, instanceSetCount);
+
+static_assert(sizeof(CameraEntry) == 64, "CameraEntry must stay packed");
+static_assert(sizeof(SphereEntry) == 36, "SphereEntry must stay packed");
+static_assert(sizeof(PlaneEntry) == 60, "PlaneEntry must stay packed");
+static_assert(sizeof(LightEntry) == 48, "LightEntry must stay packed");
+static_assert(sizeof(SDFEntry) == 40, "SDFEntry must stay packed");
+static_assert(sizeof(ShapeEntry) == 48, "ShapeEntry must stay packed");
+static_assert(sizeof(MeshEntry) == 36, "MeshEntry must stay packed");
+static_assert(sizeof(InstanceSetEntry) == 40, "InstanceSetEntry must stay packed");
+static_assert(sizeof(GeometryEntry) == 4, "GeometryEntry must stay packed");
+static_assert(sizeof(MaterialEntry) == 20, "MaterialEntry must stay packed");
+static_assert(sizeof(InstanceEntry) == 36, "InstanceEntry must stay packed");
+static_assert(version2HeaderSize == 128, "the version 2 header must keep its layout");
+static_assert(version3HeaderSize == 160, "the version 3 header must keep its layout");
+static_assert(version4HeaderSize == 176, "the version 4 header must keep its layout");
+static_assert(sizeof(BinaryHeader) % 16 == 0, "BinaryHeader must keep the arrays aligned");
+
+static uint64_t alignUp(uint64_t n) { return (n + 15) & ~uint64_t(15); }
+
+static void toFloats(const glm::vec3& v, float* out) { out[0] = v.x; out[1] = v.y; out[2] = v.z; }
+static glm::vec3 toVec3(const float* f) { return glm::vec3(f[0], f[1], f[2]); }
+static void toBytes(const ofColor& c, uint8_t* out) { out[0] = c.r; out[1] = c.g; out[2] = c.b; out[3] = 255; }
+static ofColor toColor(const uint8_t* b) { return ofColor(b[0], b[1], b[2]); }
+
+static const char* lightTypeNames[] = { "point", "spot", "area" };
+static const char* shapeNames[] = { "sphere", "box", "plane", "torus" };
+
+static void toCameraEntry(const RenderCam& cam, CameraEntry& camera) {
+	toFloats(cam.position, camera.position);
+	toFloats(cam.aim, camera.aim);
+	toFloats(cam.up, camera.up);
+	toFloats(cam.view.position, camera.viewPosition);
+	camera.viewMin[0] = cam.view.min.x; camera.viewMin[1] = cam.view.min.y;
+	camera.viewMax[0] = cam.view.max.x; camera.viewMax[1] = cam.view.max.y;
+}
+
+//--------------------------------------------------------------
+SceneFile::~SceneFile() {
+	clear();
+}
+
+//--------------------------------------------------------------
+//drops the entries and unmaps the file, if one is mapped
+//
+void SceneFile::clear() {
+	if (mapping) {
+#ifdef _WIN32
+		UnmapViewOfFile(mapping);
+		CloseHandle((HANDLE)mapHandle);
+		CloseHandle((HANDLE)fileHandle);
+		mapHandle = fileHandle = nullptr;
+#else
+		munmap(mapping, mappingSize);
+#endif
+		mapping = nullptr;
+		mappingSize = 0;
+	}
+	sphereData.clear();
+	planeData.clear();
+	lightData.clear();
+	sdfData.clear();
+	shapeData.clear();
+	meshData.clear();
+	instanceSetData.clear();
+	geometryData.clear();
+	materialData.clear();
+	instanceData.clear();
+	stringData.clear();
+	spheres = nullptr;
+	planes = nullptr;
+	lights = nullptr;
+	sdfs = nullptr;
+	shapes = nullptr;
+	meshes = nullptr;
+	instanceSets = nullptr;
+	geometries = nullptr;
+	materials = nullptr;
+	instances = nullptr;
+	strings = nullptr;
+	sphereCount = planeCount = lightCount = sdfCount = shapeCount = meshCount = 0;
+	instanceSetCount = geometryCount = materialCount = instanceCount = 0;
+	stringBytes = 0;
+}
+
+//--------------------------------------------------------------
+bool SceneFile::isBinaryPath(const string& path) {
+	const string ext = ".bscene";
+	return path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+//--------------------------------------------------------------
+//reads the first bytes to tell the two forms apart
+//
+bool SceneFile::load(const string& path) {
+	ifstream in(path, ios::binary);
+	if (!in) {
+		cerr << path << ": cannot open" << endl;
+		return false;
+	}
+	char magic[sizeof(binaryMagic)] = {};
+	in.read(magic, sizeof(magic));
+	bool binary = in.gcount() == sizeof(magic) && memcmp(magic, binaryMagic, sizeof(magic)) == 0;
+	in.close();
+
+	clear();
+	bool ok = binary ? loadBinary(path) : loadText(path);
+	if (!ok) clear();
+	return ok;
+}
+
+//--------------------------------------------------------------
+bool SceneFile::save(const string& path) const {
+	return isBinaryPath(path) ? saveBinary(path) : saveText(path);
+}
+
+//--------------------------------------------------------------
+//maps the file read only and points the entry arrays into it
+//
+bool SceneFile::loadBinary(const string& path) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		cerr << path << ": cannot open" << endl;
+		return false;
+	}
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	HANDLE map = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	void* view = map ? MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!view) {
+		if (map) CloseHandle(map);
+		CloseHandle(file);
+		cerr << path << ": cannot map" << endl;
+		return false;
+	}
+	fileHandle = file;
+	mapHandle = map;
+	mapping = view;
+	mappingSize = (size_t)size.QuadPart;
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		cerr << path << ": cannot open" << endl;
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size < (off_t)version2HeaderSize) {
+		close(fd);
+		cerr << path << ": truncated header" << endl;
+		return false;
+	}
+	void* view = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED) {
+		cerr << path << ": cannot map" << endl;
+		return false;
+	}
+	mapping = view;
+	mappingSize = info.st_size;
+#endif
+
+	if (mappingSize < version2HeaderSize) {
+		cerr << path << ": truncated header" << endl;
+		return false;
+	}
+	const char* base = (const char*)mapping;
+	BinaryHeader header = {};
+	memcpy(&header, base, version2HeaderSize);
+	if (header.byteOrder != byteOrderMark) {
+		cerr << path << ": written on a machine of the other byte order" << endl;
+		return false;
+	}
+	if (header.version < 2 || header.version > binaryVersion) {
+		cerr << path << ": unsupported version " << header.version << endl;
+		return false;
+	}
+	if (header.version > 2) {
+		size_t size = header.version == 3 ? version3HeaderSize : header.version == 4 ? version4HeaderSize : sizeof(BinaryHeader);
+		if (mappingSize < size) {
+			cerr << path << ": truncated header" << endl;
+			return false;
+		}
+		memcpy(&header, base, size);
+		if (header.version == 3) header.meshCount = 0;
+	}
+
+	//each array has to lie inside the file and start aligned
+	auto inside = [&](uint64_t offset, uint64_t count, uint64_t size) {
+		return offset % 16 == 0 && offset <= mappingSize && count <= (mappingSize - offset) / size;
+	};
+	if (!inside(header.sphereOffset, header.sphereCount, sizeof(SphereEntry)) ||
+		!inside(header.planeOffset, header.planeCount, sizeof(PlaneEntry)) ||
+		!inside(header.lightOffset, header.lightCount, sizeof(LightEntry)) ||
+		!inside(header.sdfOffset, header.sdfCount, sizeof(SDFEntry)) ||
+		!inside(header.shapeOffset, header.shapeCount, sizeof(ShapeEntry)) ||
+		!inside(header.meshOffset, header.meshCount, sizeof(MeshEntry)) ||
+		!inside(header.instanceSetOffset, header.instanceSetCount, sizeof(InstanceSetEntry)) ||
+		!inside(header.geometryOffset, header.geometryCount, sizeof(GeometryEntry)) ||
+		!inside(header.materialOffset, header.materialCount, sizeof(MaterialEntry)) ||
+		!inside(header.instanceOffset, header.instanceCount, sizeof(InstanceEntry)) ||
+		!inside(header.stringOffset, header.stringBytes, 1) ||
+		header.sphereCount > INT32_MAX || header.planeCount > INT32_MAX || header.lightCount > INT32_MAX ||
+		header.sdfCount > INT32_MAX || header.shapeCount > INT32_MAX || header.meshCount > INT32_MAX ||
+		header.instanceSetCount > INT32_MAX || header.geometryCount > INT32_MAX ||
+		header.materialCount > INT32_MAX || header.instanceCount > INT32_MAX) {
+		cerr << path << ": array out of bounds" << endl;
+		return false;
+	}
+
+	camera = header.camera;
+	spheres = (const SphereEntry*)(base + header.sphereOffset);
+	planes = (const PlaneEntry*)(base + header.planeOffset);
+	lights = (const LightEntry*)(base + header.lightOffset);
+	sdfs = (const SDFEntry*)(base + header.sdfOffset);
+	shapes = (const ShapeEntry*)(base + header.shapeOffset);
+	meshes = (const MeshEntry*)(base + header.meshOffset);
+	instanceSets = (const InstanceSetEntry*)(base + header.instanceSetOffset);
+	geometries = (const GeometryEntry*)(base + header.geometryOffset);
+	materials = (const MaterialEntry*)(base + header.materialOffset);
+	instances = (const InstanceEntry*)(base + header.instanceOffset);
+	strings = base + header.stringOffset;
+	sphereCount = header.sphereCount;
+	planeCount = header.planeCount;
+	lightCount = header.lightCount;
+	sdfCount = header.sdfCount;
+	shapeCount = header.shapeCount;
+	meshCount = header.meshCount;
+	instanceSetCount = header.instanceSetCount;
+	geometryCount = header.geometryCount;
+	materialCount = header.materialCount;
+	instanceCount = header.instanceCount;
+	stringBytes = header.stringBytes;
+
+	//texture and mesh file offsets must name a terminated string in the
+	//table
+	auto isString = [&](uint32_t offset) { return offset < stringBytes && memchr(strings + offset, 0, stringBytes - offset); };
+	for (int i = 0; i < planeCount; i++) {
+		for (uint32_t offset : { planes[i].texture, planes[i].specularTexture }) {
+			if (offset != noTexture && !isString(offset)) {
+				cerr << path << ": plane " << i << " has a bad texture name" << endl;
+				return false;
+			}
+		}
+	}
+	for (int i = 0; i < meshCount; i++) {
+		if (!isString(meshes[i].file)) {
+			cerr << path << ": mesh " << i << " has a bad file name" << endl;
+			return false;
+		}
+	}
+	for (int i = 0; i < geometryCount; i++) {
+		if (!isString(geometries[i].file)) {
+			cerr << path << ": geometry " << i << " has a bad file name" << endl;
+			return false;
+		}
+	}
+	for (int i = 0; i < instanceSetCount; i++) {
+		const InstanceSetEntry& e = instanceSets[i];
+		if ((uint64_t)e.firstGeometry + e.geometryCount > (uint64_t)geometryCount ||
+			(uint64_t)e.firstMaterial + e.materialCount > (uint64_t)materialCount ||
+			(uint64_t)e.firstInstance + e.instanceCount > (uint64_t)instanceCount) {
+			cerr << path << ": instance set " << i << " has entries out of bounds" << endl;
+			return false;
+		}
+		for (uint32_t k = e.firstInstance; k < e.firstInstance + e.instanceCount; k++) {
+			if (instances[k].geometry >= e.geometryCount) {
+				cerr << path << ": instance " << k << " has geometry " << instances[k].geometry << " of " << e.geometryCount << endl;
+				return false;
+			}
+			if (!(instances[k].scale > 0)) {
+				cerr << path << ": instance " << k << " has scale " << instances[k].scale << endl;
+				return false;
+			}
+		}
+	}
+	for (int i = 0; i < lightCount; i++) {
+		if (lights[i].type > LIGHT_AREA) {
+			cerr << path << ": light " << i << " has unknown type " << lights[i].type << endl;
+			return false;
+		}
+	}
+	for (int i = 0; i < sdfCount; i++) {
+		if ((uint64_t)sdfs[i].firstShape + sdfs[i].shapeCount > (uint64_t)shapeCount) {
+			cerr << path << ": SDF object " << i << " has shapes out of bounds" << endl;
+			return false;
+		}
+	}
+	for (int i = 0; i < shapeCount; i++) {
+		if (shapes[i].shape > SDF_TORUS) {
+			cerr << path << ": shape " << i << " has unknown type " << shapes[i].shape << endl;
+			return false;
+		}
+		if (!(shapes[i].scale > 0)) {
+			cerr << path << ": shape " << i << " has scale " << shapes[i].scale << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+//  Splits a line into whitespace separated words and reads numbers from
+//  them, remembering the first error.
+//
+namespace {
+class LineReader {
+public:
+	LineReader(const char* begin, const char* end) : cursor(begin), end(end) {}
+
+	bool word(string& out) {
+		while (cursor < end && isspace((unsigned char)*cursor)) cursor++;
+		if (cursor == end) return false;
+		const char* start = cursor;
+		while (cursor < end && !isspace((unsigned char)*cursor)) cursor++;
+		out.assign(start, cursor);
+		return true;
+	}
+
+	bool numbers(float* out, int count) {
+		string text;
+		for (int i = 0; i < count; i++) {
+			char* stop;
+			if (!word(text)) return fail("expected " + to_string(count) + " numbers");
+			out[i] = strtof(text.c_str(), &stop);
+			if (*stop != 0) return fail("'" + text + "' is not a number");
+		}
+		return true;
+	}
+
+	bool color(uint8_t* out) {
+		float c[3];
+		if (!numbers(c, 3)) return false;
+		for (int i = 0; i < 3; i++) out[i] = (uint8_t)ofClamp(c[i], 0.f, 255.f);
+		out[3] = 255;
+		return true;
+	}
+
+	bool fail(const string& why) {
+		if (error.empty()) error = why;
+		return false;
+	}
+
+	string error;
+
+private:
+	const char* cursor;
+	const char* end;
+};
+}
+
+//--------------------------------------------------------------
+//parses the text form a line at a time
+//
+bool SceneFile::loadText(const string& path) {
+	ifstream in(path, ios::binary);
+	string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+	toCameraEntry(RenderCam(), camera);
+
+	int lineNumber = 0;
+	size_t lineStart = 0;
+	while (lineStart < text.size()) {
+		size_t lineEnd = text.find('\n', lineStart);
+		if (lineEnd == string::npos) lineEnd = text.size();
+		const char* begin = text.data() + lineStart;
+		const char* comment = (const char*)memchr(begin, '#', lineEnd - lineStart);
+		LineReader line(begin, comment ? comment : text.data() + lineEnd);
+		lineStart = lineEnd + 1;
+		lineNumber++;
+
+		string kind, key;
+		if (!line.word(kind)) continue;
+
+		if (kind == "camera") {
+			while (line.word(key)) {
+				if (key == "position") line.numbers(camera.position, 3);
+				else if (key == "aim") line.numbers(camera.aim, 3);
+				else if (key == "up") line.numbers(camera.up, 3);
+				else if (key == "view") {
+					line.numbers(camera.viewPosition, 3) && line.numbers(camera.viewMin, 2) && line.numbers(camera.viewMax, 2);
+				}
+				else line.fail("unknown camera key '" + key + "'");
+				if (!line.error.empty()) break;
+			}
+		}
+		else if (kind == "sphere") {
+			SphereEntry s = { { 0, 0, 0 }, .5f, { 211, 211, 211, 255 }, { 211, 211, 211, 255 }, 0, 0, 1.5f };
+			while (line.word(key)) {
+				if (key == "position") line.numbers(s.position, 3);
+				else if (key == "radius") line.numbers(&s.radius, 1);
+				else if (key == "diffuse") line.color(s.diffuse);
+				else if (key == "specular") line.color(s.specular);
+				else if (key == "reflectivity") line.numbers(&s.reflectivity, 1);
+				else if (key == "transparency") line.numbers(&s.transparency, 1);
+				else if (key == "ior") line.numbers(&s.ior, 1);
+				else line.fail("unknown sphere key '" + key + "'");
+				if (!line.error.empty()) break;
+			}
+			sphereData.push_back(s);
+		}
+		else if (kind == "plane") {
+			PlaneEntry p = { { 0, 0, 0 }, { 0, 1, 0 }, 20, 20, { 128, 128, 128, 255 }, { 211, 211, 211, 255 }, 0, 0, 1.5f, noTexture, noTexture };
+			string name;
+			while (line.word(key)) {
+				if (key == "position") line.numbers(p.position, 3);
+				else if (key == "normal") line.numbers(p.normal, 3);
+				else if (key == "size") line.numbers(&p.width, 2);
+				else if (key == "diffuse") line.color(p.diffuse);
+				else if (key == "specular") line.color(p.specular);
+				else if (key == "reflectivity") line.numbers(&p.reflectivity, 1);
+				else if (key == "transparency") line.numbers(&p.transparency, 1);
+				else if (key == "ior") line.numbers(&p.ior, 1);
+				else if (key == "texture") {
+					if (line.word(name)) p.texture = addString(name);
+					else line.fail("expected a texture path");
+				}
+				else if (key == "specular-texture") {
+					if (line.word(name)) p.specularTexture = addString(name);
+					else line.fail("expected a texture path");
+				}
+				else line.fail("unknown plane key '" + key + "'");
+				if (!line.error.empty()) break;
+			}
+			planeData.push_back(p);
+		}
+		else if (kind == "sdf") {
+			SDFEntry e = { { 0, 0, 0 }, { 211, 211, 211, 255 }, { 211, 211, 211, 255 }, 0, 0, 1.5f, (uint32_t)shapeData.size(), 0 };
+			while (line.word(key)) {
+				if (key == "position") line.numbers(e.position, 3);
+				else if (key == "diffuse") line.color(e.diffuse);
+				else if (key == "specular") line.color(e.specular);
+				else if (key == "reflectivity") line.numbers(&e.reflectivity, 1);
+				else if (key == "transparency") line.numbers(&e.transparency, 1);
+				else if (key == "ior") line.numbers(&e.ior, 1);
+				else line.fail("unknown sdf key '" + key + "'");
+				if (!line.error.empty()) break;
+			}
+			sdfData.push_back(e);
+		}
+		else if (kind == "shape") {
+			ShapeEntry s = { SDF_SPHERE, { .5f, .5f, .5f }, { 0, 0, 0 }, { 0, 0, 0 }, 1, 0 };
+			string type;
+			if (sdfData.empty()) line.fail("shape before any sdf");
+			else if (!line.word(type)) line.fail("expected sphere, box, plane or torus");
+			else if (type == "sphere") s.shape = SDF_SPHERE;
+			else if (type == "box") s.shape = SDF_BOX;
+			else if (type == "plane") s.shape = SDF_PLANE;
+			else if (type == "torus") s.shape = SDF_TORUS;
+			else line.fail("unknown shape '" + type + "'");
+			while (line.error.empty() && line.word(key)) {
+				if (key == "radius") line.numbers(s.size, 1);
+				else if (key == "size") line.numbers(s.size, 3);
+				else if (key == "radii") line.numbers(s.size, 2);
+				else if (key == "position") line.numbers(s.position, 3);
+				else if (key == "rotation") line.numbers(s.rotation, 3);
+				else if (key == "scale") line.numbers(&s.scale, 1);
+				else if (key == "blend") line.numbers(&s.blend, 1);
+				else line.fail("unknown shape key '" + key + "'");
+			}
+			if (line.error.empty() && !(s.scale > 0)) line.fail("scale must be positive");
+			shapeData.push_back(s);
+			sdfData.back().shapeCount++;
+		}
+		else if (kind == "mesh") {
+			MeshEntry m = { { 0, 0, 0 }, { 211, 211, 211, 255 }, { 211, 211, 211, 255 }, 0, 0, 1.5f, noTexture };
+			string name;
+			while (line.word(key)) {
+				if (key == "position") line.numbers(m.position, 3);
+				else if (key == "file") {
+					if (line.word(name)) m.file = addString(name);
+					else line.fail("expected a mesh path");
+				}
+				else if (key == "diffuse") line.color(m.diffuse);
+				else if (key == "specular") line.color(m.specular);
+				else if (key == "reflectivity") line.numbers(&m.reflectivity, 1);
+				else if (key == "transparency") line.numbers(&m.transparency, 1);
+				else if (key == "ior") line.numbers(&m.ior, 1);
+				else line.fail("unknown mesh key '" + key + "'");
+				if (!line.error.empty()) break;
+			}
+			if (line.error.empty() && m.file == noTexture) line.fail("mesh without a file");
+			meshData.push_back(m);
+		}
+		else if (kind == "instances") {
+			InstanceSetEntry e = { { 0, 0, 0 }, (uint32_t)geometryData.size(), 0, (uint32_t)materialData.size(), 0, (uint32_t)instanceData.size(), 0, 0 };
+			while (line.word(key)) {
+				if (key == "position") line.numbers(e.position, 3);
+				else line.fail("unknown instances key '" + key + "'");
+				if (!line.error.empty()) break;
+			}
+			instanceSetData.push_back(e);
+		}
+		else if (kind == "geometry") {
+			GeometryEntry g = { noTexture };
+			string name;
+			if (instanceSetData.empty()) line.fail("geometry before any instances");
+			while (line.error.empty() && line.word(key)) {
+				if (key == "file") {
+					if (line.word(name)) g.file = addString(name);
+					else line.fail("expected a mesh path");
+				}
+				else line.fail("unknown geometry key '" + key + "'");
+			}
+			if (line.error.empty() && g.file == noTexture) line.fail("geometry without a file");
+			if (line.error.empty()) {
+				geometryData.push_back(g);
+				instanceSetData.back().geometryCount++;
+			}
+		}
+		else if (kind == "material") {
+			MaterialEntry m = { { 211, 211, 211, 255 }, { 211, 211, 211, 255 }, 0, 0, 1.5f };
+			if (instanceSetData.empty()) line.fail("material before any instances");
+			while (line.error.empty() && line.word(key)) {
+				if (key == "diffuse") line.color(m.diffuse);
+				else if (key == "specular") line.color(m.specular);
+				else if (key == "reflectivity") line.numbers(&m.reflectivity, 1);
+				else if (key == "transparency") line.numbers(&m.transparency, 1);
+				else if (key == "ior") line.numbers(&m.ior, 1);
+				else line.fail("unknown material key '" + key + "'");
+			}
+			if (line.error.empty()) {
+				materialData.push_back(m);
+				instanceSetData.back().materialCount++;
+			}
+		}
+		else if (kind == "instance") {
+			InstanceEntry e = { { 0, 0, 0 }, { 0, 0, 0 }, 1, 0, 0 };
+			if (instanceSetData.empty()) line.fail("instance before any instances");
+			while (line.error.empty() && line.word(key)) {
+				if (key == "position") line.numbers(e.position, 3);
+				else if (key == "rotation") line.numbers(e.rotation, 3);
+				else if (key == "scale") line.numbers(&e.scale, 1);
+				else if (key == "geometry" || key == "material") {
+					float number = 0;
+					if (line.numbers(&number, 1) && !(number >= 0 && number < 4294967296.0f && number == std::floor(number))) line.fail(key + " must be a whole number");
+					(key == "geometry" ? e.geometry : e.material) = (uint32_t)number;
+				}
+				else line.fail("unknown instance key '" + key + "'");
+			}
+			if (line.error.empty() && !(e.scale > 0)) line.fail("scale must be positive");
+			if (line.error.empty() && e.geometry >= instanceSetData.back().geometryCount) line.fail("instance of geometry " + to_string(e.geometry) + " before its geometry line");
+			if (line.error.empty()) {
+				instanceData.push_back(e);
+				instanceSetData.back().instanceCount++;
+			}
+		}
+		else if (kind == "light") {
+			LightEntry l = { { 1, 1, 1 }, { 3, -2, 0 }, .2f, 100, 10, 5, LIGHT_POINT, 0 };
+			string type;
+			if (!line.word(type)) line.fail("expected point, spot or area");
+			else if (type == "point") l.type = LIGHT_POINT;
+			else if (type == "spot") l.type = LIGHT_SPOT;
+			else if (type == "area") l.type = LIGHT_AREA;
+			else line.fail("unknown light type '" + type + "'");
+			while (line.error.empty() && line.word(key)) {
+				if (key == "position") line.numbers(l.position, 3);
+				else if (key == "aim") line.numbers(l.aimPoint, 3);
+				else if (key == "intensity") line.numbers(&l.intensity, 1);
+				else if (key == "power") line.numbers(&l.power, 1);
+				else if (key == "angle") line.numbers(&l.coneAngleDeg, 1);
+				else if (key == "width") line.numbers(&l.width, 1);
+				else line.fail("unknown light key '" + key + "'");
+			}
+			lightData.push_back(l);
+		}
+		else line.fail("unknown object '" + kind + "'");
+
+		if (!line.error.empty()) {
+			cerr << path << ":" << lineNumber << ": " << line.error << endl;
+			return false;
+		}
+	}
+
+	spheres = sphereData.data();
+	planes = planeData.data();
+	lights = lightData.data();
+	sdfs = sdfData.data();
+	shapes = shapeData.data();
+	meshes = meshData.data();
+	instanceSets = instanceSetData.data();
+	geometries = geometryData.data();
+	materials = materialData.data();
+	instances = instanceData.data();
+	strings = stringData.data();
+	sphereCount = (int)sphereData.size();
+	planeCount = (int)planeData.size();
+	lightCount = (int)lightData.size();
+	sdfCount = (int)sdfData.size();
+	shapeCount = (int)shapeData.size();
+	meshCount = (int)meshData.size();
+	instanceSetCount = (int)instanceSetData.size();
+	geometryCount = (int)geometryData.size();
+	materialCount = (int)materialData.size();
+	instanceCount = (int)instanceData.size();
+	stringBytes = (uint32_t)stringData.size();
+	return true;
+}
+
+//--------------------------------------------------------------
+bool SceneFile::saveText(const string& path) const {
+	ofstream out(path);
+	if (!out) {
+		cerr << path << ": cannot write" << endl;
+		return false;
+	}
+	out << setprecision(9);
+	auto vec = [&](const float* f, int n) { for (int i = 0; i < n; i++) out << " " << f[i]; };
+	auto color = [&](const uint8_t* c) { out << " " << (int)c[0] << " " << (int)c[1] << " " << (int)c[2]; };
+	auto glass = [&](float reflectivity, float transparency, float ior) {
+		if (reflectivity == 0 && transparency == 0) return;
+		out << " reflectivity " << reflectivity << " transparency " << transparency << " ior " << ior;
+	};
+
+	out << "camera position"; vec(camera.position, 3);
+	out << " aim"; vec(camera.aim, 3);
+	out << " up"; vec(camera.up, 3);
+	out << " view"; vec(camera.viewPosition, 3); vec(camera.viewMin, 2); vec(camera.viewMax, 2);
+	out << "\n";
+
+	for (int i = 0; i < planeCount; i++) {
+		const PlaneEntry& p = planes[i];
+		out << "plane position"; vec(p.position, 3);
+		out << " normal"; vec(p.normal, 3);
+		out << " size " << p.width << " " << p.height;
+		out << " diffuse"; color(p.diffuse);
+		out << " specular"; color(p.specular);
+		glass(p.reflectivity, p.transparency, p.ior);
+		if (p.texture != noTexture) out << " texture " << textureName(p.texture);
+		if (p.specularTexture != noTexture) out << " specular-texture " << textureName(p.specularTexture);
+		out << "\n";
+	}
+	for (int i = 0; i < sphereCount; i++) {
+		const SphereEntry& s = spheres[i];
+		out << "sphere position"; vec(s.position, 3);
+		out << " radius " << s.radius;
+		out << " diffuse"; color(s.diffuse);
+		out << " specular"; color(s.specular);
+		glass(s.reflectivity, s.transparency, s.ior);
+		out << "\n";
+	}
+	for (int i = 0; i < sdfCount; i++) {
+		const SDFEntry& e = sdfs[i];
+		out << "sdf position"; vec(e.position, 3);
+		out << " diffuse"; color(e.diffuse);
+		out << " specular"; color(e.specular);
+		glass(e.reflectivity, e.transparency, e.ior);
+		out << "\n";
+		for (uint32_t k = e.firstShape; k < e.firstShape + e.shapeCount; k++) {
+			const ShapeEntry& s = shapes[k];
+			out << "shape " << shapeNames[s.shape];
+			if (s.shape == SDF_SPHERE) out << " radius " << s.size[0];
+			else if (s.shape == SDF_BOX) { out << " size"; vec(s.size, 3); }
+			else if (s.shape == SDF_TORUS) out << " radii " << s.size[0] << " " << s.size[1];
+			out << " position"; vec(s.position, 3);
+			out << " rotation"; vec(s.rotation, 3);
+			out << " scale " << s.scale << " blend " << s.blend;
+			out << "\n";
+		}
+	}
+	for (int i = 0; i < meshCount; i++) {
+		const MeshEntry& m = meshes[i];
+		out << "mesh position"; vec(m.position, 3);
+		out << " file " << textureName(m.file);
+		out << " diffuse"; color(m.diffuse);
+		out << " specular"; color(m.specular);
+		glass(m.reflectivity, m.transparency, m.ior);
+		out << "\n";
+	}
+	for (int i = 0; i < instanceSetCount; i++) {
+		const InstanceSetEntry& e = instanceSets[i];
+		out << "instances position"; vec(e.position, 3);
+		out << "\n";
+		for (uint32_t k = e.firstGeometry; k < e.firstGeometry + e.geometryCount; k++) {
+			out << "geometry file " << textureName(geometries[k].file) << "\n";
+		}
+		for (uint32_t k = e.firstMaterial; k < e.firstMaterial + e.materialCount; k++) {
+			const MaterialEntry& m = materials[k];
+			out << "material diffuse"; color(m.diffuse);
+			out << " specular"; color(m.specular);
+			glass(m.reflectivity, m.transparency, m.ior);
+			out << "\n";
+		}
+		for (uint32_t k = e.firstInstance; k < e.firstInstance + e.instanceCount; k++) {
+			const InstanceEntry& instance = instances[k];
+			out << "instance position"; vec(instance.position, 3);
+			out << " rotation"; vec(instance.rotation, 3);
+			out << " scale " << instance.scale << " geometry " << instance.geometry << " material " << instance.material;
+			out << "\n";
+		}
+	}
+	for (int i = 0; i < lightCount; i++) {
+		const LightEntry& l = lights[i];
+		out << "light " << lightTypeNames[l.type] << " position"; vec(l.position, 3);
+		out << " aim"; vec(l.aimPoint, 3);
+		out << " intensity " << l.intensity << " power " << l.power;
+		out << " angle " << l.coneAngleDeg << " width " << l.width;
+		out << "\n";
+	}
+	return (bool)out;
+}
+
+//--------------------------------------------------------------
+bool SceneFile::saveBinary(const string& path) const {
+	ofstream out(path, ios::binary);
+	if (!out) {
+		cerr << path << ": cannot write" << endl;
+		return false;
+	}
+	BinaryHeader header = {};
+	memcpy(header.magic, binaryMagic, sizeof(binaryMagic));
+	header.version = binaryVersion;
+	header.byteOrder = byteOrderMark;
+	header.sphereCount = sphereCount;
+	header.planeCount = planeCount;
+	header.lightCount = lightCount;
+	header.stringBytes = stringBytes;
+	header.sdfCount = sdfCount;
+	header.shapeCount = shapeCount;
+	header.meshCount = meshCount;
+	header.instanceSetCount = instanceSetCount;
+	header.geometryCount = geometryCount;
+	header.materialCount = materialCount;
+	header.instanceCount = instanceCount;
+	header.camera = camera;
+	header.sphereOffset = alignUp(sizeof(BinaryHeader));
+	header.planeOffset = alignUp(header.sphereOffset + sphereCount * sizeof(SphereEntry));
+	header.lightOffset = alignUp(header.planeOffset + planeCount * sizeof(PlaneEntry));
+	header.sdfOffset = alignUp(header.lightOffset + lightCount * sizeof(LightEntry));
+	header.shapeOffset = alignUp(header.sdfOffset + sdfCount * sizeof(SDFEntry));
+	header.meshOffset = alignUp(header.shapeOffset + shapeCount * sizeof(ShapeEntry));
+	header.instanceSetOffset = alignUp(header.meshOffset + meshCount * sizeof(MeshEntry));
+	header.geometryOffset = alignUp(header.instanceSetOffset + instanceSetCount * sizeof(InstanceSetEntry));
+	header.materialOffset = alignUp(header.geometryOffset + geometryCount * sizeof(GeometryEntry));
+	header.instanceOffset = alignUp(header.materialOffset + materialCount * sizeof(MaterialEntry));
+	header.stringOffset = alignUp(header.instanceOffset + (uint64_t)instanceCount * sizeof(InstanceEntry));
+
+	uint64_t written = 0;
+	auto write = [&](uint64_t offset, const void* data, uint64_t bytes) {
+		static const char zeros[16] = {};
+		out.write(zeros, offset - written);
+		out.write((const char*)data, bytes);
+		written = offset + bytes;
+	};
+	write(0, &header, sizeof(header));
+	write(header.sphereOffset, spheres, sphereCount * sizeof(SphereEntry));
+	write(header.planeOffset, planes, planeCount * sizeof(PlaneEntry));
+	write(header.lightOffset, lights, lightCount * sizeof(LightEntry));
+	write(header.sdfOffset, sdfs, sdfCount * sizeof(SDFEntry));
+	write(header.shapeOffset, shapes, shapeCount * sizeof(ShapeEntry));
+	write(header.meshOffset, meshes, meshCount * sizeof(MeshEntry));
+	write(header.instanceSetOffset, instanceSets, instanceSetCount * sizeof(InstanceSetEntry));
+	write(header.geometryOffset, geometries, geometryCount * sizeof(GeometryEntry));
+	write(header.materialOffset, materials, materialCount * sizeof(MaterialEntry));
+	write(header.instanceOffset, instances, (uint64_t)instanceCount * sizeof(InstanceEntry));
+	write(header.stringOffset, strings, stringBytes);
+	return (bool)out;
+}
+
+//--------------------------------------------------------------
+const char* SceneFile::textureName(uint32_t offset) const {
+	return offset == noTexture ? "" : strings + offset;
+}
+
+//--------------------------------------------------------------
+//appends a path to the string table, returning its offset
+//
+uint32_t SceneFile::addString(const string& text) {
+	uint32_t offset = (uint32_t)stringData.size();
+	stringData.insert(stringData.end(), text.begin(), text.end());
+	stringData.push_back(0);
+	return offset;
+}
+
+//--------------------------------------------------------------
+//copies the live scene into owned entries; objects of other kinds, and
+//meshes and instance sets with geometry that was not loaded from a file,
+//are skipped
+//
+void SceneFile::capture(const vector<SceneObject*>& scene, const vector<Light*>& light, const RenderCam& cam) {
+	clear();
+	toCameraEntry(cam, camera);
+
+	for (SceneObject* object : scene) {
+		if (object->type == OBJECT_PLANE) {
+			Plane* plane = static_cast<Plane*>(object);
+			PlaneEntry p;
+			toFloats(plane->position, p.position);
+			toFloats(plane->normal, p.normal);
+			p.width = plane->width;
+			p.height = plane->height;
+			toBytes(plane->diffuseColor, p.diffuse);
+			toBytes(plane->specularColor, p.specular);
+			p.reflectivity = plane->reflectivity;
+			p.transparency = plane->transparency;
+			p.ior = plane->ior;
+			p.texture = plane->texturePath.empty() ? noTexture : addString(plane->texturePath);
+			p.specularTexture = plane->specularTexturePath.empty() ? noTexture : addString(plane->specularTexturePath);
+			planeData.push_back(p);
+		}
+		else if (object->type == OBJECT_SPHERE) {
+			Sphere* sphere = static_cast<Sphere*>(object);
+			SphereEntry s;
+			toFloats(sphere->position, s.position);
+			s.radius = sphere->radius;
+			toBytes(sphere->diffuseColor, s.diffuse);
+			toBytes(sphere->specularColor, s.specular);
+			s.reflectivity = sphere->reflectivity;
+			s.transparency = sphere->transparency;
+			s.ior = sphere->ior;
+			sphereData.push_back(s);
+		}
+		else if (object->type == OBJECT_SDF) {
+			SDFObject* sdf = static_cast<SDFObject*>(object);
+			SDFEntry e;
+			toFloats(sdf->position, e.position);
+			toBytes(sdf->diffuseColor, e.diffuse);
+			toBytes(sdf->specularColor, e.specular);
+			e.reflectivity = sdf->reflectivity;
+			e.transparency = sdf->transparency;
+			e.ior = sdf->ior;
+			e.firstShape = shapeData.size();
+			e.shapeCount = sdf->primitives.size();
+			sdfData.push_back(e);
+			for (const SDFPrimitive& primitive : sdf->primitives) {
+				ShapeEntry s;
+				s.shape = primitive.shape;
+				toFloats(primitive.size, s.size);
+				toFloats(primitive.position, s.position);
+				toFloats(primitive.rotation, s.rotation);
+				s.scale = primitive.scale;
+				s.blend = primitive.blend;
+				shapeData.push_back(s);
+			}
+		}
+		else if (object->type == OBJECT_MESH && !static_cast<MeshObject*>(object)->path.empty()) {
+			MeshObject* mesh = static_cast<MeshObject*>(object);
+			MeshEntry m;
+			toFloats(mesh->position, m.position);
+			toBytes(mesh->diffuseColor, m.diffuse);
+			toBytes(mesh->specularColor, m.specular);
+			m.reflectivity = mesh->reflectivity;
+			m.transparency = mesh->transparency;
+			m.ior = mesh->ior;
+			m.file = addString(mesh->path);
+			meshData.push_back(m);
+		}
+		else if (object->type == OBJECT_INSTANCES) {
+			InstanceSet* set = static_cast<InstanceSet*>(object);
+			if (std::find(set->geometryPaths.begin(), set->geometryPaths.end(), "") != set->geometryPaths.end()) continue;
+			InstanceSetEntry e = { {}, (uint32_t)geometryData.size(), (uint32_t)set->geometries.size(),
+				(uint32_t)materialData.size(), (uint32_t)set->materials.size(), (uint32_t)instanceData.size(), (uint32_t)set->instances.size(), 0 };
+			toFloats(set->position, e.position);
+			instanceSetData.push_back(e);
+			for (const string& path : set->geometryPaths) geometryData.push_back(GeometryEntry{ addString(path) });
+			for (const InstanceMaterial& material : set->materials) {
+				MaterialEntry m;
+				toBytes(material.diffuse, m.diffuse);
+				toBytes(material.specular, m.specular);
+				m.reflectivity = material.reflectivity;
+				m.transparency = material.transparency;
+				m.ior = material.ior;
+				materialData.push_back(m);
+			}
+			instanceData.reserve(instanceData.size() + set->instances.size());
+			for (const Instance& instance : set->instances) {
+				InstanceEntry i;
+				toFloats(instance.position, i.position);
+				toFloats(instance.rotation, i.rotation);
+				i.scale = instance.scale;
+				i.geometry = instance.geometry;
+				i.material = instance.material;
+				instanceData.push_back(i);
+			}
+		}
+	}
+	for (Light* l : light) {
+		LightRecord record = l->getRecord();
+		LightEntry e;
+		toFloats(l->position, e.position);
+		toFloats(l->aimPoint, e.aimPoint);
+		e.intensity = l->intensity;
+		e.power = l->power;
+		e.coneAngleDeg = l->coneAngleDeg;
+		e.width = l->Width;
+		e.type = record.type;
+		e.reserved = 0;
+		lightData.push_back(e);
+	}
+
+	spheres = sphereData.data();
+	planes = planeData.data();
+	lights = lightData.data();
+	sdfs = sdfData.data();
+	shapes = shapeData.data();
+	meshes = meshData.data();
+	instanceSets = instanceSetData.data();
+	geometries = geometryData.data();
+	materials = materialData.data();
+	instances = instanceData.data();
+	strings = stringData.data();
+	sphereCount = (int)sphereData.size();
+	planeCount = (int)planeData.size();
+	lightCount = (int)lightData.size();
+	sdfCount = (int)sdfData.size();
+	shapeCount = (int)shapeData.size();
+	meshCount = (int)meshData.size();
+	instanceSetCount = (int)instanceSetData.size();
+	geometryCount = (int)geometryData.size();
+	materialCount = (int)materialData.size();
+	instanceCount = (int)instanceData.size();
+	stringBytes = (uint32_t)stringData.size();
+}
+
+//--------------------------------------------------------------
+//builds the objects; planes first, then spheres, SDF objects, meshes
+//and instance sets, in file order
+//each mesh file is loaded once however many objects and geometries name
+//it; meshes whose file does not load are left out, and so are the
+//instances of such a geometry
+//
+void SceneFile::instantiate(SceneStore& store, RenderCam& cam, float aimPointRadius) {
+	store.clear();
+
+	//the view plane is kept as a point, its distance along the view
+	//direction is what the camera needs
+	cam.position = toVec3(camera.position);
+	cam.aim = toVec3(camera.aim);
+	glm::vec3 up = toVec3(camera.up);
+	cam.up = up == glm::vec3(0) ? glm::vec3(0, 1, 0) : up;
+	cam.updateBasis();
+	float distance = glm::dot(toVec3(camera.viewPosition) - cam.position, cam.forward);
+	cam.viewDistance = distance > 0 ? distance : RenderCam().viewDistance;
+	cam.view.setSize(glm::vec2(camera.viewMin[0], camera.viewMin[1]), glm::vec2(camera.viewMax[0], camera.viewMax[1]));
+	cam.updateBasis();
+
+	for (int i = 0; i < planeCount; i++) {
+		const PlaneEntry& p = planes[i];
+		Plane* plane = store.addPlane(toVec3(p.position), toVec3(p.normal), toColor(p.diffuse), p.width, p.height);
+		plane->specularColor = toColor(p.specular);
+		plane->reflectivity = p.reflectivity;
+		plane->transparency = p.transparency;
+		plane->ior = p.ior;
+		plane->loadTextures(textureName(p.texture), textureName(p.specularTexture));
+	}
+
+	store.reserveSpheres(sphereCount);
+	for (int i = 0; i < sphereCount; i++) {
+		const SphereEntry& s = spheres[i];
+		Sphere* sphere = store.addSphere(toVec3(s.position), s.radius, toColor(s.diffuse));
+		sphere->specularColor = toColor(s.specular);
+		sphere->reflectivity = s.reflectivity;
+		sphere->transparency = s.transparency;
+		sphere->ior = s.ior;
+	}
+
+	for (int i = 0; i < sdfCount; i++) {
+		const SDFEntry& e = sdfs[i];
+		SDFObject* sdf = store.addSDF(toVec3(e.position), toColor(e.diffuse));
+		sdf->specularColor = toColor(e.specular);
+		sdf->reflectivity = e.reflectivity;
+		sdf->transparency = e.transparency;
+		sdf->ior = e.ior;
+		for (uint32_t k = e.firstShape; k < e.firstShape + e.shapeCount; k++) {
+			const ShapeEntry& s = shapes[k];
+			SDFPrimitive primitive;
+			primitive.shape = (SDFShape)s.shape;
+			primitive.size = toVec3(s.size);
+			primitive.position = toVec3(s.position);
+			primitive.rotation = toVec3(s.rotation);
+			primitive.scale = s.scale;
+			primitive.blend = s.blend;
+			sdf->add(primitive);
+		}
+	}
+
+	std::map<string, std::shared_ptr<const TriangleMesh>> loaded;
+	auto load = [&](const string& file) {
+		auto found = loaded.find(file);
+		if (found == loaded.end()) {
+			std::shared_ptr<TriangleMesh> mesh = std::make_shared<TriangleMesh>();
+			if (!loadMesh(ofToDataPath(file), *mesh)) mesh = nullptr;
+			found = loaded.emplace(file, mesh).first;
+		}
+		return found->second;
+	};
+	for (int i = 0; i < meshCount; i++) {
+		const MeshEntry& m = meshes[i];
+		string file = textureName(m.file);
+		std::shared_ptr<const TriangleMesh> mesh = load(file);
+		if (!mesh) continue;
+		MeshObject* object = store.addMesh(toVec3(m.position), mesh, toColor(m.diffuse));
+		object->path = file;
+		object->specularColor = toColor(m.specular);
+		object->reflectivity = m.reflectivity;
+		object->transparency = m.transparency;
+		object->ior = m.ior;
+	}
+
+	for (int i = 0; i < instanceSetCount; i++) {
+		const InstanceSetEntry& e = instanceSets[i];
+		InstanceSet* set = store.addInstanceSet(toVec3(e.position));
+		vector<int> geometry(e.geometryCount, -1);			// the set's number for each file geometry
+		for (uint32_t k = 0; k < e.geometryCount; k++) {
+			string file = textureName(geometries[e.firstGeometry + k].file);
+			std::shared_ptr<const TriangleMesh> mesh = load(file);
+			if (mesh) geometry[k] = set->addGeometry(mesh, file);
+		}
+		for (uint32_t k = e.firstMaterial; k < e.firstMaterial + e.materialCount; k++) {
+			const MaterialEntry& m = materials[k];
+			set->addMaterial(InstanceMaterial{ toColor(m.diffuse), toColor(m.specular), m.reflectivity, m.transparency, m.ior });
+		}
+		set->instances.reserve(e.instanceCount);
+		for (uint32_t k = e.firstInstance; k < e.firstInstance + e.instanceCount; k++) {
+			const InstanceEntry& entry = instances[k];
+			if (geometry[entry.geometry] < 0) continue;
+			Instance instance;
+			instance.position = toVec3(entry.position);
+			instance.rotation = toVec3(entry.rotation);
+			instance.scale = entry.scale;
+			instance.geometry = geometry[entry.geometry];
+			instance.material = entry.material;
+			set->add(instance);
+		}
+		set->build();
+	}
+
+	for (int i = 0; i < lightCount; i++) {
+		const LightEntry& l = lights[i];
+		Light* newLight = store.addLight(toVec3(l.position), toVec3(l.aimPoint), l.intensity, l.coneAngleDeg, l.width, aimPointRadius);
+		newLight->power = l.power;
+		if (l.type == LIGHT_SPOT) newLight->setSpotLight();
+		else if (l.type == LIGHT_AREA) newLight->setAreaLight();
+	}
+}
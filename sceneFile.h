@@ -0,0 +1,225 @@
+#pragma once
+
+#include "sceneStore.h"
+
+#include <cstdint>
+
+//  Scene description on disk: the render camera, every plane, sphere, SDF
+//  object, mesh and instance set with its material, texture paths,
+//  primitives, mesh files and instances, and every light with its type,
+//  aim point, cone angle and width.  Two forms hold the same data:
+//
+//  - text (.scene), one object per line, for writing by hand and diffing:
+//
+//      camera position 0 0 10 aim 0 0 -1 up 0 1 0 view 0 0 5 -3 -2 3 2
+//      plane position -1 -2 0 normal 0 1 0 size 12 10 diffuse 0 0 139 specular 211 211 211 texture bamboo.jpg
+//      sphere position 0 0 0 radius 0.5 diffuse 0 0 255 transparency 0.9 ior 1.5
+//      sdf position 0 0 -2 diffuse 255 128 0
+//      shape torus radii 1 0.25 rotation 90 0 0
+//      shape sphere radius 0.6 position 1 0 0 blend 0.3
+//      mesh position 0 -2 0 file bunny.ply diffuse 200 180 150
+//      instances position 0 -2 0
+//      geometry file tree.obj
+//      material diffuse 40 120 40
+//      instance position 3 0 -4 rotation 0 45 0 scale 1.2 geometry 0 material 0
+//      light spot position 10 5 5 aim 1 -2 0 intensity 0.2 power 100 angle 15 width 5
+//
+//    keys may come in any order and default to the values of a newly made
+//    object; '#' starts a comment; paths may not contain spaces.  shape
+//    lines add primitives (sphere, box, plane or torus, see SDFPrimitive)
+//    to the sdf line before them; a box takes its half extents as size.
+//    mesh lines name an OBJ or PLY file (see loadMesh); objects naming the
+//    same file share one copy of it.  geometry, material and instance
+//    lines add to the instances line before them (see InstanceSet); an
+//    instance numbers a geometry and a material of its set, counting from
+//    0, and the geometry must come first
+//
+//  - binary (.bscene), a header followed by flat arrays of the fixed size
+//    entries below and a string table for texture and mesh paths.  Loading maps the
+//    file and validates the header; the arrays are then used in place, so
+//    a million spheres cost one mapping and no parsing.
+//
+//  load() detects the form from the first bytes, save() picks it from the
+//  extension.
+//
+
+struct CameraEntry {
+	float position[3];
+	float aim[3];
+	float viewPosition[3];
+	float viewMin[2];
+	float viewMax[2];
+	float up[3];                    // all zero in files from before it was stored: (0, 1, 0)
+};
+
+struct SphereEntry {
+	float position[3];
+	float radius;
+	uint8_t diffuse[4];
+	uint8_t specular[4];
+	float reflectivity, transparency, ior;
+};
+
+struct PlaneEntry {
+	float position[3];
+	float normal[3];
+	float width, height;
+	uint8_t diffuse[4];
+	uint8_t specular[4];
+	float reflectivity, transparency, ior;
+	uint32_t texture;               // offset into the string table, noTexture if none
+	uint32_t specularTexture;
+};
+
+struct SDFEntry {
+	float position[3];
+	uint8_t diffuse[4];
+	uint8_t specular[4];
+	float reflectivity, transparency, ior;
+	uint32_t firstShape;            // its primitives in the shape array
+	uint32_t shapeCount;
+};
+
+struct ShapeEntry {
+	uint32_t shape;                 // SDFShape
+	float size[3];
+	float position[3];
+	float rotation[3];
+	float scale;
+	float blend;
+};
+
+struct MeshEntry {
+	float position[3];
+	uint8_t diffuse[4];
+	uint8_t specular[4];
+	float reflectivity, transparency, ior;
+	uint32_t file;                  // offset into the string table
+};
+
+struct InstanceSetEntry {
+	float position[3];
+	uint32_t firstGeometry;         // its entries in the geometry, material and instance arrays
+	uint32_t geometryCount;
+	uint32_t firstMaterial;
+	uint32_t materialCount;
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+	uint32_t reserved;
+};
+
+struct GeometryEntry {
+	uint32_t file;                  // offset into the string table
+};
+
+struct MaterialEntry {
+	uint8_t diffuse[4];
+	uint8_t specular[4];
+	float reflectivity, transparency, ior;
+};
+
+struct InstanceEntry {
+	float position[3];
+	float rotation[3];
+	float scale;
+	uint32_t geometry;              // numbered within its set
+	uint32_t material;
+};
+
+struct LightEntry {
+	float position[3];
+	float aimPoint[3];
+	float intensity;
+	float power;
+	float coneAngleDeg;
+	float width;
+	uint32_t type;                  // LightType
+	uint32_t reserved;
+};
+
+class SceneFile {
+public:
+	SceneFile() {}
+	~SceneFile();
+	SceneFile(const SceneFile&) = delete;
+	SceneFile& operator=(const SceneFile&) = delete;
+
+	//  reads a scene written in either form; false, with the reason on
+	//  cerr, if the file is missing or malformed
+	//
+	bool load(const string& path);
+	bool save(const string& path) const;
+
+	//  copies the live scene into this file's entries
+	//
+	void capture(const vector<SceneObject*>& scene, const vector<Light*>& light, const RenderCam& cam);
+
+	//  replaces the contents of the store with the loaded scene
+	//
+	void instantiate(SceneStore& store, RenderCam& cam, float aimPointRadius = .5);
+
+	static bool isBinaryPath(const string& path);
+
+	int getNumSpheres() const { return sphereCount; }
+	int getNumPlanes() const { return planeCount; }
+	int getNumSDFs() const { return sdfCount; }
+	int getNumMeshes() const { return meshCount; }
+	int getNumInstanceSets() const { return instanceSetCount; }
+	int getNumInstances() const { return instanceCount; }
+	int getNumLights() const { return lightCount; }
+
+	static const uint32_t noTexture = 0xffffffff;
+
+private:
+	bool loadText(const string& path);
+	bool loadBinary(const string& path);
+	bool saveText(const string& path) const;
+	bool saveBinary(const string& path) const;
+	void clear();
+	const char* textureName(uint32_t offset) const;
+	uint32_t addString(const string& text);
+
+	//  the entries in use: either the vectors below or views into the
+	//  mapped file
+	//
+	CameraEntry camera;
+	const SphereEntry* spheres = nullptr;
+	const PlaneEntry* planes = nullptr;
+	const LightEntry* lights = nullptr;
+	const SDFEntry* sdfs = nullptr;
+	const ShapeEntry* shapes = nullptr;
+	const MeshEntry* meshes = nullptr;
+	const InstanceSetEntry* instanceSets = nullptr;
+	const GeometryEntry* geometries = nullptr;
+	const MaterialEntry* materials = nullptr;
+	const InstanceEntry* instances = nullptr;
+	const char* strings = nullptr;
+	int sphereCount = 0;
+	int planeCount = 0;
+	int lightCount = 0;
+	int sdfCount = 0;
+	int shapeCount = 0;
+	int meshCount = 0;
+	int instanceSetCount = 0;
+	int geometryCount = 0;
+	int materialCount = 0;
+	int instanceCount = 0;
+	uint32_t stringBytes = 0;
+
+	vector<SphereEntry> sphereData;
+	vector<PlaneEntry> planeData;
+	vector<LightEntry> lightData;
+	vector<SDFEntry> sdfData;
+	vector<ShapeEntry> shapeData;
+	vector<MeshEntry> meshData;
+	vector<InstanceSetEntry> instanceSetData;
+	vector<GeometryEntry> geometryData;
+	vector<MaterialEntry> materialData;
+	vector<InstanceEntry> instanceData;
+	vector<char> stringData;
+
+	void* mapping = nullptr;            // the whole binary file, read only
+	size_t mappingSize = 0;
+	void* fileHandle = nullptr;         // Windows only, POSIX closes the file once mapped
+	void* mapHandle = nullptr;
+};
@@ -0,0 +1,148 @@
+#include "sceneStore.h"
+
+#include <algorithm>
+
+//--------------------------------------------------------------
+Plane* SceneStore::addPlane(glm::vec3 p, glm::vec3 n, ofColor diffuse, float w, float h) {
+	int slot;
+	Plane* plane = planes.create(slot, p, n, diffuse, w, h);
+	setHandle(plane, OBJECT_PLANE, slot, planes);
+	scene.push_back(plane);
+	return plane;
+}
+
+//--------------------------------------------------------------
+Sphere* SceneStore::addSphere(glm::vec3 p, float r, ofColor diffuse) {
+	int slot;
+	Sphere* sphere = spheres.create(slot, p, r, diffuse);
+	setHandle(sphere, OBJECT_SPHERE, slot, spheres);
+	scene.push_back(sphere);
+	return sphere;
+}
+
+//--------------------------------------------------------------
+//adds an SDF object with no primitives yet
+//
+SDFObject* SceneStore::addSDF(glm::vec3 p, ofColor diffuse) {
+	int slot;
+	SDFObject* sdf = sdfs.create(slot, p, diffuse);
+	setHandle(sdf, OBJECT_SDF, slot, sdfs);
+	scene.push_back(sdf);
+	return sdf;
+}
+
+//--------------------------------------------------------------
+//adds an object showing mesh, which may be shared with others
+//
+MeshObject* SceneStore::addMesh(glm::vec3 p, std::shared_ptr<const TriangleMesh> mesh, ofColor diffuse) {
+	int slot;
+	MeshObject* object = meshes.create(slot, p, mesh, diffuse);
+	setHandle(object, OBJECT_MESH, slot, meshes);
+	scene.push_back(object);
+	return object;
+}
+
+//--------------------------------------------------------------
+//adds an instance set with no geometry or instances yet
+//
+InstanceSet* SceneStore::addInstanceSet(glm::vec3 p) {
+	int slot;
+	InstanceSet* set = instanceSets.create(slot, p);
+	setHandle(set, OBJECT_INSTANCES, slot, instanceSets);
+	scene.push_back(set);
+	return set;
+}
+
+//--------------------------------------------------------------
+//adds a light and the aim point sphere that steers it
+//
+Light* SceneStore::addLight(glm::vec3 p, glm::vec3 aimPos, float i, float angle, float width, float aimPointRadius) {
+	int slot;
+	Sphere* aim = aimPoints.create(slot, aimPos, aimPointRadius);
+	setHandle(aim, OBJECT_AIM_POINT, slot, aimPoints);
+	aimPoint.push_back(aim);
+
+	Light* newLight = lights.create(slot, p, aimPos, i, angle, width);
+	setHandle(newLight, OBJECT_LIGHT, slot, lights);
+	light.push_back(newLight);
+	return newLight;
+}
+
+//--------------------------------------------------------------
+bool SceneStore::remove(SceneObject* object) {
+	if (!object || get(object->handle) != object) return false;
+
+	const SceneHandle handle = object->handle;
+	switch (handle.type) {
+	case OBJECT_PLANE:
+	case OBJECT_SPHERE:
+	case OBJECT_SDF:
+	case OBJECT_MESH:
+	case OBJECT_INSTANCES:
+		scene.erase(std::find(scene.begin(), scene.end(), object));
+		if (handle.type == OBJECT_PLANE) planes.destroy(handle.slot);
+		else if (handle.type == OBJECT_SPHERE) spheres.destroy(handle.slot);
+		else if (handle.type == OBJECT_SDF) sdfs.destroy(handle.slot);
+		else if (handle.type == OBJECT_MESH) meshes.destroy(handle.slot);
+		else instanceSets.destroy(handle.slot);
+		return true;
+	case OBJECT_LIGHT:
+	case OBJECT_AIM_POINT: {
+		int i = handle.type == OBJECT_LIGHT ?
+			std::find(light.begin(), light.end(), object) - light.begin() :
+			std::find(aimPoint.begin(), aimPoint.end(), object) - aimPoint.begin();
+		lights.destroy(light[i]->handle.slot);
+		aimPoints.destroy(aimPoint[i]->handle.slot);
+		light.erase(light.begin() + i);
+		aimPoint.erase(aimPoint.begin() + i);
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+//--------------------------------------------------------------
+void SceneStore::clear() {
+	scene.clear();
+	light.clear();
+	aimPoint.clear();
+	planes.clear();
+	spheres.clear();
+	sdfs.clear();
+	meshes.clear();
+	instanceSets.clear();
+	lights.clear();
+	aimPoints.clear();
+}
+
+//--------------------------------------------------------------
+//the live object a handle names, nullptr once it was removed
+//
+SceneObject* SceneStore::get(const SceneHandle& handle) {
+	switch (handle.type) {
+	case OBJECT_PLANE: return planes.get(handle.slot, handle.generation);
+	case OBJECT_SPHERE: return spheres.get(handle.slot, handle.generation);
+	case OBJECT_SDF: return sdfs.get(handle.slot, handle.generation);
+	case OBJECT_MESH: return meshes.get(handle.slot, handle.generation);
+	case OBJECT_INSTANCES: return instanceSets.get(handle.slot, handle.generation);
+	case OBJECT_LIGHT: return lights.get(handle.slot, handle.generation);
+	case OBJECT_AIM_POINT: return aimPoints.get(handle.slot, handle.generation);
+	default: return nullptr;
+	}
+}
+
+//--------------------------------------------------------------
+//loads textures and creates the default planes, light and aim point
+//
+void buildDefaultScene(SceneStore& store, float aimPointRadius) {
+	store.clear();
+
+	Plane* ground = store.addPlane(glm::vec3(-1, -2, 0), glm::vec3(0, 1, 0), ofColor::darkBlue, 12, 10);		//ground plane
+	ground->loadTextures("bamboo.jpg", "bamboo_spec.jpg");
+
+	Plane* wall = store.addPlane(glm::vec3(-1, 1, -5), glm::vec3(0, 0, 1), ofColor::darkGray, 20, 10);		//wall plane
+	wall->loadTextures("ceramic_wall.jpg", "ceramic_wall_spec.jpg");
+
+	store.addLight(glm::vec3(10, 5, 5), glm::vec3(1, -2, 0), .2, 15, 5, aimPointRadius);					//top right light
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "sdf.h"
+#include "triangleMesh.h"
+#include "instanceSet.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+//  Objects of one type, stored contiguously in blocks that never move.
+//  Each new block is as large as all the ones before it, and reserve()
+//  adds one block of exactly the size asked for, so loading a million
+//  objects is one allocation.  Freed slots are reused; each slot counts
+//  how often it was freed so a handle to an object that is gone can be
+//  told from one to its successor.
+//
+template <class T>
+class ObjectPool {
+public:
+	ObjectPool() {}
+	~ObjectPool() { clear(); }
+	ObjectPool(const ObjectPool&) = delete;
+	ObjectPool& operator=(const ObjectPool&) = delete;
+
+	template <class... Args>
+	T* create(int& slot, Args&&... args) {
+		if (freeSlots.empty()) {
+			slot = generation.size();
+			if (slot == capacity) addBlock(capacity > 0 ? capacity : firstBlock);
+			generation.push_back(0);
+			alive.push_back(false);
+		}
+		else {
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		T* object = new (at(slot)) T(std::forward<Args>(args)...);
+		alive[slot] = true;
+		count++;
+		return object;
+	}
+
+	void destroy(int slot) {
+		if (!isAlive(slot)) return;
+		at(slot)->~T();
+		alive[slot] = false;
+		generation[slot]++;
+		freeSlots.push_back(slot);
+		count--;
+	}
+
+	//  destroys every object and frees the blocks
+	//
+	void clear() {
+		for (int slot = 0; slot < generation.size(); slot++) {
+			if (alive[slot]) at(slot)->~T();
+		}
+		blocks.clear();
+		blockStart.clear();
+		capacity = 0;
+		generation.clear();
+		alive.clear();
+		freeSlots.clear();
+		count = 0;
+	}
+
+	//  makes room for n objects in total with at most one more block
+	//
+	void reserve(int n) {
+		if (capacity < n) addBlock(n - capacity);
+		generation.reserve(n);
+		alive.reserve(n);
+	}
+
+	T* get(int slot, uint32_t gen) {
+		return isAlive(slot) && generation[slot] == gen ? at(slot) : nullptr;
+	}
+	uint32_t getGeneration(int slot) const { return generation[slot]; }
+	bool isAlive(int slot) const { return slot >= 0 && slot < alive.size() && alive[slot]; }
+	int size() const { return count; }
+
+private:
+	static const int firstBlock = 64;
+	static_assert(alignof(T) <= alignof(std::max_align_t), "pool blocks are only max_align_t aligned");
+
+	void addBlock(int objects) {
+		blocks.emplace_back(new char[(size_t)objects * sizeof(T)]);
+		blockStart.push_back(capacity);
+		capacity += objects;
+	}
+
+	T* at(int slot) {
+		int block = std::upper_bound(blockStart.begin(), blockStart.end(), slot) - blockStart.begin() - 1;
+		return (T*)blocks[block].get() + (slot - blockStart[block]);
+	}
+
+	vector<std::unique_ptr<char[]>> blocks;
+	vector<int> blockStart;		// first slot of each block
+	int capacity = 0;
+	vector<uint32_t> generation;
+	vector<bool> alive;
+	vector<int> freeSlots;
+	int count = 0;
+};
+
+//  Owns every plane, sphere, SDF object, mesh object, instance set, light
+//  and aim point of a scene, each type in its own ObjectPool, and keeps
+//  the object vectors the tracer and the GUI read in step with it:
+//
+//  - scene holds the renderable planes, spheres, SDF objects, meshes and
+//    instance sets in the order they were added; indices into it are the
+//    object indices hits report
+//  - light[i] is aimed at aimPoint[i]; the two are added and removed
+//    together
+//
+//  Objects never move while they live, so the pointers in those vectors
+//  and in a GUI selection stay valid until the object is removed.  A
+//  SceneHandle outlives that: get() returns nullptr once its object is
+//  gone.  Not thread safe; edit the store only while nothing renders.
+//
+class SceneStore {
+public:
+	SceneStore() {}
+	~SceneStore() { clear(); }
+	SceneStore(const SceneStore&) = delete;
+	SceneStore& operator=(const SceneStore&) = delete;
+
+	Plane* addPlane(glm::vec3 p, glm::vec3 n, ofColor diffuse, float w, float h);
+	Sphere* addSphere(glm::vec3 p, float r, ofColor diffuse = ofColor::lightGray);
+	SDFObject* addSDF(glm::vec3 p, ofColor diffuse = ofColor::lightGray);
+	MeshObject* addMesh(glm::vec3 p, std::shared_ptr<const TriangleMesh> mesh, ofColor diffuse = ofColor::lightGray);
+	InstanceSet* addInstanceSet(glm::vec3 p);
+	Light* addLight(glm::vec3 p, glm::vec3 aimPos, float i, float angle, float width, float aimPointRadius = .5);
+
+	//  removes a plane, sphere, SDF object, mesh or instance set from scene,
+	//  or a light or aim point along with its partner; false if the store
+	//  does not hold the object
+	//
+	bool remove(SceneObject* object);
+	void clear();
+
+	//  room for n more spheres, before adding many at once
+	//
+	void reserveSpheres(int n) { spheres.reserve(spheres.size() + n); scene.reserve(scene.size() + n); }
+
+	SceneObject* get(const SceneHandle& handle);
+
+	int getNumPlanes() const { return planes.size(); }
+	int getNumSpheres() const { return spheres.size(); }
+	int getNumSDFs() const { return sdfs.size(); }
+	int getNumMeshes() const { return meshes.size(); }
+	int getNumInstanceSets() const { return instanceSets.size(); }
+	int getNumLights() const { return lights.size(); }
+
+	vector<SceneObject*> scene;
+	vector<Light*> light;
+	vector<Sphere*> aimPoint;
+
+private:
+	template <class T>
+	void setHandle(T* object, ObjectType type, int slot, ObjectPool<T>& pool) {
+		object->handle = SceneHandle{ type, slot, pool.getGeneration(slot) };
+	}
+
+	ObjectPool<Plane> planes;
+	ObjectPool<Sphere> spheres;
+	ObjectPool<SDFObject> sdfs;
+	ObjectPool<MeshObject> meshes;
+	ObjectPool<InstanceSet> instanceSets;
+	ObjectPool<Light> lights;
+	ObjectPool<Sphere> aimPoints;
+};
+
+
+//  Fills the store with the default scene: a textured ground and wall
+//  plane lit by one light aimed at an aim point sphere.  Textures stay
+//  CPU-side so this works without a GL context.
+//
+void buildDefaultScene(SceneStore& store, float aimPointRadius = .5);
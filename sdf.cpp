@@ -0,0 +1,290 @@
+#include "sdf.h"
+#include "renderProfiler.h"
+
+#include <algorithm>
+
+//  offset of the four samples the normal is estimated from
+//
+static const float normalStep = 5e-4f;
+
+//--------------------------------------------------------------
+//polynomial smooth minimum: min(a, b) less at most k / 4 where the two
+//are within k of each other, exactly min(a, b) everywhere else
+//
+static float smoothMin(float a, float b, float k) {
+	if (k <= 0) return std::min(a, b);
+	float h = std::max(k - std::abs(a - b), 0.0f) / k;
+	return std::min(a, b) - h * h * k * .25f;
+}
+
+//--------------------------------------------------------------
+//distance from p to the nearest point of box, 0 inside
+//
+static float boxDistance(const glm::vec3& p, const AABB& box) {
+	glm::vec3 outside = glm::max(glm::max(box.min - p, p - box.max), glm::vec3(0));
+	return glm::length(outside);
+}
+
+//--------------------------------------------------------------
+void SDFPrimitive::update() {
+	toWorld = eulerRotation(rotation);
+	toLocal = glm::transpose(toWorld);
+
+	glm::vec3 half;
+	switch (shape) {
+	case SDF_SPHERE: half = glm::vec3(size.x); break;
+	case SDF_BOX: half = size; break;
+	case SDF_TORUS: half = glm::vec3(size.x + size.y, size.y, size.x + size.y); break;
+	default:
+		bounds = AABB::infinite();
+		return;
+	}
+
+	//the rotated box's extent along each world axis
+	half = (glm::abs(toWorld[0]) * half.x + glm::abs(toWorld[1]) * half.y + glm::abs(toWorld[2]) * half.z) * scale;
+	bounds = AABB(position - half, position + half);
+}
+
+//--------------------------------------------------------------
+//evaluated in the primitive's frame and scaled back, so distances stay
+//distances
+//
+float SDFPrimitive::distance(const glm::vec3& p) const {
+	glm::vec3 q = toLocal * (p - position) / scale;
+	float d;
+	switch (shape) {
+	case SDF_SPHERE:
+		d = glm::length(q) - size.x;
+		break;
+	case SDF_BOX: {
+		glm::vec3 e = glm::abs(q) - size;
+		d = glm::length(glm::max(e, glm::vec3(0))) + std::min(std::max(e.x, std::max(e.y, e.z)), 0.0f);
+		break;
+	}
+	case SDF_PLANE:
+		d = q.y;
+		break;
+	default: {
+		glm::vec2 ring = glm::vec2(glm::length(glm::vec2(q.x, q.z)) - size.x, q.y);
+		d = glm::length(ring) - size.y;
+		break;
+	}
+	}
+	return d * scale;
+}
+
+//--------------------------------------------------------------
+void SDFObject::add(SDFPrimitive primitive) {
+	primitive.update();
+	primitives.push_back(primitive);
+}
+
+//--------------------------------------------------------------
+//union of the primitive bounds, infinite if any primitive is a plane
+//
+//blending adds material only where the field of the primitive blended
+//in is within its blend radius of the field before it, so a fillet
+//reaches that far from the new primitive and from every earlier one;
+//each box is grown by the largest blend of its primitive and those after
+//it (see clip())
+//
+AABB SDFObject::getBounds() {
+	AABB box;
+	float reach = 0;
+	for (int k = (int)primitives.size() - 1; k >= 0; k--) {
+		const SDFPrimitive& primitive = primitives[k];
+		if (!primitive.bounds.isBounded()) return AABB::infinite();
+		reach = std::max(reach, primitive.blend);
+		box.grow(AABB(primitive.bounds.min - glm::vec3(reach), primitive.bounds.max + glm::vec3(reach)));
+	}
+	if (primitives.empty()) return AABB(position, position);
+	return AABB(box.min + position, box.max + position);
+}
+
+//--------------------------------------------------------------
+//the blended field over the primitives listed in active, in order, at p
+//relative to the object; a primitive is skipped when its box is so far
+//away that it could not lower the field
+//
+float SDFObject::field(const glm::vec3& p, const int* active, int count) const {
+	float d = FLT_MAX;
+	for (int k = 0; k < count; k++) {
+		const SDFPrimitive& primitive = primitives[active[k]];
+		float outside = boxDistance(p, primitive.bounds);
+		if (outside > 0 && outside >= d + primitive.blend) continue;
+		float distance = primitive.distance(p);
+		d = d == FLT_MAX ? distance : smoothMin(d, distance, primitive.blend);
+	}
+	return d;
+}
+
+//--------------------------------------------------------------
+//field gradient from four samples at the corners of a tetrahedron
+//
+glm::vec3 SDFObject::gradient(const glm::vec3& p, const int* active, int count) const {
+	const glm::vec3 a = glm::vec3(1, -1, -1), b = glm::vec3(-1, -1, 1), c = glm::vec3(-1, 1, -1), d = glm::vec3(1, 1, 1);
+	glm::vec3 g = a * field(p + a * normalStep, active, count) + b * field(p + b * normalStep, active, count) +
+		c * field(p + c * normalStep, active, count) + d * field(p + d * normalStep, active, count);
+	float length = glm::length(g);
+	return length > 0 ? g / length : glm::vec3(0, 1, 0);
+}
+
+//--------------------------------------------------------------
+float SDFObject::distance(const glm::vec3& p) const {
+	vector<int> all(primitives.size());
+	for (int k = 0; k < all.size(); k++) all[k] = k;
+	return field(p - position, all.data(), all.size());
+}
+
+//--------------------------------------------------------------
+glm::vec3 SDFObject::getNormal(const glm::vec3& p) {
+	vector<int> all(primitives.size());
+	for (int k = 0; k < all.size(); k++) all[k] = k;
+	return gradient(p - position, all.data(), all.size());
+}
+
+//--------------------------------------------------------------
+//lists in active, in order, the primitives whose grown box the ray
+//passes through between tNear and tFar, and narrows the two to the span
+//those boxes cover; the ray is relative to the object
+//a box is grown by the largest blend of its primitive and every one
+//after it, as a later primitive's fillet wraps the earlier ones too
+//returns how many were listed
+//
+int SDFObject::clip(const Ray& ray, float& tNear, float& tFar, vector<int>& active) const {
+	active.clear();
+	glm::vec3 invDir = 1.0f / ray.d;
+	float enter = FLT_MAX, exit = -FLT_MAX;
+	float reach = 0;
+	for (int k = (int)primitives.size() - 1; k >= 0; k--) {
+		const SDFPrimitive& primitive = primitives[k];
+		reach = std::max(reach, primitive.blend);
+		float t0 = tNear, t1 = tFar;
+		if (primitive.bounds.isBounded()) {
+			glm::vec3 a = (primitive.bounds.min - glm::vec3(reach) - ray.p) * invDir;
+			glm::vec3 b = (primitive.bounds.max + glm::vec3(reach) - ray.p) * invDir;
+			glm::vec3 lo = glm::min(a, b), hi = glm::max(a, b);
+			t0 = std::max(std::max(std::max(lo.x, lo.y), lo.z), tNear);
+			t1 = std::min(std::min(std::min(hi.x, hi.y), hi.z), tFar);
+			if (t0 > t1) continue;
+		}
+		active.push_back(k);
+		enter = std::min(enter, t0);
+		exit = std::max(exit, t1);
+	}
+	std::reverse(active.begin(), active.end());
+	tNear = enter;
+	tFar = exit;
+	return active.size();
+}
+
+//--------------------------------------------------------------
+//over-relaxed sphere tracing from tNear to tFar, on whichever side of
+//the surface tNear lies, so rays leaving a thin sheet from behind find
+//its far side too
+//
+//a relaxed step of relaxation * r is safe as long as the new point is
+//still on the starting side and its unbounding sphere overlaps the one
+//the step was taken from; if not, the step may have jumped the surface,
+//so it is replaced by the plain step of r and relaxation is off for the
+//rest of the ray.  A step that would leave the span is never relaxed,
+//as nothing past tFar could show that it jumped the surface
+//
+bool SDFObject::march(const Ray& ray, float tNear, float tFar, const int* active, int count, float& t) const {
+	float omega = relaxation;
+	float side = 0;				// sign of the field at tNear
+	float step = 0;
+	float previous = 0;			// radius at the point the last step left from
+	int steps = 0;
+	t = tNear;
+	bool hit = false;
+	while (steps < maxSteps && t <= tFar) {
+		float d = field(ray.p + ray.d * t, active, count);
+		if (side == 0) side = d < 0 ? -1 : 1;
+		float radius = side * d;
+		steps++;
+		if (omega > 1 && (radius < 0 || radius + previous < step)) {
+			t += previous - step;
+			step = previous;
+			omega = 1;
+			continue;
+		}
+		if (radius < hitDistance) {
+			hit = true;
+			break;
+		}
+		step = t + radius * omega <= tFar ? radius * omega : radius;
+		previous = radius;
+		t += step;
+	}
+	renderProfiler().count(PROFILE_SDF_STEPS, steps);
+	return hit && t <= tFar;
+}
+
+//--------------------------------------------------------------
+//closest hit in (tMin, hit.t); ray.d must be normalized
+//
+bool SDFObject::intersect(const Ray& ray, float tMin, HitRecord& hit) {
+	static thread_local vector<int> active;
+	Ray local = Ray(ray.p - position, ray.d);
+	float tNear = tMin, tFar = std::min(hit.t, maxDistance);
+	if (clip(local, tNear, tFar, active) == 0) return false;
+
+	float t;
+	if (!march(local, tNear, tFar, active.data(), active.size(), t) || t <= tMin || t >= hit.t) return false;
+
+	hit.t = t;
+	hit.point = ray.p + ray.d * t;
+	hit.normal = gradient(local.p + local.d * t, active.data(), active.size());
+	hit.uv = glm::vec2(0);
+	return true;
+}
+
+//--------------------------------------------------------------
+bool SDFObject::occludes(const Ray& ray, float tMin, float tMax) {
+	static thread_local vector<int> active;
+	Ray local = Ray(ray.p - position, ray.d);
+	float tNear = tMin, tFar = std::min(tMax, maxDistance);
+	if (clip(local, tNear, tFar, active) == 0) return false;
+
+	float t;
+	return march(local, tNear, tFar, active.data(), active.size(), t) && t > tMin && t < tMax;
+}
+
+//--------------------------------------------------------------
+//point and normal form, for picking in the GUI; ray.d need not be
+//normalized
+//
+bool SDFObject::intersect(const Ray& ray, glm::vec3& point, glm::vec3& normal) {
+	HitRecord hit;
+	if (!intersect(Ray(ray.p, glm::normalize(ray.d)), 0, hit)) return false;
+	point = hit.point;
+	normal = hit.normal;
+	return true;
+}
+
+//--------------------------------------------------------------
+//spheres and boxes as they are; tori by their bounding box; planes
+//are left to the grid
+//
+void SDFObject::draw() {
+	if (isSelected) {
+		ofNoFill();
+	}
+	else {
+		ofFill();
+	}
+	for (const SDFPrimitive& primitive : primitives) {
+		if (primitive.shape == SDF_PLANE) continue;
+
+		ofPushMatrix();
+		glm::mat3 m = primitive.toWorld;
+		ofMultMatrix(glm::mat4(glm::vec4(m[0] * primitive.scale, 0), glm::vec4(m[1] * primitive.scale, 0),
+			glm::vec4(m[2] * primitive.scale, 0), glm::vec4(position + primitive.position, 1)));
+		glm::vec3 size = primitive.size;
+		if (primitive.shape == SDF_SPHERE) ofDrawSphere(glm::vec3(0), size.x);
+		else if (primitive.shape == SDF_BOX) ofDrawBox(glm::vec3(0), size.x * 2, size.y * 2, size.z * 2);
+		else ofDrawBox(glm::vec3(0), (size.x + size.y) * 2, size.y * 2, (size.x + size.y) * 2);
+		ofPopMatrix();
+	}
+}
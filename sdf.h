@@ -0,0 +1,102 @@
+#pragma once
+
+#include "scene.h"
+
+enum SDFShape {
+	SDF_SPHERE,
+	SDF_BOX,
+	SDF_PLANE,
+	SDF_TORUS
+};
+
+//  One implicit primitive of an SDFObject.  In its own frame a sphere, box
+//  or torus is centred on the origin, the torus lying around the y axis,
+//  and a plane passes through the origin facing +y.  size holds the
+//  sphere's radius in x, the box's half extents, or the torus's ring and
+//  tube radii in x and y.
+//
+//  The frame is placed relative to the object by position, rotation
+//  (degrees about x, then y, then z) and a uniform scale; stretching one
+//  axis more than another would no longer give distances.  blend is the
+//  radius over which the primitive melts into the ones before it, 0 for
+//  a hard union.
+//
+//  update() derives the inverse rotation and the bounds; call it after
+//  changing any of the above.
+//
+struct SDFPrimitive {
+	SDFShape shape = SDF_SPHERE;
+	glm::vec3 size = glm::vec3(.5);
+	glm::vec3 position = glm::vec3(0);
+	glm::vec3 rotation = glm::vec3(0);
+	float scale = 1;
+	float blend = 0;
+
+	void update();
+
+	//  signed distance from p, relative to the object, to the surface
+	//
+	float distance(const glm::vec3& p) const;
+
+	glm::mat3 toWorld;          // rotation, primitive frame to object
+	glm::mat3 toLocal;          // its inverse
+	AABB bounds;                // relative to the object, infinite for planes
+};
+
+//  Implicit surface: the union of its primitives, each blended into the
+//  ones before it, hit by sphere tracing.  It is an ordinary scene object,
+//  so it sits in the BVH by its bounds and its hits are shaded, shadowed
+//  and reflected like those of spheres and planes.  Like planes it is a
+//  thin sheet to refracted rays.
+//
+//  Tracing stays fast in three ways:
+//
+//  - a ray is clipped to the boxes of the primitives it passes through,
+//    each grown by the largest blend radius of its primitive and the ones
+//    after it, and the field along it is summed over just those; the
+//    surface of the others cannot reach the ray
+//  - at each point a primitive whose box is further away than the field
+//    so far plus its blend radius is skipped, as it cannot change the sum
+//  - steps are over-relaxed: each is relaxation times the distance found,
+//    and once two successive unbounding spheres stop overlapping the step
+//    is taken back and tracing goes on with plain steps
+//
+//  Primitives are positioned relative to the object's position, so
+//  dragging the object moves them all.  Queries are const in effect and
+//  safe to run from any number of threads.
+//
+class SDFObject : public SceneObject {
+public:
+	SDFObject(glm::vec3 p, ofColor diffuse = ofColor::lightGray) { type = OBJECT_SDF; position = p; diffuseColor = diffuse; }
+	SDFObject() { type = OBJECT_SDF; }
+
+	//  appends a primitive, updating its transform and bounds
+	//
+	void add(SDFPrimitive primitive);
+
+	//  signed distance from a world point to the surface
+	//
+	float distance(const glm::vec3& p) const;
+
+	bool intersect(const Ray& ray, glm::vec3& point, glm::vec3& normal);
+	bool intersect(const Ray& ray, float tMin, HitRecord& hit);
+	bool occludes(const Ray& ray, float tMin, float tMax);
+	glm::vec3 getNormal(const glm::vec3& p);
+	AABB getBounds();
+	void draw();
+
+	vector<SDFPrimitive> primitives;
+
+	// sphere tracing
+	//
+	int maxSteps = 256;				// a ray still short of the surface after this many misses it
+	float relaxation = 1.6;			// step length as a multiple of the distance, 1 = plain sphere tracing
+	float hitDistance = 1e-4;		// a point this close to the surface is a hit
+	float maxDistance = 1000;		// how far rays are followed when a plane makes the object unbounded
+
+private:
+	float field(const glm::vec3& p, const int* active, int count) const;
+	glm::vec3 gradient(const glm::vec3& p, const int* active, int count) const;
+	int clip(const Ray& ray, float& tNear, float& tFar, vector<int>& active) const;
+	bool march(const Ray& ray, float tNear, float tFar, const int* active, int count, float& t) const;
+};
@@ -0,0 +1,309 @@
+#include "sphereKernels.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SPHERE_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+static const float epsilon = std::numeric_limits<float>::epsilon();
+
+void SphereSoA::clear() {
+	cx.clear();
+	cy.clear();
+	cz.clear();
+	r2.clear();
+	id.clear();
+}
+
+void SphereSoA::add(const glm::vec3& center, float radius, int index) {
+	cx.push_back(center.x);
+	cy.push_back(center.y);
+	cz.push_back(center.z);
+	r2.push_back(radius * radius);
+	id.push_back(index);
+}
+
+void SphereSoA::set(int slot, const glm::vec3& center, float radius) {
+	cx[slot] = center.x;
+	cy[slot] = center.y;
+	cz[slot] = center.z;
+	r2[slot] = radius * radius;
+}
+
+//--------------------------------------------------------------
+//appends slots that no ray can hit (negative squared radius) so full
+//width loads at the end of the arrays stay in bounds
+//
+void SphereSoA::pad() {
+	int n = size();
+	cx.resize(n + padding, 0);
+	cy.resize(n + padding, 0);
+	cz.resize(n + padding, 0);
+	r2.resize(n + padding, -1);
+}
+
+//--------------------------------------------------------------
+//scalar reference, same steps as glm::intersectRaySphere
+//
+static inline bool hitSphere(const SphereSoA& s, int slot, const glm::vec3& o, const glm::vec3& d, float& t) {
+	float diffx = s.cx[slot] - o.x;
+	float diffy = s.cy[slot] - o.y;
+	float diffz = s.cz[slot] - o.z;
+	float t0 = diffx * d.x + diffy * d.y + diffz * d.z;
+	float dSquared = (diffx * diffx + diffy * diffy + diffz * diffz) - t0 * t0;
+	if (dSquared > s.r2[slot]) return false;
+	float t1 = std::sqrt(s.r2[slot] - dSquared);
+	t = t0 > t1 + epsilon ? t0 - t1 : t0 + t1;
+	return t > epsilon;
+}
+
+static int intersectRayScalar(const SphereSoA& s, int first, int count, const glm::vec3& o, const glm::vec3& d, float tMin, float& tHit) {
+	int best = -1;
+	for (int slot = first; slot < first + count; slot++) {
+		float t;
+		if (hitSphere(s, slot, o, d, t) && t > tMin && t < tHit) {
+			tHit = t;
+			best = slot;
+		}
+	}
+	return best;
+}
+
+static bool occludedRayScalar(const SphereSoA& s, int first, int count, const glm::vec3& o, const glm::vec3& d, float tMin, float tMax) {
+	for (int slot = first; slot < first + count; slot++) {
+		float t;
+		if (hitSphere(s, slot, o, d, t) && t > tMin && t < tMax) return true;
+	}
+	return false;
+}
+
+static void intersectPacketScalar(const SphereSoA& s, int slot, RayPacket& packet) {
+	for (int k = 0; k < packet.size; k++) {
+		float t;
+		glm::vec3 o = glm::vec3(packet.ox[k], packet.oy[k], packet.oz[k]);
+		glm::vec3 d = glm::vec3(packet.dx[k], packet.dy[k], packet.dz[k]);
+		if (hitSphere(s, slot, o, d, t) && t < packet.tHit[k]) {
+			packet.tHit[k] = t;
+			packet.hitSlot[k] = slot;
+		}
+	}
+}
+
+static const SphereKernels scalarKernels = { "scalar", 1, intersectRayScalar, occludedRayScalar, intersectPacketScalar };
+
+#ifdef SPHERE_KERNELS_X86
+
+//--------------------------------------------------------------
+//SSE: 4 spheres or 4 rays per step
+//returns the lanes with a valid hit and their distances in t
+//
+static inline __m128 hitSpheresSSE(__m128 diffx, __m128 diffy, __m128 diffz, __m128 dx, __m128 dy, __m128 dz, __m128 r2, __m128& t) {
+	const __m128 eps = _mm_set1_ps(epsilon);
+	__m128 t0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(diffx, dx), _mm_mul_ps(diffy, dy)), _mm_mul_ps(diffz, dz));
+	__m128 dd = _mm_add_ps(_mm_add_ps(_mm_mul_ps(diffx, diffx), _mm_mul_ps(diffy, diffy)), _mm_mul_ps(diffz, diffz));
+	__m128 dSquared = _mm_sub_ps(dd, _mm_mul_ps(t0, t0));
+	__m128 inside = _mm_cmpngt_ps(dSquared, r2);
+	__m128 t1 = _mm_sqrt_ps(_mm_sub_ps(r2, dSquared));
+	__m128 front = _mm_cmpgt_ps(t0, _mm_add_ps(t1, eps));
+	t = _mm_or_ps(_mm_and_ps(front, _mm_sub_ps(t0, t1)), _mm_andnot_ps(front, _mm_add_ps(t0, t1)));
+	return _mm_and_ps(inside, _mm_cmpgt_ps(t, eps));
+}
+
+static int intersectRaySSE(const SphereSoA& s, int first, int count, const glm::vec3& o, const glm::vec3& d, float tMin, float& tHit) {
+	__m128 ox = _mm_set1_ps(o.x), oy = _mm_set1_ps(o.y), oz = _mm_set1_ps(o.z);
+	__m128 dx = _mm_set1_ps(d.x), dy = _mm_set1_ps(d.y), dz = _mm_set1_ps(d.z);
+	__m128 tLow = _mm_set1_ps(tMin);
+	int best = -1;
+	for (int base = first; base < first + count; base += 4) {
+		__m128 t;
+		__m128 valid = hitSpheresSSE(_mm_sub_ps(_mm_loadu_ps(&s.cx[base]), ox), _mm_sub_ps(_mm_loadu_ps(&s.cy[base]), oy),
+			_mm_sub_ps(_mm_loadu_ps(&s.cz[base]), oz), dx, dy, dz, _mm_loadu_ps(&s.r2[base]), t);
+		valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpgt_ps(t, tLow), _mm_cmplt_ps(t, _mm_set1_ps(tHit))));
+		int lanes = _mm_movemask_ps(valid) & ((1 << std::min(4, first + count - base)) - 1);
+		if (!lanes) continue;
+
+		alignas(16) float ts[4];
+		_mm_store_ps(ts, t);
+		for (int k = 0; k < 4; k++) {
+			if ((lanes & (1 << k)) && ts[k] < tHit) {
+				tHit = ts[k];
+				best = base + k;
+			}
+		}
+	}
+	return best;
+}
+
+static bool occludedRaySSE(const SphereSoA& s, int first, int count, const glm::vec3& o, const glm::vec3& d, float tMin, float tMax) {
+	__m128 ox = _mm_set1_ps(o.x), oy = _mm_set1_ps(o.y), oz = _mm_set1_ps(o.z);
+	__m128 dx = _mm_set1_ps(d.x), dy = _mm_set1_ps(d.y), dz = _mm_set1_ps(d.z);
+	__m128 tLow = _mm_set1_ps(tMin), tHigh = _mm_set1_ps(tMax);
+	for (int base = first; base < first + count; base += 4) {
+		__m128 t;
+		__m128 valid = hitSpheresSSE(_mm_sub_ps(_mm_loadu_ps(&s.cx[base]), ox), _mm_sub_ps(_mm_loadu_ps(&s.cy[base]), oy),
+			_mm_sub_ps(_mm_loadu_ps(&s.cz[base]), oz), dx, dy, dz, _mm_loadu_ps(&s.r2[base]), t);
+		valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpgt_ps(t, tLow), _mm_cmplt_ps(t, tHigh)));
+		if (_mm_movemask_ps(valid) & ((1 << std::min(4, first + count - base)) - 1)) return true;
+	}
+	return false;
+}
+
+static void intersectPacketSSE(const SphereSoA& s, int slot, RayPacket& packet) {
+	__m128 cx = _mm_set1_ps(s.cx[slot]), cy = _mm_set1_ps(s.cy[slot]), cz = _mm_set1_ps(s.cz[slot]);
+	__m128 r2 = _mm_set1_ps(s.r2[slot]);
+	__m128i slots = _mm_set1_epi32(slot);
+	for (int base = 0; base < packet.size; base += 4) {
+		__m128 t;
+		__m128 valid = hitSpheresSSE(_mm_sub_ps(cx, _mm_load_ps(&packet.ox[base])), _mm_sub_ps(cy, _mm_load_ps(&packet.oy[base])),
+			_mm_sub_ps(cz, _mm_load_ps(&packet.oz[base])), _mm_load_ps(&packet.dx[base]), _mm_load_ps(&packet.dy[base]),
+			_mm_load_ps(&packet.dz[base]), r2, t);
+		__m128 tHit = _mm_load_ps(&packet.tHit[base]);
+		__m128i lane = _mm_set_epi32(3, 2, 1, 0);
+		__m128 live = _mm_castsi128_ps(_mm_cmplt_epi32(lane, _mm_set1_epi32(packet.size - base)));
+		valid = _mm_and_ps(_mm_and_ps(valid, live), _mm_cmplt_ps(t, tHit));
+
+		_mm_store_ps(&packet.tHit[base], _mm_or_ps(_mm_and_ps(valid, t), _mm_andnot_ps(valid, tHit)));
+		__m128i hitSlot = _mm_load_si128((const __m128i*) &packet.hitSlot[base]);
+		__m128i mask = _mm_castps_si128(valid);
+		_mm_store_si128((__m128i*) &packet.hitSlot[base], _mm_or_si128(_mm_and_si128(mask, slots), _mm_andnot_si128(mask, hitSlot)));
+	}
+}
+
+static const SphereKernels sseKernels = { "SSE", 4, intersectRaySSE, occludedRaySSE, intersectPacketSSE };
+
+//--------------------------------------------------------------
+//AVX2: 8 spheres or 8 rays per step
+//
+TARGET_AVX2
+static inline __m256 hitSpheresAVX2(__m256 diffx, __m256 diffy, __m256 diffz, __m256 dx, __m256 dy, __m256 dz, __m256 r2, __m256& t) {
+	const __m256 eps = _mm256_set1_ps(epsilon);
+	__m256 t0 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(diffx, dx), _mm256_mul_ps(diffy, dy)), _mm256_mul_ps(diffz, dz));
+	__m256 dd = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(diffx, diffx), _mm256_mul_ps(diffy, diffy)), _mm256_mul_ps(diffz, diffz));
+	__m256 dSquared = _mm256_sub_ps(dd, _mm256_mul_ps(t0, t0));
+	__m256 inside = _mm256_cmp_ps(dSquared, r2, _CMP_NGT_UQ);
+	__m256 t1 = _mm256_sqrt_ps(_mm256_sub_ps(r2, dSquared));
+	__m256 front = _mm256_cmp_ps(t0, _mm256_add_ps(t1, eps), _CMP_GT_OQ);
+	t = _mm256_blendv_ps(_mm256_add_ps(t0, t1), _mm256_sub_ps(t0, t1), front);
+	return _mm256_and_ps(inside, _mm256_cmp_ps(t, eps, _CMP_GT_OQ));
+}
+
+TARGET_AVX2
+static int intersectRayAVX2(const SphereSoA& s, int first, int count, const glm::vec3& o, const glm::vec3& d, float tMin, float& tHit) {
+	__m256 ox = _mm256_set1_ps(o.x), oy = _mm256_set1_ps(o.y), oz = _mm256_set1_ps(o.z);
+	__m256 dx = _mm256_set1_ps(d.x), dy = _mm256_set1_ps(d.y), dz = _mm256_set1_ps(d.z);
+	__m256 tLow = _mm256_set1_ps(tMin);
+	int best = -1;
+	for (int base = first; base < first + count; base += 8) {
+		__m256 t;
+		__m256 valid = hitSpheresAVX2(_mm256_sub_ps(_mm256_loadu_ps(&s.cx[base]), ox), _mm256_sub_ps(_mm256_loadu_ps(&s.cy[base]), oy),
+			_mm256_sub_ps(_mm256_loadu_ps(&s.cz[base]), oz), dx, dy, dz, _mm256_loadu_ps(&s.r2[base]), t);
+		valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(t, tLow, _CMP_GT_OQ), _mm256_cmp_ps(t, _mm256_set1_ps(tHit), _CMP_LT_OQ)));
+		int lanes = _mm256_movemask_ps(valid) & ((1 << std::min(8, first + count - base)) - 1);
+		if (!lanes) continue;
+
+		alignas(32) float ts[8];
+		_mm256_store_ps(ts, t);
+		for (int k = 0; k < 8; k++) {
+			if ((lanes & (1 << k)) && ts[k] < tHit) {
+				tHit = ts[k];
+				best = base + k;
+			}
+		}
+	}
+	return best;
+}
+
+TARGET_AVX2
+static bool occludedRayAVX2(const SphereSoA& s, int first, int count, const glm::vec3& o, const glm::vec3& d, float tMin, float tMax) {
+	__m256 ox = _mm256_set1_ps(o.x), oy = _mm256_set1_ps(o.y), oz = _mm256_set1_ps(o.z);
+	__m256 dx = _mm256_set1_ps(d.x), dy = _mm256_set1_ps(d.y), dz = _mm256_set1_ps(d.z);
+	__m256 tLow = _mm256_set1_ps(tMin), tHigh = _mm256_set1_ps(tMax);
+	for (int base = first; base < first + count; base += 8) {
+		__m256 t;
+		__m256 valid = hitSpheresAVX2(_mm256_sub_ps(_mm256_loadu_ps(&s.cx[base]), ox), _mm256_sub_ps(_mm256_loadu_ps(&s.cy[base]), oy),
+			_mm256_sub_ps(_mm256_loadu_ps(&s.cz[base]), oz), dx, dy, dz, _mm256_loadu_ps(&s.r2[base]), t);
+		valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(t, tLow, _CMP_GT_OQ), _mm256_cmp_ps(t, tHigh, _CMP_LT_OQ)));
+		if (_mm256_movemask_ps(valid) & ((1 << std::min(8, first + count - base)) - 1)) return true;
+	}
+	return false;
+}
+
+TARGET_AVX2
+static void intersectPacketAVX2(const SphereSoA& s, int slot, RayPacket& packet) {
+	__m256 t;
+	__m256 valid = hitSpheresAVX2(_mm256_sub_ps(_mm256_set1_ps(s.cx[slot]), _mm256_load_ps(packet.ox)),
+		_mm256_sub_ps(_mm256_set1_ps(s.cy[slot]), _mm256_load_ps(packet.oy)),
+		_mm256_sub_ps(_mm256_set1_ps(s.cz[slot]), _mm256_load_ps(packet.oz)),
+		_mm256_load_ps(packet.dx), _mm256_load_ps(packet.dy), _mm256_load_ps(packet.dz), _mm256_set1_ps(s.r2[slot]), t);
+	__m256 tHit = _mm256_load_ps(packet.tHit);
+	__m256i lane = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+	__m256 live = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(packet.size), lane));
+	valid = _mm256_and_ps(_mm256_and_ps(valid, live), _mm256_cmp_ps(t, tHit, _CMP_LT_OQ));
+
+	_mm256_store_ps(packet.tHit, _mm256_blendv_ps(tHit, t, valid));
+	__m256i hitSlot = _mm256_load_si256((const __m256i*) packet.hitSlot);
+	_mm256_store_si256((__m256i*) packet.hitSlot, _mm256_blendv_epi8(hitSlot, _mm256_set1_epi32(slot), _mm256_castps_si256(valid)));
+}
+
+static const SphereKernels avx2Kernels = { "AVX2", 8, intersectRayAVX2, occludedRayAVX2, intersectPacketAVX2 };
+
+#endif
+
+//--------------------------------------------------------------
+//asks the CPU (and for AVX, the OS) which vector units we may use
+//
+SimdLevel detectSimdLevel() {
+#if defined(SPHERE_KERNELS_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+	__cpuid(info, 1);
+	bool sse2 = (info[3] & (1 << 26)) != 0;
+	bool osAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6);
+	bool avx2 = false;
+	if (maxLeaf >= 7 && osAvx) {
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+	if (avx2) return SIMD_AVX2;
+	if (sse2) return SIMD_SSE;
+	return SIMD_SCALAR;
+#elif defined(SPHERE_KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+	if (__builtin_cpu_supports("sse2")) return SIMD_SSE;
+	return SIMD_SCALAR;
+#else
+	return SIMD_SCALAR;
+#endif
+}
+
+//--------------------------------------------------------------
+//kernels for the requested level, never above what the CPU supports
+//
+const SphereKernels& sphereKernels(SimdLevel level) {
+	level = std::min(level, detectSimdLevel());
+#ifdef SPHERE_KERNELS_X86
+	if (level >= SIMD_AVX2) return avx2Kernels;
+	if (level >= SIMD_SSE) return sseKernels;
+#endif
+	return scalarKernels;
+}
+
+const SphereKernels& sphereKernels() {
+	static const SphereKernels& best = sphereKernels(detectSimdLevel());
+	return best;
+}
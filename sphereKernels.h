@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+//  Structure-of-arrays copy of sphere centers and squared radii, so that
+//  SIMD kernels can load 4 or 8 spheres with one instruction.  The arrays
+//  are padded past the end so a full-width load starting at any slot
+//  stays in bounds; the padding spheres can never be hit.
+//
+struct SphereSoA {
+	static const int padding = 8;
+
+	std::vector<float> cx, cy, cz, r2;
+	std::vector<int> id;            // caller's index for each slot
+
+	int size() const { return id.size(); }
+	void clear();
+	void add(const glm::vec3& center, float radius, int index);
+	void set(int slot, const glm::vec3& center, float radius);
+	void pad();
+};
+
+//  Up to 8 coherent rays traced together, one per SIMD lane.  Directions
+//  must be normalized.  tHit and hitSlot hold the closest sphere found so
+//  far for every lane and are narrowed by the packet kernel.
+//
+struct RayPacket {
+	static const int maxSize = 8;
+
+	alignas(32) float ox[maxSize], oy[maxSize], oz[maxSize];
+	alignas(32) float dx[maxSize], dy[maxSize], dz[maxSize];
+	alignas(32) float tHit[maxSize];
+	alignas(32) int hitSlot[maxSize];
+	int size = 0;
+};
+
+//  Ray-sphere kernels over a SphereSoA.  All variants evaluate the same
+//  expression as glm::intersectRaySphere in the same order and without
+//  fused multiply-adds, so they return bit-identical distances and the
+//  choice of kernel never changes the image.
+//
+struct SphereKernels {
+	const char* name;
+	int width;
+
+	//  closest sphere in slots [first, first + count) hit beyond tMin and
+	//  nearer than tHit; narrows tHit and returns the slot, or -1
+	//
+	int (*intersectRay)(const SphereSoA& spheres, int first, int count, const glm::vec3& o, const glm::vec3& d, float tMin, float& tHit);
+
+	//  true if any sphere in [first, first + count) is hit in (tMin, tMax)
+	//
+	bool (*occludedRay)(const SphereSoA& spheres, int first, int count, const glm::vec3& o, const glm::vec3& d, float tMin, float tMax);
+
+	//  tests one sphere against every ray in the packet
+	//
+	void (*intersectPacket)(const SphereSoA& spheres, int slot, RayPacket& packet);
+};
+
+enum SimdLevel {
+	SIMD_SCALAR,
+	SIMD_SSE,
+	SIMD_AVX2
+};
+
+SimdLevel detectSimdLevel();                    // via CPUID, once
+const SphereKernels& sphereKernels();           // best kernels for this CPU
+const SphereKernels& sphereKernels(SimdLevel level);
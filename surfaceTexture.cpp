@@ -0,0 +1,140 @@
+#include "surfaceTexture.h"
+
+//--------------------------------------------------------------
+//channel c of pixel (x, y), grey images repeat their one channel
+//
+static unsigned char channel(const ofPixels& pixels, int x, int y, int c) {
+	int channels = pixels.getNumChannels();
+	return pixels.getData()[(y * pixels.getWidth() + x) * channels + (channels < 3 ? 0 : c)];
+}
+
+static int wrap(int i, int size) {
+	i %= size;
+	return i < 0 ? i + size : i;
+}
+
+void SurfaceTexture::clear() {
+	levels.clear();
+	texels.clear();
+}
+
+//--------------------------------------------------------------
+//reserves a tiled level, padded up to whole tiles
+//
+void SurfaceTexture::addLevel(int width, int height) {
+	Level level;
+	level.width = width;
+	level.height = height;
+	level.tilesX = (width + tileMask) >> tileShift;
+	level.offset = texels.size();
+	int tilesY = (height + tileMask) >> tileShift;
+	levels.push_back(level);
+	texels.resize(texels.size() + level.tilesX * tilesY * tileSize * tileSize);
+}
+
+//--------------------------------------------------------------
+//copies both maps into level 0, then box filters each level into the
+//next until it is 1x1
+//
+void SurfaceTexture::build(const ofPixels& diffuse, const ofPixels& specular) {
+	clear();
+	const ofPixels& base = diffuse.isAllocated() ? diffuse : specular;
+	if (!base.isAllocated()) return;
+
+	int width = base.getWidth();
+	int height = base.getHeight();
+	int levelCount = 1;
+	for (int size = std::max(width, height); size > 1; size /= 2) levelCount++;
+	levels.reserve(levelCount);
+	addLevel(width, height);
+
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			Texel& t = at(levels[0], x, y);
+			for (int c = 0; c < 3; c++) {
+				t.diffuse[c] = diffuse.isAllocated() ? channel(diffuse, x, y, c) : 0;
+				if (specular.isAllocated()) {
+					int sx = x * (int)specular.getWidth() / width;
+					int sy = y * (int)specular.getHeight() / height;
+					t.specular[c] = channel(specular, sx, sy, c);
+				}
+				else {
+					t.specular[c] = 0;
+				}
+			}
+			t.diffuse[3] = t.specular[3] = 255;
+		}
+	}
+
+	for (int k = 1; k < levelCount; k++) {
+		addLevel(std::max(1, levels[k - 1].width / 2), std::max(1, levels[k - 1].height / 2));
+		const Level& src = levels[k - 1];
+		const Level& dst = levels[k];
+		for (int y = 0; y < dst.height; y++) {
+			for (int x = 0; x < dst.width; x++) {
+				int x0 = std::min(2 * x, src.width - 1), x1 = std::min(2 * x + 1, src.width - 1);
+				int y0 = std::min(2 * y, src.height - 1), y1 = std::min(2 * y + 1, src.height - 1);
+				const Texel* quad[4] = { &at(src, x0, y0), &at(src, x1, y0), &at(src, x0, y1), &at(src, x1, y1) };
+				Texel& t = at(dst, x, y);
+				for (int c = 0; c < 4; c++) {
+					t.diffuse[c] = (quad[0]->diffuse[c] + quad[1]->diffuse[c] + quad[2]->diffuse[c] + quad[3]->diffuse[c] + 2) / 4;
+					t.specular[c] = (quad[0]->specular[c] + quad[1]->specular[c] + quad[2]->specular[c] + quad[3]->specular[c] + 2) / 4;
+				}
+			}
+		}
+	}
+}
+
+//--------------------------------------------------------------
+//adds weight times the bilinear filtered texel at (u, v) of one level,
+//in 0-255 units
+//
+void SurfaceTexture::bilinear(const Level& level, float u, float v, float weight, glm::vec3& diffuse, glm::vec3& specular) const {
+	float s = u * level.width - .5f;
+	float t = v * level.height - .5f;
+	float fs = floorf(s);
+	float ft = floorf(t);
+	float wx = s - fs;
+	float wy = t - ft;
+	int x0 = wrap((int)fs, level.width), x1 = wrap(x0 + 1, level.width);
+	int y0 = wrap((int)ft, level.height), y1 = wrap(y0 + 1, level.height);
+
+	const Texel* quad[4] = { &at(level, x0, y0), &at(level, x1, y0), &at(level, x0, y1), &at(level, x1, y1) };
+	float w[4] = { (1 - wx) * (1 - wy) * weight, wx * (1 - wy) * weight, (1 - wx) * wy * weight, wx * wy * weight };
+	for (int k = 0; k < 4; k++) {
+		diffuse += w[k] * glm::vec3(quad[k]->diffuse[0], quad[k]->diffuse[1], quad[k]->diffuse[2]);
+		specular += w[k] * glm::vec3(quad[k]->specular[0], quad[k]->specular[1], quad[k]->specular[2]);
+	}
+}
+
+//--------------------------------------------------------------
+//diffuse and specular radiance at (u, v), 255 = 1.0
+//
+void SurfaceTexture::sample(float u, float v, float texelFootprint, glm::vec3& diffuse, glm::vec3& specular) const {
+	diffuse = glm::vec3(0);
+	specular = glm::vec3(0);
+	if (levels.empty()) return;
+
+	if (filter == NEAREST) {
+		const Level& level = levels[0];
+		const Texel& t = at(level, wrap((int)floorf(u * level.width), level.width), wrap((int)floorf(v * level.height), level.height));
+		diffuse = glm::vec3(t.diffuse[0], t.diffuse[1], t.diffuse[2]) / 255.0f;
+		specular = glm::vec3(t.specular[0], t.specular[1], t.specular[2]) / 255.0f;
+		return;
+	}
+
+	int last = levels.size() - 1;
+	float lod = texelFootprint > 1 ? std::min(log2f(texelFootprint), (float)last) : 0;
+
+	if (filter == BILINEAR) {
+		bilinear(levels[(int)(lod + .5f)], u, v, 1, diffuse, specular);
+	}
+	else {
+		int k = (int)lod;
+		float blend = lod - k;
+		bilinear(levels[k], u, v, 1 - blend, diffuse, specular);
+		if (blend > 0) bilinear(levels[std::min(k + 1, last)], u, v, blend, diffuse, specular);
+	}
+	diffuse /= 255.0f;
+	specular /= 255.0f;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "ofMain.h"
+
+//  Diffuse and specular map of a surface, converted once at load time
+//  into a layout built for sampling:
+//
+//  - both maps share one texel (RGBA8 diffuse + RGBA8 specular), so a
+//    hit fetches them with a single lookup
+//  - every mip level is stored in 4x4 texel tiles, so the four texels of
+//    a bilinear footprint are almost always in the same 128 bytes
+//  - a box filtered mip chain down to 1x1, picked by the size of the
+//    pixel footprint, which removes the aliasing on distant surfaces
+//
+//  Texture coordinates repeat outside [0, 1).
+//
+class SurfaceTexture {
+public:
+	enum Filter {
+		NEAREST,            // level 0 only, like ofImage::getColor
+		BILINEAR,           // nearest mip level, bilinear within it
+		TRILINEAR           // bilinear in the two closest levels, blended
+	};
+
+	//  either map may be unallocated; a specular map of a different size
+	//  is resampled to the size of the diffuse map
+	//
+	void build(const ofPixels& diffuse, const ofPixels& specular);
+	void clear();
+
+	bool isAllocated() const { return !levels.empty(); }
+	int getWidth() const { return levels.empty() ? 0 : levels[0].width; }
+	int getHeight() const { return levels.empty() ? 0 : levels[0].height; }
+	int getNumLevels() const { return levels.size(); }
+
+	//  texelFootprint is the width of the pixel footprint measured in
+	//  level 0 texels; 1 or less samples level 0
+	//
+	void sample(float u, float v, float texelFootprint, glm::vec3& diffuse, glm::vec3& specular) const;
+
+	Filter filter = TRILINEAR;
+
+private:
+	struct Texel {
+		unsigned char diffuse[4];
+		unsigned char specular[4];
+	};
+
+	struct Level {
+		int width, height;
+		int tilesX;
+		int offset;             // first texel of the level in texels
+	};
+
+	static const int tileShift = 2;     // 4x4 texel tiles
+	static const int tileSize = 1 << tileShift;
+	static const int tileMask = tileSize - 1;
+
+	void addLevel(int width, int height);
+	Texel& at(const Level& level, int x, int y) { return texels[index(level, x, y)]; }
+	const Texel& at(const Level& level, int x, int y) const { return texels[index(level, x, y)]; }
+	static int index(const Level& level, int x, int y) {
+		return level.offset + (((y >> tileShift) * level.tilesX + (x >> tileShift)) << (2 * tileShift)) + ((y & tileMask) << tileShift) + (x & tileMask);
+	}
+	void bilinear(const Level& level, float u, float v, float weight, glm::vec3& diffuse, glm::vec3& specular) const;
+
+	vector<Level> levels;
+	vector<Texel> texels;
+};
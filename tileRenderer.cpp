@@ -0,0 +1,155 @@
+#include "tileRenderer.h"
+
+#include <algorithm>
+
+TileRenderer::TileRenderer(int numThreads, int tileSize) {
+	this->numThreads = 1;
+	this->tileSize = 32;
+	setTileSize(tileSize);
+	setNumThreads(numThreads);
+}
+
+TileRenderer::~TileRenderer() {
+	stopThreads();
+}
+
+//--------------------------------------------------------------
+//resizes the worker pool, 0 picks one thread per hardware thread
+//
+void TileRenderer::setNumThreads(int n) {
+	if (n <= 0) n = std::max(1u, std::thread::hardware_concurrency());
+	if (n == numThreads && (int)queues.size() == n) return;
+
+	stopThreads();
+	numThreads = n;
+	queues.clear();
+	for (int i = 0; i < numThreads; i++) {
+		queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+	}
+	startThreads();
+}
+
+void TileRenderer::setTileSize(int size) {
+	tileSize = std::max(1, size);
+}
+
+//--------------------------------------------------------------
+//worker 0 is the calling thread, so only numThreads - 1 are spawned
+//
+void TileRenderer::startThreads() {
+	quit = false;
+	for (int i = 1; i < numThreads; i++) {
+		threads.push_back(std::thread(&TileRenderer::workerLoop, this, i));
+	}
+}
+
+void TileRenderer::stopThreads() {
+	{
+		std::lock_guard<std::mutex> guard(poolLock);
+		quit = true;
+	}
+	wake.notify_all();
+	for (int i = 0; i < threads.size(); i++) {
+		threads[i].join();
+	}
+	threads.clear();
+}
+
+//--------------------------------------------------------------
+//pool threads sleep here between frames
+//
+void TileRenderer::workerLoop(int worker) {
+	unsigned long seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> guard(poolLock);
+			wake.wait(guard, [&] { return quit || generation != seen; });
+			if (quit) return;
+			seen = generation;
+		}
+
+		runTiles(worker);
+
+		{
+			std::lock_guard<std::mutex> guard(poolLock);
+			busy--;
+		}
+		finished.notify_one();
+	}
+}
+
+//--------------------------------------------------------------
+//shades tiles until every queue is empty
+//
+void TileRenderer::runTiles(int worker) {
+	int tile;
+	while (nextTile(worker, tile)) {
+		(*job)(tiles[tile]);
+	}
+}
+
+//--------------------------------------------------------------
+//pops from the front of our own queue, otherwise steals from the back
+//of the others, starting with our neighbour to spread out contention
+//
+bool TileRenderer::nextTile(int worker, int& tile) {
+	for (int k = 0; k < numThreads; k++) {
+		int victim = (worker + k) % numThreads;
+		WorkQueue& q = *queues[victim];
+		std::lock_guard<std::mutex> guard(q.lock);
+		if (q.tiles.empty()) continue;
+		if (k == 0) {
+			tile = q.tiles.front();
+			q.tiles.pop_front();
+		}
+		else {
+			tile = q.tiles.back();
+			q.tiles.pop_back();
+		}
+		return true;
+	}
+	return false;
+}
+
+//--------------------------------------------------------------
+//cuts the image into tiles, deals out contiguous runs of tiles to each
+//worker's queue and runs the frame to completion
+//
+void TileRenderer::render(int width, int height, const TileFunc& shadeTile) {
+	tiles.clear();
+	for (int y = 0; y < height; y += tileSize) {
+		for (int x = 0; x < width; x += tileSize) {
+			Tile t;
+			t.x0 = x;
+			t.y0 = y;
+			t.x1 = std::min(x + tileSize, width);
+			t.y1 = std::min(y + tileSize, height);
+			tiles.push_back(t);
+		}
+	}
+
+	int perWorker = ((int)tiles.size() + numThreads - 1) / numThreads;
+	for (int i = 0; i < numThreads; i++) {
+		WorkQueue& q = *queues[i];
+		q.tiles.clear();
+		int first = i * perWorker;
+		int last = std::min(first + perWorker, (int)tiles.size());
+		for (int k = first; k < last; k++) {
+			q.tiles.push_back(k);
+		}
+	}
+
+	job = &shadeTile;
+	{
+		std::lock_guard<std::mutex> guard(poolLock);
+		busy = numThreads - 1;
+		generation++;
+	}
+	wake.notify_all();
+
+	runTiles(0);
+
+	std::unique_lock<std::mutex> guard(poolLock);
+	finished.wait(guard, [&] { return busy == 0; });
+	job = nullptr;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+//  Rectangle of pixels [x0, x1) x [y0, y1) handed to a worker
+//
+struct Tile {
+	int x0, y0, x1, y1;
+};
+
+//  Splits an image into tiles and shades them on a persistent pool of
+//  worker threads.  Every worker owns a queue of tiles; when it runs dry
+//  it steals from the back of another worker's queue, so uneven tiles
+//  (a sphere in one corner, background elsewhere) still balance out.
+//
+//  The calling thread takes part as worker 0, so numThreads = 1 runs the
+//  whole frame serially on the caller with no synchronization at all.
+//
+class TileRenderer {
+public:
+	typedef std::function<void(const Tile& tile)> TileFunc;
+
+	TileRenderer(int numThreads = 0, int tileSize = 32);
+	~TileRenderer();
+
+	void setNumThreads(int n);          // 0 = one per hardware thread
+	int getNumThreads() const { return numThreads; }
+	void setTileSize(int size);
+	int getTileSize() const { return tileSize; }
+
+	//  Calls shadeTile once for every tile covering a width x height image.
+	//  Returns when all tiles are finished.
+	//
+	void render(int width, int height, const TileFunc& shadeTile);
+
+private:
+	struct WorkQueue {
+		std::mutex lock;
+		std::deque<int> tiles;
+	};
+
+	void startThreads();
+	void stopThreads();
+	void workerLoop(int worker);
+	void runTiles(int worker);
+	bool nextTile(int worker, int& tile);
+
+	std::vector<Tile> tiles;
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+	std::vector<std::thread> threads;
+
+	std::mutex poolLock;
+	std::condition_variable wake;
+	std::condition_variable finished;
+	const TileFunc* job = nullptr;
+	unsigned long generation = 0;
+	int busy = 0;
+	bool quit = false;
+
+	int numThreads;
+	int tileSize;
+};
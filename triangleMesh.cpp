@@ -0,0 +1,397 @@
+#include "triangleMesh.h"
+#include "renderProfiler.h"
+
+#include <algorithm>
+
+//  number of centroid bins evaluated per split
+//
+static const int numBins = 12;
+
+//  A ray set up for the watertight test: kz is the axis it runs furthest
+//  along, kx and ky the other two, swapped if it runs down kz so triangles
+//  keep their winding, and the shear takes its direction to (0, 0, 1)
+//
+struct ShearedRay {
+	glm::vec3 origin;
+	int kx, ky, kz;
+	float sx, sy, sz;
+
+	ShearedRay(const Ray& ray) {
+		origin = ray.p;
+		glm::vec3 a = glm::abs(ray.d);
+		kz = a.x > a.y ? (a.x > a.z ? 0 : 2) : (a.y > a.z ? 1 : 2);
+		kx = (kz + 1) % 3;
+		ky = (kx + 1) % 3;
+		if (ray.d[kz] < 0) std::swap(kx, ky);
+		sx = ray.d[kx] / ray.d[kz];
+		sy = ray.d[ky] / ray.d[kz];
+		sz = 1 / ray.d[kz];
+	}
+};
+
+//--------------------------------------------------------------
+//tests the triangle a, b, c against the sheared ray; on a hit in
+//(tMin, tMax) returns true with the distance in t and the weights of b
+//and c in b1 and b2
+//
+static bool intersectTriangle(const ShearedRay& ray, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c,
+	float tMin, float tMax, float& t, float& b1, float& b2) {
+	glm::vec3 A = a - ray.origin, B = b - ray.origin, C = c - ray.origin;
+	float ax = A[ray.kx] - ray.sx * A[ray.kz], ay = A[ray.ky] - ray.sy * A[ray.kz];
+	float bx = B[ray.kx] - ray.sx * B[ray.kz], by = B[ray.ky] - ray.sy * B[ray.kz];
+	float cx = C[ray.kx] - ray.sx * C[ray.kz], cy = C[ray.ky] - ray.sy * C[ray.kz];
+
+	float u = cx * by - cy * bx;
+	float v = ax * cy - ay * cx;
+	float w = bx * ay - by * ax;
+
+	//an exact 0 may be rounding; only double precision settles which
+	//side of the edge the ray passes
+	if (u == 0 || v == 0 || w == 0) {
+		u = (float)((double)cx * by - (double)cy * bx);
+		v = (float)((double)ax * cy - (double)ay * cx);
+		w = (float)((double)bx * ay - (double)by * ax);
+	}
+	if ((u < 0 || v < 0 || w < 0) && (u > 0 || v > 0 || w > 0)) return false;
+
+	float det = u + v + w;
+	if (det == 0) return false;
+
+	//t scaled by det, compared without dividing first
+	float az = ray.sz * A[ray.kz], bz = ray.sz * B[ray.kz], cz = ray.sz * C[ray.kz];
+	float scaled = u * az + v * bz + w * cz;
+	float sign = det < 0 ? -1.0f : 1.0f;
+	if (scaled * sign <= tMin * det * sign || scaled * sign >= tMax * det * sign) return false;
+
+	float inverse = 1 / det;
+	t = scaled * inverse;
+	b1 = v * inverse;
+	b2 = w * inverse;
+	return true;
+}
+
+//  Tests made by one query, handed to the profiler when it returns
+//
+struct MeshCounts {
+	int boxes = 0;
+	int triangles = 0;
+
+	~MeshCounts() {
+		RenderProfiler& profiler = renderProfiler();
+		if (!profiler.isEnabled()) return;
+		ProfileThread& thread = profiler.local();
+		thread.counts[PROFILE_BOX_TESTS] += boxes;
+		thread.counts[PROFILE_TRIANGLE_TESTS] += triangles;
+	}
+};
+
+//--------------------------------------------------------------
+//builds the subtree over refs[start, end) and returns its index; the
+//same binned sweep as BVH::buildNode
+//
+static int buildNode(vector<MeshTreeRef>& refs, vector<MeshNode>& nodes, int start, int end, int depth, int maxLeafSize, int maxDepth) {
+	int index = nodes.size();
+	nodes.push_back(MeshNode());
+
+	AABB box, centroidBounds;
+	for (int i = start; i < end; i++) {
+		box.grow(refs[i].bounds);
+		centroidBounds.grow(refs[i].bounds.center());
+	}
+	nodes[index].bounds = box;
+
+	int count = end - start;
+	glm::vec3 extent = centroidBounds.extent();
+	int axis = 0;
+	if (extent.y > extent[axis]) axis = 1;
+	if (extent.z > extent[axis]) axis = 2;
+
+	if (count <= 1 || (extent[axis] <= 0 && count <= maxLeafSize)) {
+		nodes[index].start = start;
+		nodes[index].count = count;
+		return index;
+	}
+
+	int binCount[numBins] = { 0 };
+	AABB binBounds[numBins];
+	float scale = extent[axis] > 0 ? numBins / extent[axis] : 0;
+	auto binOf = [&](const MeshTreeRef& ref) {
+		int b = (ref.bounds.center()[axis] - centroidBounds.min[axis]) * scale;
+		return std::min(b, numBins - 1);
+	};
+	for (int i = start; i < end; i++) {
+		int b = binOf(refs[i]);
+		binCount[b]++;
+		binBounds[b].grow(refs[i].bounds);
+	}
+
+	float rightArea[numBins];
+	int rightCount[numBins];
+	AABB sweep;
+	int n = 0;
+	for (int b = numBins - 1; b > 0; b--) {
+		sweep.grow(binBounds[b]);
+		n += binCount[b];
+		rightArea[b] = sweep.area();
+		rightCount[b] = n;
+	}
+
+	float bestCost = FLT_MAX;
+	int bestSplit = -1;
+	sweep = AABB();
+	n = 0;
+	for (int b = 0; b < numBins - 1; b++) {
+		sweep.grow(binBounds[b]);
+		n += binCount[b];
+		if (n == 0 || rightCount[b + 1] == 0) continue;
+		float cost = sweep.area() * n + rightArea[b + 1] * rightCount[b + 1];
+		if (cost < bestCost) {
+			bestCost = cost;
+			bestSplit = b;
+		}
+	}
+
+	float leafCost = box.area() * count;
+	float splitCost = box.area() + bestCost;
+	if (count <= maxLeafSize && (bestSplit < 0 || leafCost <= splitCost)) {
+		nodes[index].start = start;
+		nodes[index].count = count;
+		return index;
+	}
+
+	// no useful split, all centroids in one place, or too deep for the
+	// traversal stack: halve the range along the widest axis
+	//
+	int mid;
+	if (bestSplit < 0 || depth >= maxDepth) {
+		mid = (start + end) / 2;
+		std::nth_element(refs.begin() + start, refs.begin() + mid, refs.begin() + end,
+			[&](const MeshTreeRef& a, const MeshTreeRef& b) { return a.bounds.center()[axis] < b.bounds.center()[axis]; });
+	}
+	else {
+		mid = std::partition(refs.begin() + start, refs.begin() + end,
+			[&](const MeshTreeRef& ref) { return binOf(ref) <= bestSplit; }) - refs.begin();
+	}
+
+	buildNode(refs, nodes, start, mid, depth + 1, maxLeafSize, maxDepth);
+	int right = buildNode(refs, nodes, mid, end, depth + 1, maxLeafSize, maxDepth);
+	nodes[index].start = right;
+	nodes[index].count = 0;
+	return index;
+}
+
+//--------------------------------------------------------------
+void buildMeshTree(vector<MeshTreeRef>& refs, vector<MeshNode>& nodes, int maxLeafSize, int maxDepth) {
+	nodes.clear();
+	if (refs.empty()) return;
+
+	//the SAH settles on about one node per leaf of one, so this is rarely
+	//outgrown
+	nodes.reserve(refs.size() + refs.size() / 4);
+	buildNode(refs, nodes, 0, refs.size(), 0, maxLeafSize, maxDepth);
+}
+
+//--------------------------------------------------------------
+//bounds of every triangle, then the tree over them, then the index
+//buffer reordered to match its leaves
+//
+void TriangleMesh::build() {
+	nodes.clear();
+	bounds = AABB();
+	int count = getNumTriangles();
+	if (count == 0) return;
+
+	vector<MeshTreeRef> refs(count);
+	for (int i = 0; i < count; i++) {
+		const uint32_t* v = &indices[3 * i];
+		MeshTreeRef& ref = refs[i];
+		ref.bounds.grow(vertices[v[0]]);
+		ref.bounds.grow(vertices[v[1]]);
+		ref.bounds.grow(vertices[v[2]]);
+		ref.index = i;
+	}
+	buildMeshTree(refs, nodes, maxLeafSize, maxDepth);
+	bounds = nodes[0].bounds;
+
+	//the boxes go before the nodes are trimmed, so the copy that trims
+	//them does not raise the peak
+	vector<uint32_t> order(count);
+	for (int i = 0; i < count; i++) order[i] = refs[i].index;
+	vector<MeshTreeRef>().swap(refs);
+	nodes.shrink_to_fit();
+
+	vector<uint32_t> sorted(indices.size());
+	for (int i = 0; i < count; i++) {
+		std::copy_n(&indices[3 * order[i]], 3, &sorted[3 * i]);
+	}
+	indices.swap(sorted);
+}
+
+//--------------------------------------------------------------
+size_t TriangleMesh::getMemoryBytes() const {
+	return vertices.capacity() * sizeof(glm::vec3) + normals.capacity() * sizeof(glm::vec3) +
+		indices.capacity() * sizeof(uint32_t) + nodes.capacity() * sizeof(MeshNode);
+}
+
+//--------------------------------------------------------------
+//shading normal at barycentric (b1, b2) of a triangle: the vertex
+//normals blended, or the face normal where there are none
+//
+glm::vec3 TriangleMesh::normalAt(int triangle, float b1, float b2) const {
+	const uint32_t* v = &indices[3 * triangle];
+	if (!normals.empty()) {
+		glm::vec3 n = normals[v[0]] * (1 - b1 - b2) + normals[v[1]] * b1 + normals[v[2]] * b2;
+		float length = glm::length(n);
+		if (length > 1e-12f) return n / length;
+	}
+	glm::vec3 n = glm::cross(vertices[v[1]] - vertices[v[0]], vertices[v[2]] - vertices[v[0]]);
+	float length = glm::length(n);
+	return length > 0 ? n / length : glm::vec3(0, 1, 0);
+}
+
+//--------------------------------------------------------------
+//nearer child first so the far one can be culled; the normal is worked
+//out once, for the triangle that turned out closest
+//
+bool TriangleMesh::intersect(const Ray& ray, float tMin, HitRecord& hit) const {
+	if (nodes.empty()) return false;
+	ShearedRay sheared(ray);
+	glm::vec3 invDir = 1.0f / ray.d;
+	MeshCounts counts;
+
+	int best = -1;
+	float bestB1 = 0, bestB2 = 0;
+	int stack[stackSize];
+	int top = 0;
+	float tNear;
+	counts.boxes++;
+	if (intersectMeshBox(nodes[0].bounds, ray.p, invDir, tMin, hit.t, tNear)) stack[top++] = 0;
+
+	while (top > 0) {
+		const MeshNode& node = nodes[stack[--top]];
+		if (node.isLeaf()) {
+			counts.triangles += node.count;
+			for (uint32_t k = node.start; k < node.start + node.count; k++) {
+				const uint32_t* v = &indices[3 * k];
+				float t, b1, b2;
+				if (intersectTriangle(sheared, vertices[v[0]], vertices[v[1]], vertices[v[2]], tMin, hit.t, t, b1, b2)) {
+					hit.t = t;
+					best = k;
+					bestB1 = b1;
+					bestB2 = b2;
+				}
+			}
+			continue;
+		}
+
+		int left = &node - &nodes[0] + 1;
+		int right = node.start;
+		float tLeft = 0, tRight = 0;
+		counts.boxes += 2;
+		bool hitLeft = intersectMeshBox(nodes[left].bounds, ray.p, invDir, tMin, hit.t, tLeft);
+		bool hitRight = intersectMeshBox(nodes[right].bounds, ray.p, invDir, tMin, hit.t, tRight);
+		if (hitLeft && hitRight) {
+			if (tLeft < tRight) {
+				stack[top++] = right;
+				stack[top++] = left;
+			}
+			else {
+				stack[top++] = left;
+				stack[top++] = right;
+			}
+		}
+		else if (hitLeft) stack[top++] = left;
+		else if (hitRight) stack[top++] = right;
+	}
+	if (best < 0) return false;
+
+	const uint32_t* v = &indices[3 * best];
+	glm::vec3 face = glm::cross(vertices[v[1]] - vertices[v[0]], vertices[v[2]] - vertices[v[0]]);
+	glm::vec3 normal = normalAt(best, bestB1, bestB2);
+	hit.point = ray.p + ray.d * hit.t;
+	hit.normal = glm::dot(face, ray.d) > 0 ? -normal : normal;
+	hit.uv = glm::vec2(0);
+	return true;
+}
+
+//--------------------------------------------------------------
+//true as soon as any triangle lies between tMin and tMax
+//
+bool TriangleMesh::occluded(const Ray& ray, float tMin, float tMax) const {
+	if (nodes.empty()) return false;
+	ShearedRay sheared(ray);
+	glm::vec3 invDir = 1.0f / ray.d;
+	MeshCounts counts;
+
+	int stack[stackSize];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const MeshNode& node = nodes[stack[--top]];
+		float tNear;
+		counts.boxes++;
+		if (!intersectMeshBox(node.bounds, ray.p, invDir, tMin, tMax, tNear)) continue;
+		if (node.isLeaf()) {
+			counts.triangles += node.count;
+			for (uint32_t k = node.start; k < node.start + node.count; k++) {
+				const uint32_t* v = &indices[3 * k];
+				float t, b1, b2;
+				if (intersectTriangle(sheared, vertices[v[0]], vertices[v[1]], vertices[v[2]], tMin, tMax, t, b1, b2)) return true;
+			}
+		}
+		else {
+			stack[top++] = node.start;
+			stack[top++] = &node - &nodes[0] + 1;
+		}
+	}
+	return false;
+}
+
+//--------------------------------------------------------------
+//closest hit in (tMin, hit.t); ray.d must be normalized
+//
+bool MeshObject::intersect(const Ray& ray, float tMin, HitRecord& hit) {
+	if (!mesh || !mesh->intersect(Ray(ray.p - position, ray.d), tMin, hit)) return false;
+	hit.point += position;
+	return true;
+}
+
+//--------------------------------------------------------------
+bool MeshObject::occludes(const Ray& ray, float tMin, float tMax) {
+	return mesh && mesh->occluded(Ray(ray.p - position, ray.d), tMin, tMax);
+}
+
+//--------------------------------------------------------------
+//point and normal form, for picking in the GUI; ray.d need not be
+//normalized
+//
+bool MeshObject::intersect(const Ray& ray, glm::vec3& point, glm::vec3& normal) {
+	HitRecord hit;
+	if (!intersect(Ray(ray.p, glm::normalize(ray.d)), 0, hit)) return false;
+	point = hit.point;
+	normal = hit.normal;
+	return true;
+}
+
+//--------------------------------------------------------------
+AABB MeshObject::getBounds() {
+	if (!mesh || mesh->getNumTriangles() == 0) return AABB(position, position);
+	const AABB& box = mesh->getBounds();
+	return AABB(box.min + position, box.max + position);
+}
+
+//--------------------------------------------------------------
+//the bounding box; millions of triangles are more than the preview
+//needs to show where the mesh is
+//
+void MeshObject::draw() {
+	if (isSelected) {
+		ofNoFill();
+	}
+	else {
+		ofFill();
+	}
+	AABB box = getBounds();
+	glm::vec3 size = box.extent();
+	ofDrawBox(box.center(), size.x, size.y, size.z);
+}
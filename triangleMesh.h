@@ -0,0 +1,138 @@
+#pragma once
+
+#include "scene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+//  Node of a TriangleMesh's or an InstanceSet's BVH, 32 bytes.  As in
+//  BVHNode, the left child of an interior node follows it and start holds
+//  the right child; a leaf covers count triangles of the index buffer, or
+//  count instances, beginning at start.
+//
+struct MeshNode {
+	AABB bounds;
+	uint32_t start = 0;
+	uint32_t count = 0;			// 0 for interior nodes
+
+	bool isLeaf() const { return count > 0; }
+};
+
+//  A box and the number of what it bounds, for buildMeshTree
+//
+struct MeshTreeRef {
+	AABB bounds;
+	uint32_t index;
+};
+
+//  Binned SAH tree of MeshNodes over refs, written depth first into
+//  nodes, with refs reordered so each leaf covers a run of them.  Builds
+//  the tree over a TriangleMesh's triangles and the one over an
+//  InstanceSet's instances.
+//
+void buildMeshTree(vector<MeshTreeRef>& refs, vector<MeshNode>& nodes, int maxLeafSize, int maxDepth);
+
+//  Slab test of a MeshNode box, with the entry distance in tNear.  A ray
+//  lying in a face of the box counts as inside it, and each exit is
+//  pushed out by a couple of rounding errors, so a ray through a vertex
+//  or edge on the surface of the box is never culled before the triangle
+//  test gets to see it.
+//
+inline bool intersectMeshBox(const AABB& box, const glm::vec3& origin, const glm::vec3& invDir, float tMin, float tMax, float& tNear) {
+	float tEnter = tMin, tExit = tMax;
+	for (int axis = 0; axis < 3; axis++) {
+		if (std::isinf(invDir[axis])) {
+			if (origin[axis] < box.min[axis] || origin[axis] > box.max[axis]) return false;
+			continue;
+		}
+		float t0 = (box.min[axis] - origin[axis]) * invDir[axis];
+		float t1 = (box.max[axis] - origin[axis]) * invDir[axis];
+		tEnter = std::max(tEnter, std::min(t0, t1));
+		tExit = std::min(tExit, std::max(t0, t1) * (1 + 4 * FLT_EPSILON));
+	}
+	tNear = tEnter;
+	return tEnter <= tExit;
+}
+
+//  Indexed triangle geometry: vertex positions, optionally one normal per
+//  vertex for smooth shading, and three vertex indices per triangle, so
+//  vertices shared by neighbouring triangles are stored once.
+//
+//  build() puts a binned SAH BVH over the triangles.  It reorders the
+//  index buffer into leaf order instead of keeping a separate list of
+//  triangle numbers, so the mesh costs 12 bytes per vertex (24 with
+//  normals), 12 per triangle and about 32 per leaf; the build needs 28
+//  bytes per triangle more while it runs.
+//
+//  Rays are tested with the watertight algorithm of Woop, Benthin and
+//  Wald: the ray is sheared so it runs along +z, and each triangle is
+//  tested by the signs of three 2D edge functions, recomputed in double
+//  when one of them is exactly 0.  A ray through a shared edge or vertex
+//  hits at least one of the triangles that share it, so closed meshes
+//  show no cracks.  Both sides of a triangle are hit.
+//
+//  Coordinates are the mesh's own; MeshObject places it in the scene.
+//  Queries are const and safe from any number of threads once built.
+//
+class TriangleMesh {
+public:
+	//  bounds and BVH over the buffers as they are; call after filling or
+	//  changing them
+	//
+	void build();
+
+	//  closest hit in (tMin, hit.t), hit.t narrowed; ray.d must be
+	//  normalized.  The normal is interpolated from the vertex normals if
+	//  there are any and faces the side the ray came from.
+	//
+	bool intersect(const Ray& ray, float tMin, HitRecord& hit) const;
+	bool occluded(const Ray& ray, float tMin, float tMax) const;
+
+	const AABB& getBounds() const { return bounds; }
+	int getNumVertices() const { return vertices.size(); }
+	int getNumTriangles() const { return indices.size() / 3; }
+	int getNodeCount() const { return nodes.size(); }
+	size_t getMemoryBytes() const;
+
+	vector<glm::vec3> vertices;
+	vector<glm::vec3> normals;		// empty, or one per vertex; zero where the file gave none
+	vector<uint32_t> indices;		// three per triangle
+
+	static const int maxLeafSize = 4;
+	static const int maxDepth = 48;
+	static const int stackSize = 128;
+
+private:
+	glm::vec3 normalAt(int triangle, float b1, float b2) const;
+
+	vector<MeshNode> nodes;
+	AABB bounds;
+};
+
+//  A TriangleMesh placed in the scene at position, with a material of its
+//  own.  The geometry is shared and read only, so any number of mesh
+//  objects can show the same loaded file.  path names the file it came
+//  from, for saving the scene; meshes built in code have none and are not
+//  saved.
+//
+class MeshObject : public SceneObject {
+public:
+	MeshObject(glm::vec3 p, std::shared_ptr<const TriangleMesh> mesh, ofColor diffuse = ofColor::lightGray) {
+		type = OBJECT_MESH;
+		position = p;
+		this->mesh = mesh;
+		diffuseColor = diffuse;
+	}
+	MeshObject() { type = OBJECT_MESH; }
+
+	bool intersect(const Ray& ray, glm::vec3& point, glm::vec3& normal);
+	bool intersect(const Ray& ray, float tMin, HitRecord& hit);
+	bool occludes(const Ray& ray, float tMin, float tMax);
+	AABB getBounds();
+	void draw();
+
+	std::shared_ptr<const TriangleMesh> mesh;
+	string path;
+};